@@ -0,0 +1,130 @@
+#pragma once
+// The real Gpio, which can also deliver the encoder's and scales' edges in
+// batches (see gpioedge.h). pigpio samples the pins every few microseconds
+// and hands its samples over about once a millisecond; rather than have it
+// call us back once per edge, we take them all in one go (with
+// gpioSetGetSamplesFuncEx()) and turn them into a batch of edges for each
+// consumer.
+
+#include "gpioedge.h"
+#include "stepperControl/gpio.h"
+
+#include <pigpio.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+
+namespace mgo {
+
+class BatchingGpio : public Gpio, public IGpioEdgeBatches {
+public:
+    ~BatchingGpio() override
+    {
+        gpioSetGetSamplesFuncEx(nullptr, 0, nullptr);
+    }
+
+    void setEdgeBatchCallback(
+        int pinA, int pinB, GpioEdgeBatchCallback callback, void* userData) override
+    {
+        for (int pin : { pinA, pinB }) {
+            gpioSetMode(pin, PI_INPUT);
+            gpioSetPullUpDown(pin, PI_PUD_UP);
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_consumerCount == m_consumers.size()) {
+            throw std::runtime_error("Too many consumers of GPIO edge batches");
+        }
+        Consumer& consumer = m_consumers[m_consumerCount++];
+        consumer.pinA = pinA;
+        consumer.pinB = pinB;
+        consumer.callback = callback;
+        consumer.userData = userData;
+        consumer.levels = gpioRead_Bits_0_31();
+        registerPins();
+    }
+
+    void removeEdgeBatchCallback(void* userData) override
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (std::size_t n = 0; n < m_consumerCount; ++n) {
+            if (m_consumers[n].userData == userData) {
+                m_consumers[n] = m_consumers[--m_consumerCount];
+                registerPins();
+                return;
+            }
+        }
+    }
+
+private:
+    // Enough for a millisecond's edges on both pins at pigpio's fastest
+    // sample rate; a longer batch is just passed on in parts
+    static constexpr std::size_t BATCH_EDGES = 512;
+    static constexpr std::size_t MAX_CONSUMERS = 4;
+
+    struct Consumer {
+        int pinA { 0 };
+        int pinB { 0 };
+        GpioEdgeBatchCallback callback { nullptr };
+        void* userData { nullptr };
+        // Where the pins were as of the last sample
+        uint32_t levels { 0 };
+        std::array<GpioEdge, BATCH_EDGES> edges {};
+    };
+
+    // Only held briefly by pigpio's thread, once a millisecond, and
+    // otherwise only while consumers come and go
+    std::mutex m_mutex;
+    std::array<Consumer, MAX_CONSUMERS> m_consumers {};
+    std::size_t m_consumerCount { 0 };
+
+    // There's only one sample function, so it's registered again whenever
+    // the consumers (and so the pins we want) change
+    void registerPins()
+    {
+        uint32_t bits = 0;
+        for (std::size_t n = 0; n < m_consumerCount; ++n) {
+            bits |= (1u << m_consumers[n].pinA) | (1u << m_consumers[n].pinB);
+        }
+        gpioSetGetSamplesFuncEx(staticSamplesCallback, bits, this);
+    }
+
+    static void staticSamplesCallback(const gpioSample_t* samples, int count, void* userData)
+    {
+        BatchingGpio* self = reinterpret_cast<BatchingGpio*>(userData);
+        self->onSamples(samples, count);
+    }
+
+    // Each sample has every pin's level; an edge is wherever one of a
+    // consumer's pins differs from the sample before
+    void onSamples(const gpioSample_t* samples, int count)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (std::size_t c = 0; c < m_consumerCount; ++c) {
+            Consumer& consumer = m_consumers[c];
+            std::size_t edges = 0;
+            for (int n = 0; n < count; ++n) {
+                const uint32_t changed = samples[n].level ^ consumer.levels;
+                consumer.levels = samples[n].level;
+                for (int pin : { consumer.pinA, consumer.pinB }) {
+                    if (!(changed & (1u << pin))) {
+                        continue;
+                    }
+                    if (edges == consumer.edges.size()) {
+                        consumer.callback(consumer.edges.data(), edges, consumer.userData);
+                        edges = 0;
+                    }
+                    const int32_t level = (samples[n].level >> pin) & 1;
+                    consumer.edges[edges++] = { pin, level, samples[n].tick };
+                }
+            }
+            if (edges != 0) {
+                consumer.callback(consumer.edges.data(), edges, consumer.userData);
+            }
+        }
+    }
+};
+
+} // end namespace
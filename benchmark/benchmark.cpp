@@ -0,0 +1,223 @@
+// Runs the controller's loop without a display (see HeadlessView) against
+// MockGpio, in each Mode in turn, and reports how long each iteration of the
+// loop takes, and how long after a key is pressed the motor it moves takes
+// its first step (to within WATCH_INTERVAL). The loop is run flat out (no
+// input polling interval, and the model's status checked every iteration),
+// so this is its worst case. Each mode has a MockGpio and Model of its own,
+// torn down before the next mode starts, so their threads don't compete
+// with the next mode's.
+
+#include "configreader.h"
+#include "controller.h"
+#include "headlessview.h"
+#include "keycodes.h"
+#include "log.h"
+#include "model.h"
+#include "stepperControl/mockgpio.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <fmt/format.h>
+
+namespace {
+
+constexpr std::size_t ITERATIONS = 20'000;
+// How many iterations apart the keys which start and stop the motor are
+constexpr std::size_t KEY_INTERVAL = 500;
+// How often the motor is checked for its first step after a key is pressed
+constexpr auto WATCH_INTERVAL = std::chrono::microseconds(50);
+
+// Returns the defaults, other than for the settings given
+class BenchmarkConfig final : public mgo::IConfigReader {
+public:
+    explicit BenchmarkConfig(std::unordered_map<std::string, std::string> settings)
+        : m_settings(std::move(settings))
+    {
+    }
+    std::string read(const std::string& key, const std::string& defaultValue = "") const override
+    {
+        const auto it = m_settings.find(key);
+        return it == m_settings.end() ? defaultValue : it->second;
+    }
+    unsigned long readLong(const std::string& key, unsigned long defaultValue = 0) const override
+    {
+        const auto it = m_settings.find(key);
+        return it == m_settings.end() ? defaultValue : std::stoul(it->second);
+    }
+    double readDouble(const std::string& key, double defaultValue = 0.0) const override
+    {
+        const auto it = m_settings.find(key);
+        return it == m_settings.end() ? defaultValue : std::stod(it->second);
+    }
+    bool readBool(const std::string& key, bool defaultValue) const override
+    {
+        const auto it = m_settings.find(key);
+        return it == m_settings.end() ? defaultValue : it->second == "true";
+    }
+
+private:
+    std::unordered_map<std::string, std::string> m_settings;
+};
+
+// Starts axis1 moving one way, stops it, starts it moving the other way,
+// stops it, and so on
+std::vector<int> makeScript()
+{
+    constexpr std::array<int, 4> keys { mgo::key::RIGHT,
+                                        mgo::key::SPACE,
+                                        mgo::key::LEFT,
+                                        mgo::key::SPACE };
+    std::vector<int> script(ITERATIONS, mgo::key::None);
+    for (std::size_t n = 0; n < ITERATIONS; n += KEY_INTERVAL) {
+        script[n] = keys[(n / KEY_INTERVAL) % keys.size()];
+    }
+    return script;
+}
+
+int64_t nowNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// Mean, 99th percentile and maximum, in microseconds
+std::string summarise(std::vector<double> microseconds)
+{
+    if (microseconds.empty()) {
+        return fmt::format("{:>9} {:>9} {:>9}", "-", "-", "-");
+    }
+    std::sort(microseconds.begin(), microseconds.end());
+    double total = 0.0;
+    for (double value : microseconds) {
+        total += value;
+    }
+    return fmt::format(
+        "{:>9.1f} {:>9.1f} {:>9.1f}",
+        total / microseconds.size(),
+        microseconds[(microseconds.size() - 1) * 99 / 100],
+        microseconds.back());
+}
+
+void benchmark(BenchmarkConfig& config, mgo::Mode mode, std::string_view name)
+{
+    auto gpio = std::make_unique<mgo::MockGpio>(false, config);
+    auto model = std::make_unique<mgo::Model>(*gpio, config);
+    // In threading mode, moves wait for the spindle to reach zero degrees,
+    // so that's what we'd be measuring
+    const bool measureKeys = mode != mgo::Mode::Threading;
+
+    auto view = std::make_unique<mgo::HeadlessView>(makeScript());
+    const mgo::HeadlessView& headless = *view;
+    // Set when a key which should start the motor is pressed, along with
+    // where the motor was then, and cleared by the watcher. -1 once the run
+    // is over.
+    std::atomic<int64_t> keyPressedAt { 0 };
+    std::atomic<double> stepAtKey { 0.0 };
+    view->setKeyCallback([&](int key) {
+        if (measureKeys && (key == mgo::key::RIGHT || key == mgo::key::LEFT)) {
+            stepAtKey = model->getAxis1MotorCurrentStep();
+            keyPressedAt = nowNanoseconds();
+            keyPressedAt.notify_one();
+        }
+    });
+    auto controller = std::make_unique<mgo::Controller>(model.get(), std::move(view));
+    model->setTaperAngle(1.0);
+    model->setRadius(1.0);
+    if (mode != mgo::Mode::None) {
+        model->changeMode(mode);
+    }
+
+    // Sleeps until a key is pressed, then until the motor moves, so it
+    // doesn't take a core from the loop being measured
+    std::vector<double> latencies;
+    std::thread watcher([&]() {
+        for (;;) {
+            keyPressedAt.wait(0);
+            const int64_t pressedAt = keyPressedAt.exchange(0);
+            if (pressedAt < 0) {
+                return;
+            }
+            while (keyPressedAt == 0 && model->getAxis1MotorCurrentStep() == stepAtKey) {
+                std::this_thread::sleep_for(WATCH_INTERVAL);
+            }
+            if (keyPressedAt == 0) {
+                latencies.push_back((nowNanoseconds() - pressedAt) / 1'000.0);
+            }
+        }
+    });
+    controller->run();
+    keyPressedAt = -1;
+    keyPressedAt.notify_one();
+    watcher.join();
+
+    const auto& times = headless.getEventTimes();
+    std::vector<double> iterations;
+    for (std::size_t n = 1; n < times.size(); ++n) {
+        iterations.push_back(
+            std::chrono::duration<double, std::micro>(times[n] - times[n - 1]).count());
+    }
+
+    // The motors' (and model's sampling) threads are stopped first; the
+    // model's encoder then lets go of the gpio as it goes, so the gpio's last
+    controller.reset();
+    model->resetMotorThreads();
+    model.reset();
+    gpio.reset();
+
+    fmt::print(
+        "{:<12} {:>10} {}   {:>7} {}{}\n",
+        name,
+        iterations.size(),
+        summarise(iterations),
+        latencies.size(),
+        summarise(latencies),
+        measureKeys ? "" : " (not measured)");
+}
+
+} // end anonymous namespace
+
+int main()
+{
+    INIT_MGOLOG("benchmark.log");
+    fmt::print(
+        "{:<12} {:>10} {:>29}   {:>37}\n",
+        "",
+        "",
+        "Loop iteration (us)",
+        "Key to first step (us)");
+    fmt::print(
+        "{:<12} {:>10} {:>9} {:>9} {:>9}   {:>7} {:>9} {:>9} {:>9}\n",
+        "Mode",
+        "Iterations",
+        "Mean",
+        "p99",
+        "Max",
+        "Keys",
+        "Mean",
+        "p99",
+        "Max");
+    BenchmarkConfig config({
+        { "InputPollMilliseconds", "0" },
+        { "StatusPeriodMilliseconds", "0" },
+        { "LockMemory", "false" },
+    });
+    benchmark(config, mgo::Mode::None, "None");
+    benchmark(config, mgo::Mode::Setup, "Setup");
+    benchmark(config, mgo::Mode::Threading, "Threading");
+    benchmark(config, mgo::Mode::Taper, "Taper");
+    benchmark(config, mgo::Mode::Radius, "Radius");
+    benchmark(config, mgo::Mode::MultiPass, "MultiPass");
+    benchmark(config, mgo::Mode::Diagnostics, "Diagnostics");
+    return 0;
+}
@@ -5,30 +5,18 @@
 #include "keycodes.h"
 #include "log.h"
 #include "threadpitches.h"
-#include "view_sfml.h"
 
 #include <cassert>
 #include <chrono>
 
 namespace mgo {
 
-namespace {
-
-void yieldSleep(std::chrono::microseconds microsecs)
-{
-    auto start = std::chrono::high_resolution_clock::now();
-    auto end = start + microsecs;
-    while (std::chrono::high_resolution_clock::now() < end) {
-        std::this_thread::yield();
-    }
-}
-
-} // end anonymous namespace
-
-Controller::Controller(Model* model)
+Controller::Controller(Model* model, std::unique_ptr<IView> view)
     : m_model(model)
+    , m_view(std::move(view))
+    , m_inputPoll(model->config().readLong("InputPollMilliseconds", 5))
+    , m_statusPeriod(model->config().readLong("StatusPeriodMilliseconds", 20))
 {
-    m_view = std::make_unique<ViewSfml>();
     m_view->initialise(*m_model);
     m_view->updateDisplay(*m_model); // get SFML running before we start the motor threads
     m_model->initialise();
@@ -39,41 +27,79 @@ void Controller::run()
     m_model->setAxis1MotorSpeed(m_model->config().readDouble("Axis1SpeedPreset2", 40.0));
     m_model->setAxis2MotorSpeed(m_model->config().readDouble("Axis2SpeedPreset2", 20.0));
 
+    Profiler& profiler = m_model->profiler();
+    auto statusDue = std::chrono::steady_clock::now();
+    bool woken = false;
     while (!m_model->isQuitting()) {
-        processKeyPress();
+        const auto iterationStart = Profiler::Clock::now();
+        const bool keyPressed = processKeyPress();
+        profiler.record(ProfileStage::ProcessKeyPress, iterationStart);
+
+        // The model's status is only checked (and the display updated) when
+        // something may have changed it, it's due anyway, or the axes are
+        // being waited for
+        const auto now = std::chrono::steady_clock::now();
+        if (keyPressed || woken || m_onMotorsStopped || now >= statusDue) {
+            statusDue = now + m_statusPeriod;
 
-        StatusResult rc = m_model->checkStatus();
+            auto stageStart = Profiler::Clock::now();
+            StatusResult rc = m_model->checkStatus();
+            profiler.record(ProfileStage::CheckStatus, stageStart);
 
-        m_view->updateDisplay(*m_model);
+            if (rc == StatusResult::PressAKey || rc == StatusResult::WaitForMotors) {
+                // The multi-pass is paused, so the model leaves it be, until
+                // both axes have stopped
+                m_model->setMultiPassStage(MultiPassStage::Paused);
+                waitForMotors([this, rc]() {
+                    if (rc == StatusResult::PressAKey) {
+                        // The next cut waits for the operator, while
+                        // everything else carries on
+                        pressAnyKey("Press a key to continue", {}, [this]() {
+                            m_model->setMultiPassStage(MultiPassStage::StepOver);
+                        });
+                    } else {
+                        m_model->setMultiPassStage(MultiPassStage::StepOver);
+                    }
+                });
+            }
+            checkMotorsStopped();
 
-        if (rc == StatusResult::PressAKey || rc == StatusResult::WaitForMotors) {
-            waitForAxisToStop(1);
-            waitForAxisToStop(2);
+            stageStart = Profiler::Clock::now();
             m_view->updateDisplay(*m_model);
-            if (rc == StatusResult::PressAKey) {
-                pressAnyKey("Press a key to continue", {});
+            profiler.record(ProfileStage::UpdateDisplay, stageStart);
+
+            if (m_model->isShuttingDown()) {
+                MGOLOG("Shutting down");
+                // Stop the motor threads
+                m_model->resetMotorThreads();
+                // Note the command used for shutdown should be made passwordless
+                // in the /etc/sudoers files
+                [[maybe_unused]] auto rc = system("sudo shutdown -h now &");
             }
-            m_model->setMultiPassStage(MultiPassStage::StepOver);
         }
 
-        if (m_model->isShuttingDown()) {
-            MGOLOG("Shutting down");
-            // Stop the motor threads
-            m_model->resetMotorThreads();
-            // Note the command used for shutdown should be made passwordless
-            // in the /etc/sudoers files
-            [[maybe_unused]] auto rc = system("sudo shutdown -h now &");
-        }
+        profiler.record(ProfileStage::Iteration, iterationStart);
 
-        // Small delay just to avoid the UI loop spinning
-        yieldSleep(std::chrono::microseconds(50'000));
+        // Motors starting or stopping (for instance) wake us straight away,
+        // but SFML can't, so input is polled every m_inputPoll. If there was
+        // some input, there may be more waiting.
+        woken = !keyPressed && m_model->wakeup().wait(m_inputPoll);
     }
 }
 
-void Controller::processKeyPress()
+bool Controller::processKeyPress()
 {
-    int t = m_view->getEvents();
-    t = checkKeyAllowedForMode(t);
+    const auto start = Profiler::Clock::now();
+    const int event = m_view->getEvents();
+    m_model->profiler().record(ProfileStage::GetEvents, start);
+    if (m_model->getDialog().has_value()) {
+        // The dialog has every key until it's closed
+        if (m_model->getDialog()->handleKey(event)) {
+            closeDialog();
+        }
+        return event != key::None;
+    }
+    int t = checkKeyAllowedForMode(event);
     t = processModeInputKeys(t);
     if (t != key::None) {
         if (m_model->getKeyMode() != KeyMode::None) {
@@ -239,8 +265,7 @@ void Controller::processKeyPress()
                 }
             case key::aAll_ENTER:
                 {
-                    m_model->axis1GoToCurrentMemory();
-                    m_model->axis2GoToCurrentMemory();
+                    m_model->goToCurrentMemory();
                     break;
                 }
             case key::ENTER:
@@ -526,22 +551,30 @@ void Controller::processKeyPress()
                 {
                     // Note all motors will be stopped when a dialog is displayed
                     const std::string axisName = m_model->config().read("Axis1Label", "Z");
-                    const auto rc = getNumericInput(
-                        "Go to " + axisName + " absolute position", { "Specify a value" }, 0.0);
-                    if (!rc.cancelled) {
-                        m_model->axis1GoToPosition(rc.value);
-                    }
+                    getNumericInput(
+                        "Go to " + axisName + " absolute position",
+                        { "Specify a value" },
+                        0.0,
+                        [this](const NumericInputReturn& rc) {
+                            if (!rc.cancelled) {
+                                m_model->axis1GoToPosition(rc.value);
+                            }
+                        });
                     break;
                 }
             case key::a2_g:
                 {
                     // Note all motors will be stopped when a dialog is displayed
                     const std::string axisName = m_model->config().read("Axis2Label", "X");
-                    const auto rc = getNumericInput(
-                        "Go to " + axisName + " absolute position", { "Specify a value" }, 0.0);
-                    if (!rc.cancelled) {
-                        m_model->axis2GoToPosition(rc.value);
-                    }
+                    getNumericInput(
+                        "Go to " + axisName + " absolute position",
+                        { "Specify a value" },
+                        0.0,
+                        [this](const NumericInputReturn& rc) {
+                            if (!rc.cancelled) {
+                                m_model->axis2GoToPosition(rc.value);
+                            }
+                        });
                     break;
                 }
             case key::a1_r:
@@ -549,13 +582,15 @@ void Controller::processKeyPress()
                     // Relative motion
                     // Note all motors will be stopped when a dialog is displayed
                     const std::string axisName = m_model->config().read("Axis1Label", "Z");
-                    const auto rc = getNumericInput(
+                    getNumericInput(
                         "Go to " + axisName + " relative position",
                         { "Specify a RELATIVE offset value" },
-                        0.0);
-                    if (!rc.cancelled) {
-                        m_model->axis1GoToOffset(rc.value);
-                    }
+                        0.0,
+                        [this](const NumericInputReturn& rc) {
+                            if (!rc.cancelled) {
+                                m_model->axis1GoToOffset(rc.value);
+                            }
+                        });
                     break;
                 }
             case key::a2_r:
@@ -563,13 +598,15 @@ void Controller::processKeyPress()
                     // Relative motion
                     // Note all motors will be stopped when a dialog is displayed
                     const std::string axisName = m_model->config().read("Axis2Label", "X");
-                    const auto rc = getNumericInput(
+                    getNumericInput(
                         "Go to " + axisName + " relative position",
                         { "Specify a RELATIVE offset value" },
-                        0.0);
-                    if (!rc.cancelled) {
-                        m_model->axis2GoToOffset(rc.value);
-                    }
+                        0.0,
+                        [this](const NumericInputReturn& rc) {
+                            if (!rc.cancelled) {
+                                m_model->axis2GoToOffset(rc.value);
+                            }
+                        });
                     break;
                 }
             case key::ASTERISK: // shutdown
@@ -590,7 +627,9 @@ void Controller::processKeyPress()
                     const std::string axis2Name = m_model->config().read("Axis2Label", "X");
                     pressAnyKey(
                         "Help",
-                        { "Modes: (F2=Leader) s=Setup t=Thread p=taPer r=Retract, o=radius",
+                        { "Modes: (F2=Leader) s=Setup t=Thread p=taPer r=Retract, o=radius, "
+                          "d=Diagnostics,",
+                          "f=Frame timings",
                           "",
                           axis1Name + " axis speed: 1-5, " + axis2Name + " axis speed: 6-0",
                           "[ and ] select memory slot to use. M store, Enter return (F fast).",
@@ -608,6 +647,22 @@ void Controller::processKeyPress()
                     m_model->changeMode(Mode::Setup);
                     break;
                 }
+            case key::f2d: // diagnostics
+                {
+                    // This only changes what's displayed, so anything
+                    // in progress (including motion) carries on. Pressed
+                    // again, it flips between the figures and the plots.
+                    if (m_model->getCurrentDisplayMode() == Mode::Diagnostics) {
+                        m_model->setShowHistory(!m_model->getShowHistory());
+                    }
+                    m_model->setCurrentDisplayMode(Mode::Diagnostics);
+                    break;
+                }
+            case key::f2f: // control loop timings
+                {
+                    m_model->setShowProfiler(!m_model->getShowProfiler());
+                    break;
+                }
             case key::f2t: // threading mode
                 {
                     if (m_model->config().readBool("DisableAxis2", false)) {
@@ -617,11 +672,15 @@ void Controller::processKeyPress()
                     for (const auto& tp : threadPitches) {
                         threadVec.push_back(tp.name);
                     }
-                    const auto rc = listPicker("Select thread pitch required", threadVec);
-                    if (rc.has_value()) {
-                        m_model->setThreadPitch(rc.value());
-                        m_model->changeMode(Mode::Threading);
-                    }
+                    listPicker(
+                        "Select thread pitch required",
+                        threadVec,
+                        [this](std::optional<std::size_t> rc) {
+                            if (rc.has_value()) {
+                                m_model->setThreadPitch(rc.value());
+                                m_model->changeMode(Mode::Threading);
+                            }
+                        });
                     break;
                 }
             case key::f2m: // multi-pass mode
@@ -646,7 +705,7 @@ void Controller::processKeyPress()
                     }
                     const std::string axis1Name = m_model->config().read("Axis1Label", "Z");
                     const std::string axis2Name = m_model->config().read("Axis2Label", "X");
-                    const auto rc = getNumericInput(
+                    getNumericInput(
                         "Multi-Pass",
                         { "Enter " + axis2Name + " step-over per pass.",
                           "",
@@ -658,21 +717,24 @@ void Controller::processKeyPress()
                           "",
                           "[&P]: pause between passes",
                           "[&R] retract between passes" },
-                        0.0);
-                    if (!rc.cancelled) {
-                        m_model->setStepOver(rc.value);
-                        m_model->changeMode(Mode::MultiPass);
-                        if (rc.optionsSelected.contains('p')) {
-                            m_model->setMultiPassPauseBetweenCuts(true);
-                        } else {
-                            m_model->setMultiPassPauseBetweenCuts(false);
-                        }
-                        if (rc.optionsSelected.contains('r')) {
-                            m_model->setMultiPassRetractBetweenCuts(true);
-                        } else {
-                            m_model->setMultiPassRetractBetweenCuts(false);
-                        }
-                    }
+                        0.0,
+                        [this](const NumericInputReturn& rc) {
+                            if (rc.cancelled) {
+                                return;
+                            }
+                            m_model->setStepOver(rc.value);
+                            m_model->changeMode(Mode::MultiPass);
+                            if (rc.optionsSelected.contains('p')) {
+                                m_model->setMultiPassPauseBetweenCuts(true);
+                            } else {
+                                m_model->setMultiPassPauseBetweenCuts(false);
+                            }
+                            if (rc.optionsSelected.contains('r')) {
+                                m_model->setMultiPassRetractBetweenCuts(true);
+                            } else {
+                                m_model->setMultiPassRetractBetweenCuts(false);
+                            }
+                        });
                     break;
                 }
             case key::f2p: // taper mode
@@ -681,16 +743,18 @@ void Controller::processKeyPress()
                         break;
                     }
                     // Note all motors will be stopped when a dialog is displayed
-                    const auto rc = getNumericInput(
+                    getNumericInput(
                         "Enter taper value",
                         { "MT1 = -1.4287, MT2 = -1.4307",
                           "MT3 = -1.4377, MT4 = ff-1.4876",
                           "(negative angle means piece gets wider towards chuck)" },
-                        m_model->getTaperAngle());
-                    if (!rc.cancelled) {
-                        m_model->setTaperAngle(rc.value);
-                        m_model->changeMode(Mode::Taper);
-                    }
+                        m_model->getTaperAngle(),
+                        [this](const NumericInputReturn& rc) {
+                            if (!rc.cancelled) {
+                                m_model->setTaperAngle(rc.value);
+                                m_model->changeMode(Mode::Taper);
+                            }
+                        });
                     break;
                 }
             case key::f2r: // X retraction setup
@@ -698,15 +762,18 @@ void Controller::processKeyPress()
                     if (m_model->config().readBool("DisableAxis2", false)) {
                         break;
                     }
-                    const auto rc = listPicker(
-                        "Choose retraction direction", { "Normal (outwards)", "Boring (inwards)" });
-                    if (rc.has_value()) {
-                        if (rc.value() == 0) {
-                            m_model->setRetractionDirection(XDirection::Outwards);
-                        } else {
-                            m_model->setRetractionDirection(XDirection::Inwards);
-                        }
-                    }
+                    listPicker(
+                        "Choose retraction direction",
+                        { "Normal (outwards)", "Boring (inwards)" },
+                        [this](std::optional<std::size_t> rc) {
+                            if (rc.has_value()) {
+                                if (rc.value() == 0) {
+                                    m_model->setRetractionDirection(XDirection::Outwards);
+                                } else {
+                                    m_model->setRetractionDirection(XDirection::Inwards);
+                                }
+                            }
+                        });
                     break;
                 }
             case key::f2o: // Radius mode
@@ -716,7 +783,7 @@ void Controller::processKeyPress()
                     }
                     const std::string axis1Name = m_model->config().read("Axis1Label", "Z");
                     const std::string axis2Name = m_model->config().read("Axis2Label", "X");
-                    const auto rc = getNumericInput(
+                    getNumericInput(
                         "Enter radius value required:",
                         { "Important! Ensure the tool is at the radius of the workpiece,",
                           "near the end, and set axes to ZERO (this drives the operation).",
@@ -731,51 +798,59 @@ void Controller::processKeyPress()
                               axis1Name),
                           "Memorising the new zero position each time will make returning "
                           "easier." },
-                        m_model->getRadius());
-                    if (!rc.cancelled) {
-                        m_model->setRadius(rc.value);
-                        m_model->changeMode(Mode::Radius);
-                    }
+                        m_model->getRadius(),
+                        [this](const NumericInputReturn& rc) {
+                            if (!rc.cancelled) {
+                                m_model->setRadius(rc.value);
+                                m_model->changeMode(Mode::Radius);
+                            }
+                        });
                     break;
                 }
             case key::a1_s: // Axis1 position set
                 {
                     const std::string axisName = m_model->config().read("Axis1Label", "Z");
-                    const auto result = getNumericInput(
+                    getNumericInput(
                         axisName + " position set",
                         { "[&A] adjust (keeps memory slots)" },
-                        0.0);
-                    if (!result.cancelled) {
-                        m_model->setAxis1Position(result.value);
-                        // This will invalidate any memorised Z positions, so we clear them
-                        // unless the user specified not to with 'A'
-                        if (!result.optionsSelected.contains('a')) {
-                            m_model->clearAllAxis1Memories();
-                        }
-                    }
+                        0.0,
+                        [this](const NumericInputReturn& result) {
+                            if (result.cancelled) {
+                                return;
+                            }
+                            m_model->setAxis1Position(result.value);
+                            // This will invalidate any memorised Z positions, so we clear
+                            // them unless the user specified not to with 'A'
+                            if (!result.optionsSelected.contains('a')) {
+                                m_model->clearAllAxis1Memories();
+                            }
+                        });
                     break;
                 }
             case key::a2_s: // Axis2 position set
                 {
                     // Note all motors will be stopped when a dialog is displayed
                     const std::string axisName = m_model->config().read("Axis2Label", "X");
-                    auto result = getNumericInput(
+                    getNumericInput(
                         axisName + " position set",
                         { "[&D] set as diameter", "[&A] adjusts (keeps memory slots)" },
-                        0.0);
-                    if (!result.cancelled) {
-                        float position = result.value;
-                        if (result.optionsSelected.contains('d')) {
-                            position /= 2;
-                            m_model->diameterIsSet();
-                        }
-                        m_model->setAxis2Position(position);
-                        // This will invalidate any memorised X positions, so we clear them
-                        // unless the user specified not to with 'A'
-                        if (!result.optionsSelected.contains('a')) {
-                            m_model->clearAllAxis2Memories();
-                        }
-                    }
+                        0.0,
+                        [this](const NumericInputReturn& result) {
+                            if (result.cancelled) {
+                                return;
+                            }
+                            float position = result.value;
+                            if (result.optionsSelected.contains('d')) {
+                                position /= 2;
+                                m_model->diameterIsSet();
+                            }
+                            m_model->setAxis2Position(position);
+                            // This will invalidate any memorised X positions, so we clear
+                            // them unless the user specified not to with 'A'
+                            if (!result.optionsSelected.contains('a')) {
+                                m_model->clearAllAxis2Memories();
+                            }
+                        });
                     break;
                 }
             case key::i: // Input axis 1 memory value directly
@@ -784,24 +859,45 @@ void Controller::processKeyPress()
                 {
                     // Note all motors will be stopped when a dialog is displayed
                     const std::string axisName = m_model->config().read("Axis1Label", "Z");
-                    const auto rc = getNumericInput("Enter " + axisName + " memory value", {}, 0.0);
-                    if (!rc.cancelled) {
-                        m_model->axis1StorePosition(rc.value);
-                    }
+                    getNumericInput(
+                        "Enter " + axisName + " memory value",
+                        {},
+                        0.0,
+                        [this](const NumericInputReturn& rc) {
+                            if (!rc.cancelled) {
+                                m_model->axis1StorePosition(rc.value);
+                            }
+                        });
                     break;
                 }
             case key::a2_i: // Input axis 2 memory value directly
                 {
                     // Note all motors will be stopped when a dialog is displayed
                     const std::string axisName = m_model->config().read("Axis2Label", "X");
-                    const auto rc = getNumericInput("Enter " + axisName + " memory value", {}, 0.0);
-                    if (!rc.cancelled) {
-                        m_model->axis2StorePosition(rc.value);
-                    }
+                    getNumericInput(
+                        "Enter " + axisName + " memory value",
+                        {},
+                        0.0,
+                        [this](const NumericInputReturn& rc) {
+                            if (!rc.cancelled) {
+                                m_model->axis2StorePosition(rc.value);
+                            }
+                        });
                     break;
                 }
             case key::ESC: // return to normal mode
                 {
+                    if (m_model->getCurrentDisplayMode() == Mode::Diagnostics) {
+                        m_model->setCurrentDisplayMode(m_model->getEnabledFunction());
+                        break;
+                    }
+                    if (m_onMotorsStopped) {
+                        // Abandon the multi-pass, rather than let it carry
+                        // on once the axes stop
+                        m_onMotorsStopped = nullptr;
+                        m_model->stopAllMotors();
+                        m_model->setMultiPassStage(MultiPassStage::NotStarted);
+                    }
                     // Cancel any retract as well
                     m_model->setIsAxis2Retracted(false);
                     m_model->changeMode(Mode::None);
@@ -856,20 +952,22 @@ void Controller::processKeyPress()
                 }
         }
     }
+    return event != key::None;
 }
 
-void Controller::waitForAxisToStop(uint8_t axis)
+void Controller::waitForMotors(std::function<void()> onStopped)
 {
-    for (;;) {
-        if (axis == 1 && !m_model->isAxis1MotorRunning()) {
-            break;
-        }
-        if (axis == 2 && !m_model->isAxis2MotorRunning()) {
-            break;
-        }
-        yieldSleep(std::chrono::microseconds(50'000));
-        m_view->updateDisplay(*m_model);
+    m_onMotorsStopped = std::move(onStopped);
+}
+
+void Controller::checkMotorsStopped()
+{
+    if (!m_onMotorsStopped || m_model->isAxis1MotorRunning() || m_model->isAxis2MotorRunning()) {
+        return;
     }
+    const auto onStopped = std::move(m_onMotorsStopped);
+    m_onMotorsStopped = nullptr;
+    onStopped();
 }
 
 int Controller::checkKeyAllowedForMode(int key)
@@ -896,6 +994,9 @@ int Controller::checkKeyAllowedForMode(int key)
         case Mode::MultiPass:
             // Now handled by new dialog
             return key;
+        case Mode::Diagnostics:
+            // Just a display, so the machine can be used as normal
+            return key;
         case Mode::Setup:
             if (key == key::LEFT || key == key::RIGHT || key == key::UP || key == key::DOWN) {
                 return key;
@@ -970,6 +1071,14 @@ int Controller::processLeaderKeyModeKeyPress(int keyPress)
             case key::M:
                 keyPress = key::f2m;
                 break;
+            case key::d:
+            case key::D:
+                keyPress = key::f2d;
+                break;
+            case key::f:
+            case key::F:
+                keyPress = key::f2f;
+                break;
             case key::q:
             case key::Q:
                 keyPress = key::f2q;
@@ -1002,12 +1111,31 @@ int Controller::checkForAxisLeaderKeys(int key)
     return key;
 }
 
-NumericInputReturn Controller::getNumericInput(
+void Controller::openDialog(Dialog dialog, std::function<void(const Input::Return&)> onClosed)
+{
+    m_model->stopAllMotors();
+    m_model->getDialog() = std::move(dialog);
+    m_onDialogClosed = std::move(onClosed);
+}
+
+void Controller::closeDialog()
+{
+    // Taken first, as the callback may well open another dialog
+    const Input::Return result = m_model->getDialog()->getResult();
+    const auto onClosed = std::move(m_onDialogClosed);
+    m_onDialogClosed = nullptr;
+    m_model->getDialog().reset();
+    if (onClosed) {
+        onClosed(result);
+    }
+}
+
+void Controller::getNumericInput(
     std::string_view prompt,
     std::vector<std::string> additionalText,
-    double defaultEntry)
+    double defaultEntry,
+    std::function<void(const NumericInputReturn&)> onEntered)
 {
-    m_model->stopAllMotors();
     std::string defaultEntryAsString = std::to_string(defaultEntry);
     // Remove excess trailing zeros after decimal point (if it exists)
     if (defaultEntryAsString.contains(".")) {
@@ -1016,31 +1144,48 @@ NumericInputReturn Controller::getNumericInput(
             defaultEntryAsString += "00";
         }
     }
-    auto rc = m_view->getInput(Input::Type::Numeric, prompt, additionalText, defaultEntryAsString);
-    return { rc.cancelled, rc.number, rc.optionsSelected };
+    openDialog(
+        Dialog(Input::Type::Numeric, prompt, std::move(additionalText), defaultEntryAsString),
+        [onEntered](const Input::Return& rc) {
+            onEntered({ rc.cancelled, rc.number, rc.optionsSelected });
+        });
 }
 
-TextInputReturn Controller::getTextInput(
+void Controller::getTextInput(
     std::string_view prompt,
     std::vector<std::string> additionalText,
-    std::string_view defaultEntry)
+    std::string_view defaultEntry,
+    std::function<void(const TextInputReturn&)> onEntered)
 {
-    m_model->stopAllMotors();
-    const auto rc = m_view->getInput(Input::Type::Text, prompt, additionalText, defaultEntry);
-    return { rc.cancelled, rc.text, rc.optionsSelected };
+    openDialog(
+        Dialog(Input::Type::Text, prompt, std::move(additionalText), defaultEntry),
+        [onEntered](const Input::Return& rc) {
+            onEntered({ rc.cancelled, rc.text, rc.optionsSelected });
+        });
 }
 
-std::optional<std::size_t>
-Controller::listPicker(std::string_view prompt, std::vector<std::string> listItems)
+void Controller::listPicker(
+    std::string_view prompt,
+    std::vector<std::string> listItems,
+    std::function<void(std::optional<std::size_t>)> onPicked)
 {
-    m_model->stopAllMotors();
-    return m_view->getInput(Input::Type::ListPicker, prompt, {}, "", listItems).pickedItem;
+    openDialog(
+        Dialog(Input::Type::ListPicker, prompt, {}, "", std::move(listItems)),
+        [onPicked](const Input::Return& rc) { onPicked(rc.pickedItem); });
 }
 
-void Controller::pressAnyKey(std::string_view prompt, std::vector<std::string> additionalText)
+void Controller::pressAnyKey(
+    std::string_view prompt,
+    std::vector<std::string> additionalText,
+    std::function<void()> onPressed)
 {
-    m_model->stopAllMotors();
-    m_view->getInput(Input::Type::PressAnyKey, prompt, additionalText, {});
+    openDialog(
+        Dialog(Input::Type::PressAnyKey, prompt, std::move(additionalText)),
+        [onPressed](const Input::Return&) {
+            if (onPressed) {
+                onPressed();
+            }
+        });
 }
 
 } // end namespace
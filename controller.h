@@ -3,6 +3,8 @@
 #include "iview.h"
 #include "model.h"
 
+#include <chrono>
+#include <functional>
 #include <memory>
 
 namespace mgo {
@@ -21,33 +23,58 @@ struct TextInputReturn {
 
 class Controller {
 public:
-    explicit Controller(Model* model);
+    Controller(Model* model, std::unique_ptr<IView> view);
     // run() is the main loop. When this returns,
     // the application can quit.
     void run();
-    void processKeyPress();
-    void waitForAxisToStop(uint8_t axis);
+    // Returns true if there was any input
+    bool processKeyPress();
 
 private:
     Model* m_model; // non-owning
     std::unique_ptr<IView> m_view;
+    // How often input is polled, and the model's status checked at least
+    std::chrono::milliseconds m_inputPoll;
+    std::chrono::milliseconds m_statusPeriod;
+    // Called when the open dialog (see Model::getDialog()) is answered
+    std::function<void(const Input::Return&)> m_onDialogClosed;
+    // Called once both axes have stopped, if something's waiting for them
+    std::function<void()> m_onMotorsStopped;
     int checkKeyAllowedForMode(int key);
     int processModeInputKeys(int key);
     int processLeaderKeyModeKeyPress(int key);
     int checkForAxisLeaderKeys(int key);
-    // While sfml_dialog getInput() is multi-functional, for
-    // ease of use we specialise calls to it by these functions.
-    NumericInputReturn getNumericInput(
+    // Dialogs don't block: each is answered a key at a time by run()'s
+    // loop, which carries on checking the model's status meanwhile, and
+    // then "onClosed" is called with the answer. All motors are stopped
+    // when a dialog is opened.
+    void openDialog(Dialog dialog, std::function<void(const Input::Return&)> onClosed);
+    void closeDialog();
+    // Nor does waiting for the axes to stop (between multi-pass cuts, say):
+    // run()'s loop carries on as usual, so ESC still stops the motors, and
+    // calls "onStopped" once neither is running
+    void waitForMotors(std::function<void()> onStopped);
+    void checkMotorsStopped();
+    // While a Dialog is multi-functional, for ease of use we specialise
+    // opening one by these functions.
+    void getNumericInput(
         std::string_view prompt,
         std::vector<std::string> additionalText,
-        double defaultEntry);
-    TextInputReturn getTextInput(
+        double defaultEntry,
+        std::function<void(const NumericInputReturn&)> onEntered);
+    void getTextInput(
         std::string_view prompt,
         std::vector<std::string> additionalText,
-        std::string_view defaultEntry = "");
-    std::optional<std::size_t>
-    listPicker(std::string_view prompt, std::vector<std::string> listItems);
-    void pressAnyKey(std::string_view prompt, std::vector<std::string> additionalText);
+        std::string_view defaultEntry,
+        std::function<void(const TextInputReturn&)> onEntered);
+    void listPicker(
+        std::string_view prompt,
+        std::vector<std::string> listItems,
+        std::function<void(std::optional<std::size_t>)> onPicked);
+    void pressAnyKey(
+        std::string_view prompt,
+        std::vector<std::string> additionalText,
+        std::function<void()> onPressed = {});
 };
 
 } // end namespace
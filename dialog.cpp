@@ -0,0 +1,173 @@
+#include "dialog.h"
+
+#include "keycodes.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+
+namespace mgo {
+
+Dialog::Dialog(
+    Input::Type type,
+    std::string_view prompt,
+    std::vector<std::string> additionalText,
+    std::string_view defaultEntry,
+    std::vector<std::string> listItems)
+    : m_type(type)
+    , m_prompt(prompt)
+    , m_text(std::move(additionalText))
+    , m_entry(defaultEntry)
+    , m_listItems(std::move(listItems))
+{
+    // Can't have both
+    assert(m_text.empty() || m_listItems.empty());
+    for (auto& line : m_text) {
+        char hotkey = 0;
+        auto pos = line.find("&");
+        if (pos != line.npos) {
+            if (pos < line.size() - 1 && !(std::isspace(line.at(pos + 1)))) {
+                hotkey = std::tolower(line.at(pos + 1));
+            }
+            line.erase(pos, 1);
+        }
+        m_hotkeys.push_back(hotkey);
+    }
+}
+
+bool Dialog::handleKey(int key)
+{
+    if (key == key::None) {
+        return false;
+    }
+    if (key == key::ESC) {
+        m_result = Input::Return();
+        return true;
+    }
+    if (m_type == Input::Type::PressAnyKey || key == key::ENTER) {
+        finish();
+        return true;
+    }
+    if (key == key::DOWN && m_listSelection + 1 < m_listItems.size()) {
+        ++m_listSelection;
+        if (m_listSelection >= m_listScrollPosition + MAX_LIST_ITEMS_IN_VIEW) {
+            ++m_listScrollPosition;
+        }
+        return false;
+    }
+    if (key == key::UP && m_listSelection > 0) {
+        --m_listSelection;
+        if (m_listSelection < m_listScrollPosition) {
+            --m_listScrollPosition;
+        }
+        return false;
+    }
+
+    // Letters toggle options if they're hot keys, with Alt, or without it
+    // when entering a number (as letters can't be part of one anyway)
+    const bool alt = (key & key::ALT) != 0;
+    const int plainKey = key & ~key::ALT;
+    if (plainKey < 128 && std::isalpha(plainKey) && (alt || m_type == Input::Type::Numeric)) {
+        const char c = std::tolower(plainKey);
+        if (std::find(m_hotkeys.begin(), m_hotkeys.end(), c) != m_hotkeys.end()) {
+            toggleOption(c);
+        }
+        return false;
+    }
+    if (alt || (m_type != Input::Type::Text && m_type != Input::Type::Numeric)) {
+        return false;
+    }
+
+    if (key == key::BACKSPACE) {
+        if (m_firstKeyPress) {
+            m_entry.clear();
+        }
+        if (!m_entry.empty()) {
+            m_entry.pop_back();
+        }
+    } else if (key > 31 && key < 128 && key != key::DELETE) { // ASCII characters
+        const char c = static_cast<char>(key);
+        // A minus sign can only start a number
+        const bool minus = c == '-' && (m_firstKeyPress || m_entry.empty());
+        if (m_type == Input::Type::Numeric && !(std::isdigit(c) || c == '.' || minus)) {
+            return false;
+        }
+        if (m_firstKeyPress) {
+            m_entry.clear();
+            m_firstKeyPress = false;
+        }
+        m_entry += c;
+    }
+    return false;
+}
+
+void Dialog::finish()
+{
+    m_result.cancelled = false;
+    m_result.pickedItem = m_listSelection;
+    m_result.text = m_entry;
+    if (m_type == Input::Type::Numeric) {
+        try {
+            m_result.number = std::stod(m_entry);
+        } catch (...) {
+            // Just leave as zero. The user is constrained to enter just
+            // numeric characters, but could enter (say) only a minus sign
+        }
+    }
+}
+
+void Dialog::toggleOption(char hotkey)
+{
+    if (m_result.optionsSelected.contains(hotkey)) {
+        m_result.optionsSelected.erase(hotkey);
+    } else {
+        m_result.optionsSelected.insert(hotkey);
+    }
+}
+
+const Input::Return& Dialog::getResult() const
+{
+    return m_result;
+}
+
+Input::Type Dialog::getType() const
+{
+    return m_type;
+}
+
+const std::string& Dialog::getPrompt() const
+{
+    return m_prompt;
+}
+
+const std::vector<std::string>& Dialog::getText() const
+{
+    return m_text;
+}
+
+const std::vector<char>& Dialog::getHotkeys() const
+{
+    return m_hotkeys;
+}
+
+const std::string& Dialog::getEntry() const
+{
+    return m_entry;
+}
+
+const std::vector<std::string>& Dialog::getListItems() const
+{
+    return m_listItems;
+}
+
+std::size_t Dialog::getListSelection() const
+{
+    return m_listSelection;
+}
+
+std::size_t Dialog::getListScrollPosition() const
+{
+    return m_listScrollPosition;
+}
+
+} // end namespace
@@ -0,0 +1,95 @@
+#pragma once
+// A dialog for the operator to answer: entering a number or some text,
+// picking one item from a list, or just pressing a key to carry on. It's
+// only a state machine, fed keys (as returned by IView::getEvents()) one at
+// a time by the controller's loop, so the model's status is still checked
+// at full rate while a dialog is open. The view draws whatever state it's
+// in, from the display snapshot.
+//
+// The additionalText strings can contain ampersands which, if directly
+// preceding a non-space character, mark a "hot key". So for example if the
+// string is "&Hello" then "Hello" is displayed and an option "h" is toggled
+// by pressing Alt-H (or just H, when entering a number).
+
+#include <cstddef>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mgo {
+
+namespace Input {
+
+enum class Type {
+    Text,
+    Numeric,
+    ListPicker,
+    PressAnyKey,
+    OkCancel
+};
+
+// What the dialog was answered with
+struct Return {
+    bool cancelled { true };
+    std::string text;
+    double number { 0.0 };
+    std::set<char> optionsSelected;
+    std::optional<std::size_t> pickedItem = std::nullopt;
+
+    bool operator==(const Return&) const = default;
+};
+
+} // namespace Input
+
+// However long the list, this many of its items are shown at once
+constexpr std::size_t MAX_LIST_ITEMS_IN_VIEW = 8;
+
+class Dialog {
+public:
+    // A dialog has either additionalText or listItems, not both
+    Dialog(
+        Input::Type type,
+        std::string_view prompt,
+        std::vector<std::string> additionalText,
+        std::string_view defaultEntry = "",
+        std::vector<std::string> listItems = {});
+
+    // Returns true once the dialog has been answered (or cancelled), when
+    // getResult() has the answer
+    bool handleKey(int key);
+    const Input::Return& getResult() const;
+
+    Input::Type getType() const;
+    const std::string& getPrompt() const;
+    // The additional text, without the ampersands
+    const std::vector<std::string>& getText() const;
+    // The hot key of each line of the additional text, or zero
+    const std::vector<char>& getHotkeys() const;
+    const std::string& getEntry() const;
+    const std::vector<std::string>& getListItems() const;
+    std::size_t getListSelection() const;
+    // The first of the list items in view
+    std::size_t getListScrollPosition() const;
+
+    bool operator==(const Dialog&) const = default;
+
+private:
+    Input::Type m_type;
+    std::string m_prompt;
+    std::vector<std::string> m_text;
+    std::vector<char> m_hotkeys;
+    std::string m_entry;
+    // The default entry is replaced by whatever's typed, rather than added to
+    bool m_firstKeyPress { true };
+    std::vector<std::string> m_listItems;
+    std::size_t m_listSelection { 0 };
+    std::size_t m_listScrollPosition { 0 };
+    Input::Return m_result;
+
+    void finish();
+    void toggleOption(char hotkey);
+};
+
+} // end namespace
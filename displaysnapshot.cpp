@@ -0,0 +1,178 @@
+#include "displaysnapshot.h"
+
+#include "threadpitches.h"
+
+#include <cmath>
+
+#include <fmt/format.h>
+
+namespace mgo {
+
+namespace {
+
+long toHundredths(double value)
+{
+    return std::lround(value * 100.0);
+}
+
+void takeThreadText(const Model& model, DisplaySnapshot& snapshot)
+{
+    const ThreadPitch tp = threadPitches.at(model.getCurrentThreadPitchIndex());
+    snapshot.modeText.clear();
+    snapshot.miscText[0] = fmt::format("Thread required: {}", tp.name);
+    snapshot.miscText[1] = fmt::format(
+        "Male   OD: {} mm, cut: {} mm, pitch: {} mm", tp.maleOd, tp.cutDepthMale, tp.pitchMm);
+    snapshot.miscText[2] = fmt::format(
+        "Female ID: {} mm, cut: {} mm, pitch {} mm", tp.femaleId, tp.cutDepthFemale, tp.pitchMm);
+}
+
+void takeModeText(const Model& model, DisplaySnapshot& snapshot)
+{
+    switch (snapshot.displayMode) {
+        // The following are all handled by the dialog:
+        case Mode::Taper:
+        case Mode::Radius:
+        case Mode::MultiPass:
+            break;
+        case Mode::Setup:
+            {
+                snapshot.modeText = "Setup";
+                snapshot.miscText[0] = "This mode allows you to determine backlash compensation";
+                snapshot.miscText[1]
+                    = "Use a dial indicator to find number of steps backlash per axis";
+                snapshot.miscText[2]
+                    = "REMEMBER to unset any previous-set backlash figures in config!";
+                snapshot.miscText[4] = fmt::format(
+                    "Z step: {}   X step: {}",
+                    model.getAxis1MotorCurrentStep(),
+                    model.getAxis2MotorCurrentStep());
+                snapshot.warning = "Press Esc to exit setup";
+                break;
+            }
+        case Mode::Diagnostics:
+            {
+                if (snapshot.showHistory) {
+                    // The plots take the place of the text
+                    snapshot.warning = "Press F2 d for figures, Esc to exit diagnostics";
+                    break;
+                }
+                const StepTimingSnapshot timing = model.getStepTiming();
+                snapshot.modeText = "Diagnostics";
+                snapshot.miscText[0]
+                    = fmt::format("Step timing: {} steps taken since startup", timing.count);
+                snapshot.miscText[1] = fmt::format(
+                    "Late by: p50 {} us, p99 {} us, max {} us",
+                    timing.percentile(0.5),
+                    timing.percentile(0.99),
+                    timing.maxMicroseconds);
+                snapshot.miscText[2] = fmt::format(
+                    "Steps more than {} us late: {}",
+                    model.getLateStepThresholdMicroseconds(),
+                    timing.lateCount);
+                std::string lostSteps;
+                if (const auto monitor = model.getAxis1LostStepMonitor()) {
+                    lostSteps = fmt::format(
+                        "   Axis1 motor vs scale: {:.3f} mm (max {:.3f} mm)",
+                        monitor->getDivergenceMm(),
+                        monitor->getMaxDivergenceMm());
+                }
+                snapshot.miscText[3] = fmt::format(
+                    "Linear scale illegal transitions: {} / {}{}",
+                    model.getLinearScaleIllegalTransitions(1),
+                    model.getLinearScaleIllegalTransitions(2),
+                    lostSteps);
+                snapshot.miscText[4] = fmt::format(
+                    "Rotary encoder glitches rejected: {}{}",
+                    model.getRotaryEncoderRejectedEdges(),
+                    model.isRotaryEncoderHighSpeed() ? " (high-speed mode)" : "");
+                snapshot.warning = "Press F2 d for plots, Esc to exit diagnostics";
+                break;
+            }
+        case Mode::Threading:
+            {
+                takeThreadText(model, snapshot);
+                break;
+            }
+        case Mode::None:
+            {
+                snapshot.warning = model.getWarning();
+                snapshot.warningBlinks = !snapshot.warning.empty();
+                break;
+            }
+    }
+    // Keep the threading data on screen if threading is enabled
+    if (snapshot.enabledFunction == Mode::Threading && snapshot.displayMode != Mode::Diagnostics) {
+        takeThreadText(model, snapshot);
+    }
+}
+
+} // end anonymous namespace
+
+DisplaySnapshot takeDisplaySnapshot(const Model& model)
+{
+    DisplaySnapshot snapshot;
+    if (model.isShuttingDown()) {
+        snapshot.shuttingDown = true;
+        return snapshot;
+    }
+
+    snapshot.axis1Position = toHundredths(model.getAxis1MotorPosition());
+    snapshot.axis1Speed = toHundredths(model.getAxis1MotorSpeed());
+    snapshot.axis1Locked = model.isAxisLocked(1);
+    snapshot.axis2Position = toHundredths(model.getAxis2MotorPosition());
+    snapshot.axis2Speed = toHundredths(model.getAxis2MotorSpeed());
+    snapshot.axis2Locked = model.isAxisLocked(2);
+    snapshot.axis2Retracted = model.getIsAxis2Retracted();
+    snapshot.retractionDirection = model.getRetractionDirection();
+
+    float rpm = model.getRotaryEncoderRpm();
+    if (rpm > 0.f) {
+        rpm = static_cast<int>(rpm / 10.f) * 10.f;
+    }
+    snapshot.rpm = static_cast<int>(rpm);
+    snapshot.rpmReversed = model.getChuckRotationDirection() == RotationDirection::reversed;
+    snapshot.chuckAngle = static_cast<int>(std::lround(model.getChuckAngle() * 10.f));
+
+    for (unsigned axis = 1; axis <= snapshot.linearScalePosition.size(); ++axis) {
+        snapshot.linearScalePosition[axis - 1]
+            = std::lround(model.getLinearScalePosMm(axis) * 1000.0);
+        snapshot.linearScaleErrors[axis - 1] = model.getLinearScaleIllegalTransitions(axis);
+    }
+
+    snapshot.generalStatus = model.getGeneralStatus();
+    snapshot.axis1Status = model.getAxis1Status();
+    snapshot.axis2Status = model.getAxis2Status();
+    snapshot.keyMode = model.getKeyMode();
+    snapshot.enabledFunction = model.getEnabledFunction();
+    snapshot.displayMode = model.getCurrentDisplayMode();
+    snapshot.showHistory = snapshot.displayMode == Mode::Diagnostics && model.getShowHistory();
+    snapshot.showProfiler = model.getShowProfiler();
+    snapshot.dialog = model.getDialog();
+    if (snapshot.enabledFunction == Mode::Taper) {
+        snapshot.taperAngle = model.getTaperAngle();
+    } else if (snapshot.enabledFunction == Mode::Radius) {
+        snapshot.radius = model.getRadius();
+    } else if (snapshot.enabledFunction == Mode::MultiPass) {
+        snapshot.stepOver = model.getStepOver();
+    }
+
+    snapshot.currentMemorySlot = model.getCurrentMemorySlot();
+    for (std::size_t n = 0; n < model.getMemorySize(); ++n) {
+        const auto axis1 = model.getAxis1MemoryAsPosition(n);
+        snapshot.axis1Memory.push_back(
+            axis1 ? std::optional<long>(toHundredths(*axis1)) : std::nullopt);
+        const auto axis2 = model.getAxis2MemoryAsPosition(n);
+        snapshot.axis2Memory.push_back(
+            axis2 ? std::optional<long>(toHundredths(*axis2)) : std::nullopt);
+    }
+
+    takeModeText(model, snapshot);
+    return snapshot;
+}
+
+std::string formatHundredths(long hundredths, std::size_t width)
+{
+    return fmt::format("{: >{}.2f}", hundredths / 100.0, width);
+}
+
+} // end namespace
@@ -0,0 +1,77 @@
+#pragma once
+// Everything the main screen shows, taken from the model in one go. Values
+// are held at the resolution they're displayed at, so two snapshots compare
+// equal whenever the screen would look the same, and the view only has to
+// redraw (and reformat the text which changed) when they don't.
+
+#include "dialog.h"
+#include "model.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace mgo {
+
+struct DisplaySnapshot {
+    bool shuttingDown { false };
+
+    // Positions and speeds are in hundredths of a mm (or mm/min)
+    long axis1Position { 0 };
+    long axis1Speed { 0 };
+    bool axis1Locked { false };
+    long axis2Position { 0 };
+    long axis2Speed { 0 };
+    bool axis2Locked { false };
+    bool axis2Retracted { false };
+    XDirection retractionDirection { XDirection::Outwards };
+
+    // Rounded down to the nearest 10 to keep the display steady
+    int rpm { 0 };
+    bool rpmReversed { false };
+    // Tenths of a degree
+    int chuckAngle { 0 };
+
+    // In thousandths of a mm, for axes 1 and 2
+    std::array<long, 2> linearScalePosition {};
+    std::array<uint32_t, 2> linearScaleErrors {};
+
+    std::string generalStatus;
+    std::string axis1Status;
+    std::string axis2Status;
+    KeyMode keyMode { KeyMode::None };
+    Mode enabledFunction { Mode::None };
+    Mode displayMode { Mode::None };
+    // Only set on the diagnostics screen, when it's showing plots
+    bool showHistory { false };
+    bool showProfiler { false };
+    // Drawn over everything else
+    std::optional<Dialog> dialog;
+    double taperAngle { 0.0 };
+    double radius { 0.0 };
+    double stepOver { 0.0 };
+
+    std::size_t currentMemorySlot { 0 };
+    // Hundredths of a mm, or nullopt if unset
+    std::vector<std::optional<long>> axis1Memory;
+    std::vector<std::optional<long>> axis2Memory;
+
+    // The text shown below the memories, which depends on the display mode
+    std::string modeText;
+    std::array<std::string, 5> miscText;
+    std::string warning;
+    // Only the model's own warnings blink, not the mode's instructions
+    bool warningBlinks { false };
+
+    bool operator==(const DisplaySnapshot&) const = default;
+};
+
+DisplaySnapshot takeDisplaySnapshot(const Model& model);
+
+// Formats a position held in hundredths of a mm
+std::string formatHundredths(long hundredths, std::size_t width);
+
+} // end namespace
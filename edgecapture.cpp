@@ -0,0 +1,105 @@
+#include "edgecapture.h"
+#include "log.h"
+
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+namespace mgo {
+
+namespace {
+
+// How often the file is written to
+constexpr std::chrono::milliseconds WRITE_INTERVAL { 10 };
+
+} // end anonymous namespace
+
+EdgeRecorder::EdgeRecorder(const std::string& filename)
+{
+    m_file.open(filename, std::ios::binary | std::ios::trunc);
+    if (!m_file) {
+        throw std::runtime_error("Could not open file " + filename + " for capturing edges");
+    }
+    m_file.write(CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+    m_thread = std::thread(&EdgeRecorder::threadFunction, this);
+}
+
+EdgeRecorder::~EdgeRecorder()
+{
+    m_terminate = true;
+    m_thread.join();
+    MGOLOG(fmt::format(
+        "Captured {} GPIO edges ({} dropped)", getRecordedEdges(), getDroppedEdges()));
+}
+
+void EdgeRecorder::record(const GpioEdge* edges, std::size_t count)
+{
+    std::size_t n = 0;
+    while (n < count && m_ring.push(GpioEdge { edges[n] })) {
+        ++n;
+    }
+    m_recorded.store(m_recorded.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    if (n < count) {
+        m_dropped.store(
+            m_dropped.load(std::memory_order_relaxed) + count - n, std::memory_order_relaxed);
+    }
+}
+
+uint64_t EdgeRecorder::getRecordedEdges() const
+{
+    return m_recorded.load(std::memory_order_relaxed);
+}
+
+uint64_t EdgeRecorder::getDroppedEdges() const
+{
+    return m_dropped.load(std::memory_order_relaxed);
+}
+
+void EdgeRecorder::threadFunction()
+{
+    std::vector<GpioEdge> buffer;
+    buffer.reserve(CAPTURE_RING_EDGES);
+    while (!m_terminate) {
+        std::this_thread::sleep_for(WRITE_INTERVAL);
+        writeQueued(buffer);
+    }
+    // Whatever arrived while we were stopping
+    writeQueued(buffer);
+    m_file.flush();
+}
+
+void EdgeRecorder::writeQueued(std::vector<GpioEdge>& buffer)
+{
+    buffer.clear();
+    while (const GpioEdge* edge = m_ring.front()) {
+        buffer.push_back(*edge);
+        m_ring.pop();
+    }
+    if (!buffer.empty()) {
+        m_file.write(
+            reinterpret_cast<const char*>(buffer.data()), buffer.size() * sizeof(GpioEdge));
+    }
+}
+
+std::vector<GpioEdge> readEdgeCapture(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Could not open edge capture " + filename);
+    }
+    char magic[sizeof(CAPTURE_MAGIC)] {};
+    file.read(magic, sizeof(magic));
+    if (!file || std::memcmp(magic, CAPTURE_MAGIC, sizeof(magic)) != 0) {
+        throw std::runtime_error(filename + " is not an edge capture");
+    }
+    std::vector<GpioEdge> edges;
+    GpioEdge edge;
+    while (file.read(reinterpret_cast<char*>(&edge), sizeof(edge))) {
+        edges.push_back(edge);
+    }
+    return edges;
+}
+
+} // end namespace
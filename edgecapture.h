@@ -0,0 +1,61 @@
+#pragma once
+// Captures the GPIO edges the rotary encoder and linear scales are given, so
+// a real run (spindle noise and all) can be replayed later on a desktop (see
+// ReplayGpio) to reproduce problems and to try out decoder changes.
+// A capture file is CAPTURE_MAGIC followed by GpioEdge records, appended
+// as they arrive; a run that ends abruptly loses at most its last moments.
+
+#include "gpioedge.h"
+#include "spscqueue.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mgo {
+
+constexpr char CAPTURE_MAGIC[8] = { 'L', 'C', 'E', 'D', 'G', 'E', 'S', '1' };
+// About half a second of edges at full speed; must be a power of two
+constexpr std::size_t CAPTURE_RING_EDGES = 65'536;
+
+static_assert(sizeof(GpioEdge) == 12, "capture files hold GpioEdge as it is laid out");
+
+class EdgeRecorder {
+public:
+    // Throws if the file can't be created
+    explicit EdgeRecorder(const std::string& filename);
+    // Writes out everything recorded so far
+    ~EdgeRecorder();
+
+    EdgeRecorder(const EdgeRecorder&) = delete;
+    EdgeRecorder& operator=(const EdgeRecorder&) = delete;
+
+    // From the GPIO library's callback thread only (with pigpio, every
+    // consumer is called back from the same thread). Never blocks: if the
+    // file can't keep up, edges are dropped (and counted).
+    void record(const GpioEdge* edges, std::size_t count);
+
+    uint64_t getRecordedEdges() const;
+    uint64_t getDroppedEdges() const;
+
+private:
+    std::ofstream m_file;
+    SpscQueue<GpioEdge, CAPTURE_RING_EDGES> m_ring;
+    std::atomic<uint64_t> m_recorded { 0 };
+    std::atomic<uint64_t> m_dropped { 0 };
+    std::atomic<bool> m_terminate { false };
+    std::thread m_thread;
+
+    void threadFunction();
+    void writeQueued(std::vector<GpioEdge>& buffer);
+};
+
+// Reads a whole capture file. Throws if it isn't one. A partial record at
+// the end (from a run that was cut short) is ignored.
+std::vector<GpioEdge> readEdgeCapture(const std::string& filename);
+
+} // end namespace
@@ -0,0 +1,161 @@
+#include "electronicleadscrew.h"
+
+#include <cmath>
+#include <limits>
+
+namespace mgo {
+
+namespace {
+
+// If there's a longer gap than this between pulses the spindle has only just
+// started (or was stopped), so there's nothing useful to interpolate from
+constexpr uint32_t MAX_INTERPOLATION_MICROSECONDS = 100'000;
+
+} // end anonymous namespace
+
+Ratio approximateRatio(double value, long maxDenominator)
+{
+    // Successive convergents h/k of the continued fraction for value
+    long h0 = 0;
+    long h1 = 1;
+    long k0 = 1;
+    long k1 = 0;
+    double remainder = value;
+    for (;;) {
+        const double whole = std::floor(remainder);
+        if (whole > std::numeric_limits<long>::max() / 2) {
+            break;
+        }
+        const long a = static_cast<long>(whole);
+        if (k1 != 0 && a > (maxDenominator - k0) / k1) {
+            break;
+        }
+        const long h2 = a * h1 + h0;
+        const long k2 = a * k1 + k0;
+        h0 = h1;
+        h1 = h2;
+        k0 = k1;
+        k1 = k2;
+        const double fraction = remainder - whole;
+        if (fraction < 1e-9 || std::abs(value - static_cast<double>(h1) / k1) < 1e-12) {
+            break;
+        }
+        remainder = 1.0 / fraction;
+    }
+    if (k1 == 0) {
+        return { std::lround(value), 1 };
+    }
+    return { h1, k1 };
+}
+
+ElectronicLeadscrew::ElectronicLeadscrew(uint32_t latencyMicroseconds)
+    : m_latencyMicroseconds(latencyMicroseconds)
+{
+}
+
+void ElectronicLeadscrew::setRatio(Ratio stepsPerPulse)
+{
+    m_numerator = stepsPerPulse.numerator;
+    m_denominator = stepsPerPulse.denominator;
+}
+
+Ratio ElectronicLeadscrew::getRatio() const
+{
+    return { m_numerator, m_denominator };
+}
+
+uint32_t ElectronicLeadscrew::getLatencyMicroseconds() const
+{
+    return m_latencyMicroseconds;
+}
+
+bool ElectronicLeadscrew::isEngaged() const
+{
+    return m_engaged;
+}
+
+long ElectronicLeadscrew::getOverruns() const
+{
+    return m_overruns;
+}
+
+void ElectronicLeadscrew::pulse(bool forward, uint32_t tick)
+{
+    const uint32_t lastTick = m_lastTick;
+    const uint32_t interval = tick - lastTick; // don't need to worry about wrap
+    m_lastTick = tick;
+    if (!m_engaged) {
+        return;
+    }
+    const uint32_t generation = m_generation;
+    if (generation != m_seenGeneration) {
+        m_seenGeneration = generation;
+        m_accumulator = 0;
+    }
+    const long numerator = m_numerator;
+    const long denominator = m_denominator;
+    if (numerator <= 0 || denominator <= 0) {
+        return;
+    }
+    // Over the interval since the last pulse the accumulator has moved from
+    // "before" to "after", and a step was due wherever it crossed a multiple
+    // of the denominator. We place each step that far through the interval.
+    const long before = m_accumulator;
+    const bool interpolate = interval < MAX_INTERPOLATION_MICROSECONDS;
+    auto stepTick = [&](long distance) {
+        if (!interpolate) {
+            return tick;
+        }
+        return lastTick
+            + static_cast<uint32_t>(static_cast<int64_t>(interval) * distance / numerator);
+    };
+    if (forward) {
+        const long after = before + numerator;
+        long crossing = denominator;
+        for (; crossing <= after; crossing += denominator) {
+            queueStep(stepTick(crossing - before), true);
+        }
+        m_accumulator = after - (crossing - denominator);
+    } else {
+        const long after = before - numerator;
+        long crossing = 0;
+        for (; crossing > after; crossing -= denominator) {
+            queueStep(stepTick(before - crossing), false);
+        }
+        m_accumulator = after - crossing;
+    }
+}
+
+void ElectronicLeadscrew::queueStep(uint32_t tick, bool forward)
+{
+    if (!m_steps.push({ tick + m_latencyMicroseconds, forward })) {
+        ++m_overruns;
+    }
+}
+
+void ElectronicLeadscrew::engage()
+{
+    ++m_generation;
+    // Drop anything left over from last time
+    while (nextStep()) {
+        popStep();
+    }
+    m_engaged = true;
+}
+
+void ElectronicLeadscrew::disengage()
+{
+    m_engaged = false;
+}
+
+const ElectronicLeadscrew::Step* ElectronicLeadscrew::nextStep()
+{
+    return m_steps.front();
+}
+
+void ElectronicLeadscrew::popStep()
+{
+    m_steps.pop();
+}
+
+} // end namespace
@@ -0,0 +1,83 @@
+#pragma once
+// An electronic leadscrew, which gears a motor to the spindle for cutting
+// threads. Every pulse from the spindle's rotary encoder adds a fixed
+// fraction of a step (numerator / denominator) to an accumulator, and a step
+// is due each time it overflows. Because that's done in integers there is no
+// rounding drift however long the cut is, and because steps come from the
+// encoder's edges (rather than from an averaged RPM) the pitch stays locked
+// to the spindle however its speed varies under load.
+// Each step is timed by interpolating between the edges which bracket it,
+// and is taken by the motion controller's thread a fixed latency after that.
+// The latency hides the batching of the GPIO library's callbacks, which
+// would otherwise have the motor taking its steps in bursts.
+
+#include "spscqueue.h"
+
+#include <atomic>
+#include <cstdint>
+
+namespace mgo {
+
+struct Ratio {
+    long numerator;
+    long denominator;
+};
+
+// The closest fraction to "value" (which must not be negative) with a
+// denominator no larger than maxDenominator, found by continued fractions.
+// So for example steps-per-pulse ratios like 3/7 are represented exactly.
+Ratio approximateRatio(double value, long maxDenominator = 1'000'000);
+
+// Needs to be enough for all of the steps that can be due within the latency
+constexpr std::size_t MAX_LEADSCREW_STEPS = 1'024;
+
+class ElectronicLeadscrew {
+public:
+    struct Step {
+        uint32_t tick;  // when the step is due, in GPIO ticks (microseconds)
+        bool forward;   // i.e. the spindle is turning in its normal direction
+    };
+
+    explicit ElectronicLeadscrew(uint32_t latencyMicroseconds = 2'000);
+
+    ElectronicLeadscrew(const ElectronicLeadscrew&) = delete;
+    ElectronicLeadscrew& operator=(const ElectronicLeadscrew&) = delete;
+
+    // Steps per encoder pulse. Only change this while disengaged.
+    void setRatio(Ratio stepsPerPulse);
+    Ratio getRatio() const;
+    uint32_t getLatencyMicroseconds() const;
+    bool isEngaged() const;
+    // Steps which were lost because the motor couldn't keep up
+    long getOverruns() const;
+
+    // Called from the rotary encoder's callback for every pulse it counts
+    void pulse(bool forward, uint32_t tick);
+
+    // Called from the motion controller's thread. Steps are only generated
+    // while engaged, and the accumulator starts from empty each time.
+    void engage();
+    void disengage();
+    const Step* nextStep();
+    void popStep();
+
+private:
+    const uint32_t m_latencyMicroseconds;
+    std::atomic<long> m_numerator { 0 };
+    std::atomic<long> m_denominator { 1 };
+    std::atomic<bool> m_engaged { false };
+    // Incremented on each engagement, so the encoder's thread knows to
+    // reset its accumulator
+    std::atomic<uint32_t> m_generation { 0 };
+    std::atomic<long> m_overruns { 0 };
+    SpscQueue<Step, MAX_LEADSCREW_STEPS> m_steps;
+
+    // Only touched by the encoder's thread
+    uint32_t m_seenGeneration { 0 };
+    long m_accumulator { 0 };
+    uint32_t m_lastTick { 0 };
+
+    void queueStep(uint32_t tick, bool forward);
+};
+
+} // end namespace
@@ -0,0 +1,42 @@
+#pragma once
+// The GPIO library reports edges about once a millisecond, in batches. Rather
+// than handle each edge through its own callback, consumers (the rotary
+// encoder and linear scales) can be given a whole batch as a contiguous array
+// and decode it in one loop, publishing their results once per batch.
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mgo {
+
+struct GpioEdge {
+    int32_t pin;
+    int32_t level;
+    uint32_t tick; // microseconds
+};
+
+// For registering a consumer of whole batches
+using GpioEdgeBatchCallback = void (*)(const GpioEdge* edges, std::size_t count, void* userData);
+
+// IGpio has no way of cancelling a per-edge callback, so consumers which
+// are destroyed before the GPIO library replace theirs with this
+inline void ignoreGpioEdge(int, int, uint32_t, void*) { }
+
+// Implemented (alongside IGpio) by GPIO libraries which can deliver edges in
+// batches: BatchingGpio on the Pi and ReplayGpio when replaying a capture.
+// Consumers use it if it's there, otherwise they register with IGpio for one
+// callback per edge, as they do with MockGpio (which simulates one edge at a
+// time). Several consumers can register, each for its own pair of pins,
+// and each is only given the edges on those pins.
+class IGpioEdgeBatches {
+public:
+    virtual void setEdgeBatchCallback(
+        int pinA, int pinB, GpioEdgeBatchCallback callback, void* userData)
+        = 0;
+    // Once this returns, the callback registered with "userData" won't be
+    // called again
+    virtual void removeEdgeBatchCallback(void* userData) = 0;
+    virtual ~IGpioEdgeBatches() = default;
+};
+
+} // end namespace
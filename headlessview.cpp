@@ -0,0 +1,55 @@
+#include "headlessview.h"
+
+#include "keycodes.h"
+
+namespace mgo {
+
+HeadlessView::HeadlessView(std::vector<int> script, bool recordFrames)
+    : m_script(std::move(script))
+    , m_recordFrames(recordFrames)
+{
+    // So recording doesn't allocate while the controller is being timed
+    m_eventTimes.reserve(m_script.size() + 1);
+}
+
+int HeadlessView::getEvents()
+{
+    m_eventTimes.push_back(std::chrono::steady_clock::now());
+    const int key = m_next < m_script.size() ? m_script[m_next++] : key::CtrlQ;
+    if (key != key::None && m_keyCallback) {
+        m_keyCallback(key);
+    }
+    return key;
+}
+
+void HeadlessView::updateDisplay(const Model& model)
+{
+    // Taken whether it's kept or not, as ViewSfml takes one too
+    DisplaySnapshot snapshot = takeDisplaySnapshot(model);
+    ++m_frameCount;
+    if (m_recordFrames) {
+        m_frames.push_back(std::move(snapshot));
+    }
+}
+
+void HeadlessView::setKeyCallback(std::function<void(int)> callback)
+{
+    m_keyCallback = std::move(callback);
+}
+
+const std::vector<std::chrono::steady_clock::time_point>& HeadlessView::getEventTimes() const
+{
+    return m_eventTimes;
+}
+
+std::size_t HeadlessView::getFrameCount() const
+{
+    return m_frameCount;
+}
+
+const std::vector<DisplaySnapshot>& HeadlessView::getFrames() const
+{
+    return m_frames;
+}
+
+} // end namespace
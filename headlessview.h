@@ -0,0 +1,49 @@
+#pragma once
+// An IView with no display at all, so the controller's loop can be run
+// without one (e.g. to benchmark it). Input, including the answers to any
+// dialogs, comes from a script, and each frame the controller asks for is
+// recorded rather than drawn.
+
+#include "displaysnapshot.h"
+#include "iview.h"
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace mgo {
+
+class HeadlessView final : public IView {
+public:
+    // getEvents() returns the script's keys one per call, in order (so
+    // key::None means a call with no input). Once the script has run out,
+    // it returns key::CtrlQ so the controller quits.
+    explicit HeadlessView(std::vector<int> script, bool recordFrames = false);
+
+    void initialise(const Model&) override { }
+    void close() override { }
+    int getEvents() override;
+    void updateDisplay(const Model& model) override;
+
+    // Called (from getEvents()) with each key just before it's returned
+    void setKeyCallback(std::function<void(int)> callback);
+
+    // When each call to getEvents() was made, i.e. when each of the
+    // controller's iterations started
+    const std::vector<std::chrono::steady_clock::time_point>& getEventTimes() const;
+    std::size_t getFrameCount() const;
+    // Empty unless frames are being recorded
+    const std::vector<DisplaySnapshot>& getFrames() const;
+
+private:
+    std::vector<int> m_script;
+    std::size_t m_next { 0 };
+    bool m_recordFrames;
+    std::function<void(int)> m_keyCallback;
+    std::vector<std::chrono::steady_clock::time_point> m_eventTimes;
+    std::size_t m_frameCount { 0 };
+    std::vector<DisplaySnapshot> m_frames;
+};
+
+} // end namespace
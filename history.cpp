@@ -0,0 +1,79 @@
+#include "history.h"
+
+#include <algorithm>
+
+namespace mgo {
+
+History::~History()
+{
+    stop();
+}
+
+void History::start(std::chrono::milliseconds period, std::function<HistorySample()> read)
+{
+    m_period = period.count();
+    m_thread = std::thread([this, period, read]() {
+        auto next = std::chrono::steady_clock::now();
+        while (!m_terminate) {
+            next += period;
+            std::this_thread::sleep_until(next);
+            record(read());
+        }
+    });
+}
+
+void History::stop()
+{
+    m_terminate = true;
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+std::chrono::milliseconds History::getPeriod() const
+{
+    return std::chrono::milliseconds(m_period);
+}
+
+void History::record(const HistorySample& sample)
+{
+    const std::size_t count = m_count.load(std::memory_order_relaxed);
+    auto& slot = m_ring[count & (HISTORY_SAMPLES - 1)];
+    for (std::size_t channel = 0; channel < HISTORY_CHANNELS; ++channel) {
+        slot[channel].store(sample[channel], std::memory_order_relaxed);
+    }
+    m_count.store(count + 1, std::memory_order_release);
+}
+
+std::size_t History::getCount() const
+{
+    return m_count.load(std::memory_order_acquire);
+}
+
+std::size_t History::read(std::size_t from, std::vector<HistorySample>& samples) const
+{
+    const std::size_t count = m_count.load(std::memory_order_acquire);
+    // While sample "count" is being recorded, it's overwriting the oldest
+    const std::size_t first
+        = std::max(from, count >= HISTORY_SAMPLES ? count - HISTORY_SAMPLES + 1 : 0);
+    const std::size_t start = samples.size();
+    for (std::size_t n = first; n < count; ++n) {
+        const auto& slot = m_ring[n & (HISTORY_SAMPLES - 1)];
+        HistorySample& sample = samples.emplace_back();
+        for (std::size_t channel = 0; channel < HISTORY_CHANNELS; ++channel) {
+            sample[channel] = slot[channel].load(std::memory_order_relaxed);
+        }
+    }
+    // Any samples which were overwritten while we were reading them are
+    // dropped, oldest first
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const std::size_t countAfter = m_count.load(std::memory_order_relaxed);
+    if (countAfter >= HISTORY_SAMPLES && countAfter - HISTORY_SAMPLES + 1 > first) {
+        const std::size_t overwritten
+            = std::min(countAfter - HISTORY_SAMPLES + 1 - first, samples.size() - start);
+        samples.erase(samples.begin() + start, samples.begin() + start + overwritten);
+    }
+    return count;
+}
+
+} // end namespace
@@ -0,0 +1,74 @@
+#pragma once
+// The recent history of the spindle's speed and the axes' speeds and
+// positions, for plotting. Samples are taken at a fixed rate by a thread of
+// their own, so they're evenly spaced however busy the UI is, and kept in a
+// fixed-size ring which any thread can read from without ever blocking (or
+// being blocked by) the sampling thread.
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace mgo {
+
+enum class HistoryChannel {
+    Rpm,
+    Axis1Speed, // mm/min
+    Axis2Speed,
+    Axis1Position, // mm
+    Axis2Position
+};
+
+constexpr std::size_t HISTORY_CHANNELS = 5;
+// Must be a power of two
+constexpr std::size_t HISTORY_SAMPLES = 4'096;
+
+// Indexed by HistoryChannel
+using HistorySample = std::array<float, HISTORY_CHANNELS>;
+
+class History {
+public:
+    History() = default;
+    ~History();
+
+    History(const History&) = delete;
+    History& operator=(const History&) = delete;
+
+    // Records whatever "read" returns every "period" until stopped (or
+    // destroyed)
+    void start(std::chrono::milliseconds period, std::function<HistorySample()> read);
+    // Waits for the sampling thread to finish, so whatever "read" uses can
+    // then be safely destroyed. The samples taken are kept, but sampling
+    // can't be started again.
+    void stop();
+    // Zero if not started
+    std::chrono::milliseconds getPeriod() const;
+
+    // Only to be called by one thread at a time (start() does this for us)
+    void record(const HistorySample& sample);
+
+    // How many samples have been recorded since startup; the most recent
+    // HISTORY_SAMPLES of them are kept
+    std::size_t getCount() const;
+
+    // Appends the samples numbered from "from" onwards (up to the newest) to
+    // "samples", skipping any which are no longer kept. Returns the number
+    // of the sample after the newest, i.e. where to read from next time.
+    std::size_t read(std::size_t from, std::vector<HistorySample>& samples) const;
+
+private:
+    // Each value is atomic so samples can be read while the ring's being
+    // written to; the count says which of them are whole
+    std::array<std::array<std::atomic<float>, HISTORY_CHANNELS>, HISTORY_SAMPLES> m_ring {};
+    std::atomic<std::size_t> m_count { 0 };
+
+    std::atomic<std::chrono::milliseconds::rep> m_period { 0 };
+    std::atomic<bool> m_terminate { false };
+    std::thread m_thread;
+};
+
+} // end namespace
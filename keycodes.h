@@ -165,6 +165,8 @@ constexpr int f2r = 7004; // X retraction mode
 constexpr int f2o = 7005; // radius mode
 constexpr int f2q = 7006; // quit (i.e. :q)
 constexpr int f2m = 7007; // multipass
+constexpr int f2d = 7008; // diagnostics
+constexpr int f2f = 7009; // frame (i.e. control loop) timings
 
 // Joystick specific "keys"
 // Note some joystick commands just return regular keycodes.
@@ -1,38 +1,93 @@
 #include "linearscale.h"
+#include "edgecapture.h"
+
+#include <array>
+#include <cmath>
 
 namespace mgo {
 
+namespace {
+
+// x4 quadrature decoding: the change in step count for each transition,
+// indexed by the previous levels and the new ones (A in bit 1, B in bit 0).
+// Every edge should change exactly one pin, so ILLEGAL means we've missed
+// at least one edge: either both pins changed at once, or neither did.
+constexpr int8_t ILLEGAL = 2;
+constexpr std::array<int8_t, 16> TRANSITIONS {
+    //  to 00   01       10       11
+    ILLEGAL, -1,      1,       ILLEGAL, // from 00
+    1,       ILLEGAL, ILLEGAL, -1,      // from 01
+    -1,      ILLEGAL, ILLEGAL, 1,       // from 10
+    ILLEGAL, 1,       -1,      ILLEGAL  // from 11
+};
+
+} // end anonymous namespace
+
 void LinearScale::staticCallback(int pin, int level, uint32_t tick, void* userData)
 {
     LinearScale* self = reinterpret_cast<LinearScale*>(userData);
     self->callback(pin, level, tick);
 }
 
-void LinearScale::callback(int pin, int level, uint32_t /*tick*/)
+void LinearScale::staticBatchCallback(const GpioEdge* edges, std::size_t count, void* userData)
+{
+    LinearScale* self = reinterpret_cast<LinearScale*>(userData);
+    self->onEdges(edges, count);
+}
+
+void LinearScale::callback(int pin, int level, uint32_t tick)
+{
+    const GpioEdge edge { pin, level, tick };
+    onEdges(&edge, 1);
+}
+
+void LinearScale::onEdges(const GpioEdge* edges, std::size_t count)
 {
-    if (pin == m_lastPin) {
-        // debounce
-        return;
+    m_callbackThreadPlacement.apply();
+    if (EdgeRecorder* recorder = m_recorder) {
+        recorder->record(edges, count);
     }
-    m_lastPin = pin;
-    if (pin == m_pinA) {
-        m_levelA = level;
+    int32_t steps = 0;
+    uint32_t illegal = 0;
+    for (std::size_t n = 0; n < count; ++n) {
+        steps += decode(edges[n].pin, edges[n].level, illegal);
+    }
+    if (steps != 0) {
+        m_stepCount.store(
+            m_stepCount.load(std::memory_order_relaxed) + steps, std::memory_order_relaxed);
     }
-    if (pin == m_pinB) {
-        m_levelB = level;
+    if (illegal != 0) {
+        m_illegalTransitions.store(
+            m_illegalTransitions.load(std::memory_order_relaxed) + illegal,
+            std::memory_order_relaxed);
     }
-    int currentPhase = m_levelA ? (m_levelB ? 3 : 4) : (m_levelB ? 2 : 1);
+}
 
-    if (m_previousPhase == 4 && currentPhase == 1) {
-        --m_stepCount;
-    } else if (m_previousPhase == 1 && currentPhase == 4) {
-        ++m_stepCount;
-    } else if (currentPhase > m_previousPhase) {
-        --m_stepCount;
-    } else if (currentPhase < m_previousPhase) {
-        ++m_stepCount;
+// Returns the change in step count (-1, 0 or 1)
+int32_t LinearScale::decode(int pin, int level, uint32_t& illegal)
+{
+    unsigned bit = 0;
+    if (pin == m_pinA) {
+        bit = 2;
+    } else if (pin == m_pinB) {
+        bit = 1;
+    }
+    if (bit == 0 || (level != 0 && level != 1)) {
+        // Not ours, or not an edge (e.g. a watchdog timeout)
+        return 0;
     }
-    m_previousPhase = currentPhase;
+    const unsigned previous = m_levels;
+    m_levels = level ? (previous | bit) : (previous & ~bit);
+    if (m_knownLevels != 3) {
+        m_knownLevels |= bit;
+        return 0;
+    }
+    const int8_t step = TRANSITIONS[(previous << 2) | m_levels];
+    if (step == ILLEGAL) {
+        ++illegal;
+        return 0;
+    }
+    return step;
 }
 
 float LinearScale::getPositionInMm()
@@ -42,7 +97,12 @@ float LinearScale::getPositionInMm()
 
 void LinearScale::setZeroMm()
 {
-    m_zeroPosition = m_stepCount;
+    m_zeroPosition = m_stepCount.load();
+}
+
+void LinearScale::setPositionMm(double mm)
+{
+    m_zeroPosition = m_stepCount - static_cast<int32_t>(std::lround(mm * m_stepsPerMm));
 }
 
 } // end namespace
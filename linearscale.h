@@ -1,47 +1,109 @@
 #pragma once
 // This class is used to read and respond to a linear
 // scale, used to determine the position of the tool on an axis
-// (currently just the Z-axis)
 
+#include "gpioedge.h"
+#include "realtime.h"
 #include "stepperControl/igpio.h"
 
+#include <atomic>
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
 
 namespace mgo {
 
+class EdgeRecorder;
+
 class LinearScale {
 public:
-    LinearScale(IGpio& gpio, int pinA, int pinB, int stepsPerMm)
+    // Check canAttach() first for any axis but axis 1
+    LinearScale(IGpio& gpio, int pinA, int pinB, int stepsPerMm, unsigned axis = 1)
         : m_gpio(gpio)
         , m_pinA(pinA)
         , m_pinB(pinB)
         , m_stepsPerMm(stepsPerMm)
     {
         assert(pinA != pinB);
-        m_gpio.setLinearScaleAxis1Callback(m_pinA, m_pinB, staticCallback, this);
+        assert(canAttach(gpio, axis));
+        if (auto batches = dynamic_cast<IGpioEdgeBatches*>(&m_gpio)) {
+            batches->setEdgeBatchCallback(m_pinA, m_pinB, staticBatchCallback, this);
+        } else {
+            m_gpio.setLinearScaleAxis1Callback(m_pinA, m_pinB, staticCallback, this);
+        }
+    }
+
+    ~LinearScale()
+    {
+        if (auto batches = dynamic_cast<IGpioEdgeBatches*>(&m_gpio)) {
+            batches->removeEdgeBatchCallback(this);
+        } else {
+            m_gpio.setLinearScaleAxis1Callback(m_pinA, m_pinB, ignoreGpioEdge, nullptr);
+        }
+    }
+
+    LinearScale(const LinearScale&) = delete;
+    LinearScale& operator=(const LinearScale&) = delete;
+
+    // Whether the GPIO library can give us the edges for a scale on this
+    // axis. Only axis 1 has a dedicated callback in IGpio, so others need
+    // a library which supports any pins (see IGpioEdgeBatches), which on
+    // the Pi is BatchingGpio.
+    static bool canAttach(IGpio& gpio, unsigned axis)
+    {
+        return axis == 1 || dynamic_cast<IGpioEdgeBatches*>(&gpio) != nullptr;
     }
 
     static void staticCallback(int pin, int level, uint32_t tick, void* userData);
+    static void staticBatchCallback(const GpioEdge* edges, std::size_t count, void* userData);
 
     void callback(int pin, int level, uint32_t tick);
+    // Decodes a batch of edges (in the order they happened)
+    void onEdges(const GpioEdge* edges, std::size_t count);
 
     float getPositionInMm();
 
+    // Transitions where both pins changed at once, i.e. an edge was missed
+    // (so the position could be out by a step or two)
+    uint32_t getIllegalTransitions() const
+    {
+        return m_illegalTransitions;
+    }
+
     // Sets the current step position as zero
     void setZeroMm();
+    // Sets the current step position as "mm"
+    void setPositionMm(double mm);
+
+    // Used to place the thread which calls us back
+    DeferredPlacement& callbackThreadPlacement()
+    {
+        return m_callbackThreadPlacement;
+    }
+
+    // Every edge we're given is also recorded (if there's a recorder)
+    void setRecorder(EdgeRecorder* recorder)
+    {
+        m_recorder = recorder;
+    }
 
 private:
     IGpio& m_gpio;
     int m_pinA;
     int m_pinB;
-    int m_levelA { 0 };
-    int m_levelB { 0 };
-    int m_lastPin { 0 };
     int m_stepsPerMm { 200 };
-    int32_t m_stepCount { 0 };
-    int m_previousPhase { 0 };
-    int32_t m_zeroPosition { 0 }; // the step count which is counted as 0.00 mm
+    // The pins' levels, as bit 1 (A) and bit 0 (B). We don't know them until
+    // each pin has had an edge, and until then we can't decode anything.
+    unsigned m_levels { 0 };
+    unsigned m_knownLevels { 0 };
+    // Written once per batch of edges by the callback's thread
+    std::atomic<int32_t> m_stepCount { 0 };
+    std::atomic<uint32_t> m_illegalTransitions { 0 };
+    std::atomic<int32_t> m_zeroPosition { 0 }; // the step count which is counted as 0.00 mm
+    std::atomic<EdgeRecorder*> m_recorder { nullptr };
+    DeferredPlacement m_callbackThreadPlacement;
+
+    int32_t decode(int pin, int level, uint32_t& illegal);
 };
 
 } // end namespace
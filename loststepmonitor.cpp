@@ -0,0 +1,103 @@
+#include "loststepmonitor.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace mgo {
+
+LostStepMonitor::LostStepMonitor(double mmPerStep, const LostStepLimits& limits)
+    : m_mmPerStep(mmPerStep)
+    , m_limits(limits)
+{
+}
+
+LostStepMonitor::~LostStepMonitor()
+{
+    m_terminate = true;
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void LostStepMonitor::start(
+    std::chrono::milliseconds period,
+    std::function<long()> readStep,
+    std::function<double()> readScaleMm,
+    std::function<void()> onLostSteps)
+{
+    m_thread = std::thread([=, this]() {
+        auto next = std::chrono::steady_clock::now();
+        while (!m_terminate) {
+            next += period;
+            std::this_thread::sleep_until(next);
+            if (sample(readStep(), readScaleMm())) {
+                onLostSteps();
+            }
+        }
+    });
+}
+
+bool LostStepMonitor::sample(long motorStep, double scaleMm)
+{
+    const double differenceMm = scaleMm - motorStep * m_mmPerStep;
+    if (m_rebaseline.exchange(false)) {
+        m_baselineMm = differenceMm;
+        m_samplesOver = 0;
+    }
+    const double divergence = differenceMm - m_baselineMm;
+    m_divergenceMm = divergence;
+    if (std::abs(divergence) > m_maxDivergenceMm) {
+        m_maxDivergenceMm = std::abs(divergence);
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_historyMutex);
+        m_history[m_historyCount & (LOST_STEP_HISTORY_SAMPLES - 1)]
+            = static_cast<float>(divergence);
+        ++m_historyCount;
+    }
+    if (std::abs(divergence) <= m_limits.thresholdMm) {
+        m_samplesOver = 0;
+        return false;
+    }
+    if (++m_samplesOver < m_limits.samples) {
+        return false;
+    }
+    m_baselineMm = differenceMm;
+    m_samplesOver = 0;
+    ++m_losses;
+    return true;
+}
+
+void LostStepMonitor::rebaseline()
+{
+    m_rebaseline = true;
+}
+
+uint32_t LostStepMonitor::getLosses() const
+{
+    return m_losses;
+}
+
+double LostStepMonitor::getDivergenceMm() const
+{
+    return m_divergenceMm;
+}
+
+double LostStepMonitor::getMaxDivergenceMm() const
+{
+    return m_maxDivergenceMm;
+}
+
+std::vector<float> LostStepMonitor::getHistory() const
+{
+    std::lock_guard<std::mutex> lock(m_historyMutex);
+    const std::size_t count = std::min(m_historyCount, LOST_STEP_HISTORY_SAMPLES);
+    std::vector<float> history;
+    history.reserve(count);
+    for (std::size_t n = m_historyCount - count; n < m_historyCount; ++n) {
+        history.push_back(m_history[n & (LOST_STEP_HISTORY_SAMPLES - 1)]);
+    }
+    return history;
+}
+
+} // end namespace
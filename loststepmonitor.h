@@ -0,0 +1,85 @@
+#pragma once
+// Watches for an axis losing steps (e.g. a stalled leadscrew) by comparing
+// where its motor thinks it is with where its linear scale says it is. The
+// two needn't agree, but the difference between them shouldn't change: if
+// it does by more than a threshold, for long enough that it isn't just the
+// scale's readings lagging behind, steps have been lost.
+// Samples are taken by a thread of its own, at normal (not real-time)
+// priority, so the check carries on whatever the UI is doing.
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mgo {
+
+// Must be a power of two
+constexpr std::size_t LOST_STEP_HISTORY_SAMPLES = 1'024;
+
+struct LostStepLimits {
+    double thresholdMm { 0.1 };
+    // How many samples in a row must be over the threshold
+    unsigned samples { 3 };
+};
+
+class LostStepMonitor {
+public:
+    LostStepMonitor(double mmPerStep, const LostStepLimits& limits);
+    ~LostStepMonitor();
+
+    LostStepMonitor(const LostStepMonitor&) = delete;
+    LostStepMonitor& operator=(const LostStepMonitor&) = delete;
+
+    // Samples every "period" until destroyed, calling onLostSteps (from the
+    // monitor's thread) whenever steps are found to have been lost
+    void start(
+        std::chrono::milliseconds period,
+        std::function<long()> readStep,
+        std::function<double()> readScaleMm,
+        std::function<void()> onLostSteps);
+
+    // Takes one sample (start() does this for us). Returns true if steps
+    // have been lost; the difference then becomes the new normal, so the
+    // same loss isn't reported again.
+    bool sample(long motorStep, double scaleMm);
+
+    // Call whenever the motor's or scale's position is set, as the
+    // difference between them changes then without any steps being lost
+    void rebaseline();
+
+    // How many times steps have been lost
+    uint32_t getLosses() const;
+    // How far the difference has moved since the baseline, now and at
+    // most (since startup)
+    double getDivergenceMm() const;
+    double getMaxDivergenceMm() const;
+    // The divergence at each of the most recent samples, oldest first
+    std::vector<float> getHistory() const;
+
+private:
+    double m_mmPerStep;
+    LostStepLimits m_limits;
+    std::atomic<bool> m_rebaseline { true };
+    // Only touched by whichever thread is sampling
+    double m_baselineMm { 0.0 };
+    unsigned m_samplesOver { 0 };
+
+    std::atomic<uint32_t> m_losses { 0 };
+    std::atomic<double> m_divergenceMm { 0.0 };
+    std::atomic<double> m_maxDivergenceMm { 0.0 };
+
+    mutable std::mutex m_historyMutex;
+    std::array<float, LOST_STEP_HISTORY_SAMPLES> m_history {};
+    std::size_t m_historyCount { 0 };
+
+    std::atomic<bool> m_terminate { false };
+    std::thread m_thread;
+};
+
+} // end namespace
@@ -1,15 +1,18 @@
 #ifdef FAKE
+#include "replaygpio.h"
 #include "stepperControl/mockgpio.h"
 #else
-#include "stepperControl/gpio.h"
+#include "batchinggpio.h"
 #endif
 
 #include "configreader.h"
 #include "controller.h"
 #include "log.h"
 #include "model.h"
+#include "view_sfml.h"
 
 #include <iostream>
+#include <memory>
 #include <sysexits.h>
 
 int main(int argc, char* argv[])
@@ -31,15 +34,34 @@ int main(int argc, char* argv[])
 
         // clang-format off
         #ifdef FAKE
-            mgo::MockGpio gpio(false, config);
+            const std::string replayFile = config.read("MockGpioReplayFile", "");
+            std::unique_ptr<mgo::MockGpio> mockGpio;
+            mgo::ReplayGpio* replayGpio = nullptr;
+            if (replayFile.empty()) {
+                mockGpio = std::make_unique<mgo::MockGpio>(false, config);
+            } else {
+                auto replay = std::make_unique<mgo::ReplayGpio>(
+                    config, replayFile, config.readDouble("MockGpioReplaySpeed", 1.0));
+                replayGpio = replay.get();
+                mockGpio = std::move(replay);
+            }
+            mgo::MockGpio& gpio = *mockGpio;
         #else
-            mgo::Gpio gpio;
+            mgo::BatchingGpio gpio;
         #endif
         // clang-format on
 
         mgo::Model model(gpio, config);
+        // clang-format off
+        #ifdef FAKE
+            if (replayGpio) {
+                MGOLOG("Replaying GPIO edges from " + replayFile);
+                replayGpio->start();
+            }
+        #endif
+        // clang-format on
 
-        mgo::Controller controller(&model);
+        mgo::Controller controller(&model, std::make_unique<mgo::ViewSfml>());
         controller.run();
 
         return EX_OK;
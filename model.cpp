@@ -2,6 +2,7 @@
 #include "keycodes.h"
 #include "threadpitches.h" // for ThreadPitch, threadPitches
 
+#include <algorithm>
 #include <cassert>
 #include <sstream>
 
@@ -9,6 +10,13 @@
 
 namespace {
 
+constexpr const char* AXIS1_SCALE_WARNING = "Axis1 could not reach position on scale";
+constexpr const char* AXIS1_LOST_STEPS_WARNING = "Axis1 has lost steps";
+constexpr const char* MULTIPASS_QUEUE_WARNING = "Next pass couldn't be queued, motors stopped";
+constexpr const char* NUDGE_DROPPED_WARNING = "Too many nudges queued, nudge ignored";
+// How much of the lost-step monitor's history to log when steps are lost
+constexpr std::size_t LOST_STEP_HISTORY_LOGGED = 20;
+
 std::string convertToString(double number, int decimalPlaces)
 {
     // If the number appears to be an integer, dispense with all
@@ -38,6 +46,8 @@ std::string translate_mode(mgo::Mode mode)
             return "Radius";
         case mgo::Mode::MultiPass:
             return "MultiPass";
+        case mgo::Mode::Diagnostics:
+            return "Diagnostics";
         default:
             // As this function is just used for debugging there's
             // no need for an assert here.
@@ -46,6 +56,25 @@ std::string translate_mode(mgo::Mode mode)
     }
 }
 
+// Motion limits are configured in mm/sec² and mm/sec³ (so they remain
+// valid if the gearing changes) but the motion profile works in steps
+mgo::MotionLimits readMotionLimits(
+    const mgo::IConfigReader& config,
+    const std::string& axis,
+    double conversionFactor,
+    long stepsPerRevolution,
+    double maxRpm,
+    double defaultAcceleration,
+    double defaultJerk)
+{
+    mgo::MotionLimits limits;
+    limits.maxStepsPerSecond = maxRpm * stepsPerRevolution / 60.0;
+    limits.acceleration = config.readDouble(axis + "Acceleration", defaultAcceleration)
+        / std::abs(conversionFactor);
+    limits.jerk = config.readDouble(axis + "Jerk", defaultJerk) / std::abs(conversionFactor);
+    return limits;
+}
+
 } // anonymous namepace
 
 namespace mgo {
@@ -57,54 +86,112 @@ void Model::initialise()
     double maxAxis1Rpm = m_config.readDouble("Axis1MaxMotorRpm", 1'000.0);
     long axis1StepsPerRevolution = m_config.readLong("Axis1StepsPerRev", 1'000);
     bool usingMockLinearScale = false;
+    bool lockMemoryByDefault = true;
 #ifdef FAKE
     usingMockLinearScale = true;
+    lockMemoryByDefault = false;
 #endif
-    m_axis1Motor = std::make_unique<mgo::StepperMotor>(
-        m_gpio,
+    // This is done before we start any threads so that all of their
+    // memory is locked, and none of them can be delayed by a page fault
+    if (m_config.readBool("LockMemory", lockMemoryByDefault)) {
+        if (lockMemory()) {
+            MGOLOG("Memory locked");
+        } else {
+            MGOLOG("*** Warning *** could not lock memory");
+        }
+    }
+    m_motionController = std::make_unique<mgo::MotionController>(
+        m_gpio, readThreadPlacement(m_config, "MotionThread"));
+    MGOLOG(m_motionController->getPlacement().describe("Motion controller thread"));
+    m_motionController->setWakeup(&m_wakeup);
+    if (!m_motionController->isRunningRealTimeScheduled()) {
+        MGOLOG("*** Warning *** motion controller thread not running real-time");
+    }
+    m_motionController->stepTiming().setLateThresholdMicroseconds(
+        m_config.readLong("StepLateThresholdMicroseconds", 100));
+    m_stepTimingLoggedAt = std::chrono::steady_clock::now();
+    m_axis1Motor = &m_motionController->addMotor(
         m_config.readLong("Axis1GpioStepPin", 8),
         m_config.readLong("Axis1GpioReversePin", 7),
-        m_config.readLong("Axis1GpioEnablePin", 0),
         axis1StepsPerRevolution,
         axis1ConversionFactor,
         maxAxis1Rpm,
-        m_config.readDouble("Axis1RampingSpeed", 100.0),
+        readMotionLimits(
+            m_config,
+            "Axis1",
+            axis1ConversionFactor,
+            axis1StepsPerRevolution,
+            maxAxis1Rpm,
+            50.0,
+            1'000.0),
         usingMockLinearScale,
         m_config.readLong("LinearScaleAxis1StepsPerMM", 200));
-    if (!m_axis1Motor->isRunningRealTimeScheduled()){
-        MGOLOG("*** Warning *** axis1 steppermotor thread not running real-time");
-    }
 
     double axis2ConversionFactor = m_config.readDouble("Axis2ConversionNumerator", -1.0)
         / m_config.readDouble("Axis2ConversionDivisor", 1'000.0);
     double maxAxis2Rpm = m_config.readDouble("Axis2MaxMotorRpm", 1'000.0);
     long axis2StepsPerRevolution = m_config.readLong("Axis2StepsPerRev", 800);
-    m_axis2Motor = std::make_unique<mgo::StepperMotor>(
-        m_gpio,
+    m_axis2Motor = &m_motionController->addMotor(
         m_config.readLong("Axis2GpioStepPin", 20),
         m_config.readLong("Axis2GpioReversePin", 21),
-        m_config.readLong("Axis2GpioEnablePin", 0),
         axis2StepsPerRevolution,
         axis2ConversionFactor,
         maxAxis2Rpm,
-        m_config.readDouble("Axis2RampingSpeed", 100.0));
-    if (!m_axis2Motor->isRunningRealTimeScheduled()){
-        MGOLOG("*** Warning *** axis2 steppermotor thread not running real-time");
-    }
-
+        readMotionLimits(
+            m_config,
+            "Axis2",
+            axis2ConversionFactor,
+            axis2StepsPerRevolution,
+            maxAxis2Rpm,
+            20.0,
+            400.0));
+
+    const long encoderPulsesPerRev = m_config.readLong("RotaryEncoderPulsesPerRev", 2'000);
+    const double encoderGearing = m_config.readDouble("RotaryEncoderGearingNumerator", 35.0)
+        / m_config.readDouble("RotaryEncoderGearingDivisor", 30.0);
+    m_encoderPulsesPerSpindleRev = encoderPulsesPerRev * encoderGearing;
+    mgo::RpmWindow rpmWindow;
+    rpmWindow.pulses = m_config.readLong("RotaryEncoderRpmWindowPulses", rpmWindow.pulses);
+    rpmWindow.microseconds
+        = m_config.readLong("RotaryEncoderRpmWindowMilliseconds", rpmWindow.microseconds / 1'000)
+        * 1'000;
+    rpmWindow.fastPulses = m_config.readLong("RotaryEncoderFastRpmPulses", rpmWindow.fastPulses);
+    mgo::EncoderFilter encoderFilter;
+    encoderFilter.minEdgeMicroseconds
+        = m_config.readLong("RotaryEncoderMinEdgeMicroseconds", encoderFilter.minEdgeMicroseconds);
+    encoderFilter.highSpeedRpm
+        = m_config.readDouble("RotaryEncoderHighSpeedRpm", encoderFilter.highSpeedRpm);
+    encoderFilter.decimation
+        = m_config.readLong("RotaryEncoderHighSpeedDecimation", encoderFilter.decimation);
     m_rotaryEncoder = std::make_unique<mgo::RotaryEncoder>(
         m_gpio,
         m_config.readLong("RotaryEncoderGpioPinA", 23),
         m_config.readLong("RotaryEncoderGpioPinB", 24),
-        m_config.readLong("RotaryEncoderPulsesPerRev", 2'000),
-        m_config.readDouble("RotaryEncoderGearingNumerator", 35.0)
-            / m_config.readDouble("RotaryEncoderGearingDivisor", 30.0));
-
-    m_linearScaleAxis1 = std::make_unique<mgo::LinearScale>(
-        m_gpio,
-        m_config.readLong("LinearScaleAxis1GpioPinA", 5),
-        m_config.readLong("LinearScaleAxis1GpioPinB", 6),
-        m_config.readLong("LinearScaleAxis1StepsPerMM", 200));
+        encoderPulsesPerRev,
+        encoderGearing,
+        rpmWindow,
+        encoderFilter);
+    m_leadscrew = std::make_unique<mgo::ElectronicLeadscrew>(
+        m_config.readLong("ElectronicLeadscrewLatencyMicroseconds", 2'000));
+    m_rotaryEncoder->setLeadscrew(m_leadscrew.get());
+    m_rotaryEncoder->callbackThreadPlacement().request(
+        readThreadPlacement(m_config, "RotaryEncoderThread"));
+
+    // Axis1's scale is always read, so its position can be displayed
+    addLinearScale(1);
+    if (m_config.readBool("Axis2UseLinearScale", false)) {
+        addLinearScale(2);
+    }
+
+    const std::string captureFile = m_config.read("EdgeCaptureFile", "");
+    if (!captureFile.empty()) {
+        m_edgeRecorder = std::make_unique<mgo::EdgeRecorder>(captureFile);
+        m_rotaryEncoder->setRecorder(m_edgeRecorder.get());
+        for (const auto& [axis, scale] : m_linearScales) {
+            scale->setRecorder(m_edgeRecorder.get());
+        }
+        MGOLOG("Capturing GPIO edges to " + captureFile);
+    }
 
     // We need to ensure that the motors are in a known position with regard to
     // backlash - which means moving them initially by the amount of
@@ -125,13 +212,78 @@ void Model::initialise()
 
     axis1SaveBreadcrumbPosition();
     axis2SaveBreadcrumbPosition();
+
+    // Created last so the moves above aren't corrected from the scale
+    if (usingLinearScale(1) && m_config.readBool("Axis1ClosedLoop", false)) {
+        mgo::ScaleFeedbackLimits limits;
+        limits.toleranceMm = m_config.readDouble("Axis1ClosedLoopToleranceMm", limits.toleranceMm);
+        limits.correctionMmPerSecond = m_config.readDouble(
+            "Axis1ClosedLoopCorrectionMmPerSecond", limits.correctionMmPerSecond);
+        limits.maxCorrectionMm
+            = m_config.readDouble("Axis1ClosedLoopMaxCorrectionMm", limits.maxCorrectionMm);
+        limits.maxCorrectiveMoves
+            = m_config.readLong("Axis1ClosedLoopMaxCorrectiveMoves", limits.maxCorrectiveMoves);
+        m_axis1Feedback = std::make_unique<mgo::ScaleFeedback>(axis1ConversionFactor, limits);
+    }
+
+    if (linearScale(1) && m_config.readBool("Axis1LostStepMonitor", false)) {
+        mgo::LostStepLimits limits;
+        limits.thresholdMm = m_config.readDouble("LostStepThresholdMm", limits.thresholdMm);
+        limits.samples = m_config.readLong("LostStepSamples", limits.samples);
+        m_axis1LostStepMonitor
+            = std::make_unique<mgo::LostStepMonitor>(axis1ConversionFactor, limits);
+        const bool stopMotors = m_config.readBool("LostStepStopMotors", true);
+        mgo::Motor* axis1Motor = m_axis1Motor;
+        mgo::Motor* axis2Motor = m_axis2Motor;
+        mgo::LinearScale* scale = linearScale(1);
+        mgo::Wakeup* wakeup = &m_wakeup;
+        m_axis1LostStepMonitor->start(
+            std::chrono::milliseconds(m_config.readLong("LostStepSampleMilliseconds", 5)),
+            [axis1Motor]() { return axis1Motor->getCurrentStep(); },
+            [scale]() { return scale->getPositionInMm(); },
+            [=]() {
+                // This is the monitor's thread, so the rest (status, warning)
+                // is left to axis1CheckLostSteps()
+                if (stopMotors) {
+                    axis1Motor->stop();
+                    axis2Motor->stop();
+                }
+                wakeup->notify();
+            });
+    }
+
+    // The axes' speeds are worked out from how far they've moved since the
+    // previous sample, so are what they actually did, not what they were set to
+    const auto historyPeriod = std::chrono::milliseconds(
+        std::max(m_config.readLong("HistorySampleMilliseconds", 20), 1ul));
+    const double minutesPerSample
+        = std::chrono::duration<double, std::ratio<60>>(historyPeriod).count();
+    double axis1Was = getAxis1MotorPosition();
+    double axis2Was = getAxis2MotorPosition();
+    m_history.start(
+        historyPeriod, [this, minutesPerSample, axis1Was, axis2Was]() mutable {
+            const double axis1 = getAxis1MotorPosition();
+            const double axis2 = getAxis2MotorPosition();
+            mgo::HistorySample sample;
+            sample[static_cast<std::size_t>(HistoryChannel::Rpm)] = getRotaryEncoderRpm();
+            sample[static_cast<std::size_t>(HistoryChannel::Axis1Speed)]
+                = (axis1 - axis1Was) / minutesPerSample;
+            sample[static_cast<std::size_t>(HistoryChannel::Axis2Speed)]
+                = (axis2 - axis2Was) / minutesPerSample;
+            sample[static_cast<std::size_t>(HistoryChannel::Axis1Position)] = axis1;
+            sample[static_cast<std::size_t>(HistoryChannel::Axis2Position)] = axis2;
+            axis1Was = axis1;
+            axis2Was = axis2;
+            return sample;
+        });
 }
 
 StatusResult Model::checkStatus()
 {
     StatusResult statusResult = StatusResult::Ok;
 
-    float chuckRpm = m_rotaryEncoder->getRpm();
+    m_rotaryEncoder->releaseHeldEdges();
+    float chuckRpm = m_rotaryEncoder->getFastRpm();
 
     if (limitSwitchTriggered()) {
         stopAllMotors();
@@ -149,9 +301,17 @@ StatusResult Model::checkStatus()
 #endif
     m_spindleWasRunning = chuckRpm > 30.f;
 
+    logStepTiming();
+    logLinearScaleIllegalTransitions();
+    reportCallbackThreadPlacement();
+    axis1CloseLoop();
+    axis1CheckLostSteps();
+
     if (m_enabledFunction == Mode::Threading) {
         // We are cutting threads, so the stepper motor's speed
         // is dependent on the spindle's RPM and the thread pitch.
+        // If the leadscrew is geared to the spindle, its steps come
+        // straight from the encoder, and the speed is just for display.
         float pitch = threadPitches.at(m_threadPitchIndex).pitchMm;
         // because my stepper motor / leadscrew does one mm per
         // revolution, there is a direct correlation between spindle
@@ -168,11 +328,17 @@ StatusResult Model::checkStatus()
         {
             m_warning = "";
         }
+        if (m_leadscrew->getOverruns() != m_leadscrewOverruns) {
+            // Steps have been lost, so the thread is ruined if we carry on
+            m_leadscrewOverruns = m_leadscrew->getOverruns();
+            m_axis1Motor->stop();
+            m_warning = "Leadscrew couldn't keep up with spindle";
+        }
         m_axis1Motor->setSpeed(speed);
     }
     if (m_xDiameterSet) {
         m_generalStatus
-            = fmt::format("Diameter: {: .2f} mm", std::abs(m_axis2Motor->getPosition() * 2));
+            = fmt::format("Diameter: {: .2f} mm", std::abs(getAxis2MotorPosition() * 2));
     }
     if (m_enabledFunction == Mode::MultiPass && m_axis1Motor->isRunning()
         && m_multiPassStage == MultiPassStage::NotStarted) {
@@ -197,6 +363,9 @@ StatusResult Model::checkStatus()
             case MultiPassStage::NotStarted:
                 // Do nothing until the user initiates the first cut
                 break;
+            case MultiPassStage::Paused:
+                // Do nothing until the user's ready for the next cut
+                break;
             default:
                 assert(false); // Unhandled MultiPassStage item
         }
@@ -289,25 +458,93 @@ void Model::multiPassNextCut(mgo::StatusResult& statusResult)
     statusResult = StatusResult::Ok;
 }
 
+// Where axis2 should go for the next cut, or nothing if we've finished.
+// Both axis2 memories must be set.
+std::optional<double> Model::multiPassStepOverTarget() const
+{
+    double from = getAxis2MemoryAsPosition(0).value();
+    double to = getAxis2MemoryAsPosition(1).value();
+    // Have we already finished?
+    if (std::abs(m_axis2Motor->getPosition() - to) < 0.0001) {
+        return std::nullopt;
+    }
+    double direction = (to < from) ? -1.0 : 1.0;
+    double stepOver = m_stepOver;
+    stepOver = std::abs(stepOver) * direction;
+    double target = m_axis2Motor->getPosition() + stepOver;
+    if ((direction > 0.0 && target > to) || (direction < 0.0 && target < to)) {
+        target = to;
+    }
+    return target;
+}
+
 void Model::multiPassStepOver()
 {
     if (getAxis2MemoryAsPosition(0).has_value() && getAxis2MemoryAsPosition(1).has_value()) {
-        double from = getAxis2MemoryAsPosition(0).value();
-        double to = getAxis2MemoryAsPosition(1).value();
-        // Have we already finished?
-        if (std::abs(m_axis2Motor->getPosition() - to) < 0.0001) {
+        const auto target = multiPassStepOverTarget();
+        if (!target.has_value()) {
             m_multiPassStage = MultiPassStage::Finished;
             return;
         }
-        double direction = (to < from) ? -1.0 : 1.0;
-        double stepOver = m_stepOver;
-        stepOver = std::abs(stepOver) * direction;
-        double target = m_axis2Motor->getPosition() + stepOver;
-        if ((direction > 0.0 && target > to) || (direction < 0.0 && target < to)) {
-            target = to;
-        }
         m_multiPassStage = MultiPassStage::NextCut;
-        m_axis2Motor->goToPosition(target);
+        m_axis2Motor->goToPosition(target.value());
+    }
+}
+
+// Queues the return, step-over and next cut as one stream of moves, so the
+// motors carry straight on from one to the next rather than stopping and
+// waiting for the control loop in between
+void Model::multiPassQueueNextCut()
+{
+    // If any of the moves can't be queued, the rest of the stream would run
+    // from the wrong place, so everything's stopped and the stage is left
+    // as it was (to try again from wherever the motors stopped)
+    const auto queue = [this](const std::vector<MotionController::Target>& targets,
+                           double speed = 0.0) {
+        if (m_motionController->queueMove(targets, speed)) {
+            return true;
+        }
+        if (m_warning != MULTIPASS_QUEUE_WARNING) {
+            MGOLOG("*** Warning *** a multi-pass move couldn't be queued");
+        }
+        stopAllMotors();
+        m_warning = MULTIPASS_QUEUE_WARNING;
+        return false;
+    };
+    const long axis2Start = m_axis2Motor->getCurrentStep();
+    const auto axis2Target = multiPassStepOverTarget();
+    if (m_multiPassRetractBetweenCuts
+        && !queue({ { m_axis2Motor, axis2Start + axis2RetractionSteps() } }, 100.0)) {
+        return;
+    }
+    if (!queue({ { m_axis1Motor, m_axis1Memory.at(0) } }, m_axis1Motor->getMaxRpm())) {
+        return;
+    }
+    if (!axis2Target.has_value()) {
+        if (m_multiPassRetractBetweenCuts && !queue({ { m_axis2Motor, axis2Start } }, 100.0)) {
+            return;
+        }
+        clearMultiPassQueueWarning();
+        m_multiPassStage = MultiPassStage::Finished;
+        return;
+    }
+    if (!queue({ { m_axis2Motor,
+            std::lround(axis2Target.value() / m_axis2Motor->getConversionFactor()) } })) {
+        return;
+    }
+    // The cut itself is at whatever speed the last one was
+    if (!queue({ { m_axis1Motor, m_axis1Memory.at(1) } })) {
+        return;
+    }
+    clearMultiPassQueueWarning();
+    m_axis1Status = "next pass";
+    m_multiPassStage = MultiPassStage::Cutting;
+}
+
+void Model::clearMultiPassQueueWarning()
+{
+    if (m_warning == MULTIPASS_QUEUE_WARNING) {
+        m_warning = "";
     }
 }
 
@@ -315,6 +552,11 @@ void Model::multiPassEndCut(mgo::StatusResult& statusResult)
 {
     // We have come to the end of a cut
     m_currentMemory = 0;
+    if (!m_multiPassPauseBetweenCuts && getAxis2MemoryAsPosition(0).has_value()
+        && getAxis2MemoryAsPosition(1).has_value()) {
+        multiPassQueueNextCut();
+        return;
+    }
     if (m_multiPassRetractBetweenCuts && !getIsAxis2Retracted()) {
         axis2Retract();
         statusResult = StatusResult::WaitForMotors;
@@ -330,12 +572,17 @@ void Model::multiPassEndCut(mgo::StatusResult& statusResult)
 
 void Model::changeMode(Mode mode)
 {
-    if (mode != Mode::None) {
+    if (mode != Mode::None || m_axis1Motor->isGeared()) {
         stopAllMotors();
     }
     axis2SynchroniseOff();
-    if (mode == Mode::Threading || mode == Mode::Taper || mode == Mode::Radius) {
-        // We do not want motor speed ramping on tapering or threading
+    m_axis1Motor->setLeadscrew(nullptr);
+    if (mode == Mode::Threading && m_config.readBool("ThreadingUseElectronicLeadscrew", true)) {
+        attachLeadscrew();
+    }
+    if (mode == Mode::Threading) {
+        // Threading speed is locked to the spindle so we can't ramp. Tapers and
+        // radii are fine: axis2 follows axis1's position, whatever its speed.
         m_axis1Motor->enableRamping(false);
         m_axis2Motor->enableRamping(false);
     } else {
@@ -365,6 +612,19 @@ void Model::changeMode(Mode mode)
     }
 }
 
+// Gears axis1 to the spindle at the current thread pitch
+void Model::attachLeadscrew()
+{
+    const double pitch = threadPitches.at(m_threadPitchIndex).pitchMm;
+    const double stepsPerSpindleRev = pitch / std::abs(m_axis1Motor->getConversionFactor());
+    const Ratio ratio = approximateRatio(stepsPerSpindleRev / m_encoderPulsesPerSpindleRev);
+    MGOLOG(fmt::format(
+        "Leadscrew ratio {}/{} steps per encoder pulse", ratio.numerator, ratio.denominator));
+    m_leadscrew->setRatio(ratio);
+    m_leadscrewOverruns = m_leadscrew->getOverruns();
+    m_axis1Motor->setLeadscrew(m_leadscrew.get());
+}
+
 void Model::stopAllMotors()
 {
     m_axis1Motor->stop();
@@ -408,7 +668,7 @@ void Model::startSynchronisedXMotorForTaper(ZDirection direction)
     m_axis2Motor->wait();
     double angleConversion = std::tan(m_taperAngle * DEG_TO_RAD);
     m_axis2Motor->synchroniseOn(
-        m_axis1Motor.get(), [angleConversion](double zPosDelta, double) -> double {
+        m_axis1Motor, [angleConversion](double zPosDelta, double) -> double {
             return zPosDelta * angleConversion;
         });
 }
@@ -437,7 +697,7 @@ void Model::startSynchronisedXMotorForRadius(ZDirection direction)
     m_axis2Motor->wait();
     double radius = m_radius;
     m_axis2Motor->synchroniseOn(
-        m_axis1Motor.get(),
+        m_axis1Motor,
         [radius](double /*zPosDelta*/, double zCurrentPos) {
             // Note, we only cut a radius if z is positive.
             //
@@ -464,9 +724,10 @@ void Model::axis1GoToStep(long step)
 {
     axis1CheckForSynchronisation(step);
     if (m_enabledFunction == Mode::Threading) {
-        m_rotaryEncoder->callbackAtZeroDegrees([&]() {
-            m_axis1Motor->goToStep(step);
-        });
+        axis1GoToStepAtZeroDegrees(step);
+    } else if (m_axis1Feedback && m_enabledFunction == Mode::None && step != INF_LEFT
+               && step != INF_RIGHT) {
+        axis1GoToScalePosition(step * m_axis1Motor->getConversionFactor());
     } else {
         m_axis1Motor->goToStep(step);
     }
@@ -474,15 +735,11 @@ void Model::axis1GoToStep(long step)
 
 void Model::axis1GoToPosition(double pos)
 {
-    // TODO - if the linear scale is enabled, we need to perhaps go to a step close to
-    // the desired position, then start nudging while monitoring the linear scale
-    // until we get to the desired position. This could be implemented in the motor
-    // perhaps by supplying a callback that is called after each step is taken.
     axis1CheckForSynchronisation(pos / m_axis1Motor->getConversionFactor());
     if (m_enabledFunction == Mode::Threading) {
-        m_rotaryEncoder->callbackAtZeroDegrees([&]() {
-            m_axis1Motor->goToPosition(pos);
-        });
+        axis1GoToStepAtZeroDegrees(std::lround(pos / m_axis1Motor->getConversionFactor()));
+    } else if (m_axis1Feedback && m_enabledFunction == Mode::None) {
+        axis1GoToScalePosition(pos);
     } else {
         m_axis1Motor->goToPosition(pos);
     }
@@ -494,11 +751,37 @@ void Model::axis1GoToPosition(double pos)
     m_axis1Status = fmt::format("Going to {:.3f}", pos);
 }
 
+// If threading, we need to start at the same point each time, so the move
+// is armed to start when the chuck is next at zero degrees. The motor's
+// thread does the waiting, so we carry on straight away.
+void Model::axis1GoToStepAtZeroDegrees(long step)
+{
+    if (const auto tick = m_rotaryEncoder->nextZeroDegreesTick()) {
+        m_axis1Motor->goToStepAt(step, *tick);
+    }
+}
+
+// Moves so that the scale (rather than the motor's step count) reads "pos".
+// The move is corrected as it goes, and once it's finished, by axis1CloseLoop().
+void Model::axis1GoToScalePosition(double pos)
+{
+    if (m_axis1Motor->isRunning()) {
+        // The motor would ignore the move anyway
+        return;
+    }
+    if (m_warning == AXIS1_SCALE_WARNING) {
+        m_warning = "";
+    }
+    m_axis1Motor->goToStep(m_axis1Feedback->start(
+        pos, m_axis1Motor->getCurrentStep(), linearScale(1)->getPositionInMm()));
+    m_axis1FeedbackAt = std::chrono::steady_clock::now();
+}
+
 void Model::axis1GoToOffset(double offset)
 {
     m_axis1LastRelativeMove = offset;
     m_lastRelativeMoveAxis = Axis::Axis1;
-    axis1GoToPosition(m_axis1Motor->getPosition() + offset);
+    axis1GoToPosition(getAxis1MotorPosition() + offset);
     m_axis1Status = fmt::format("To rel {}", offset);
 }
 
@@ -544,6 +827,24 @@ void Model::axis1CheckForSynchronisation(long step)
     axis1CheckForSynchronisation(direction);
 }
 
+void Model::goToCurrentMemory()
+{
+    // Threading and tapering have their own requirements for how
+    // axis1 starts moving, so we only coordinate the axes otherwise
+    if (m_enabledFunction != Mode::None || m_axis1Memory.at(m_currentMemory) == AXIS1_UNSET
+        || m_axis2Memory.at(m_currentMemory) == AXIS2_UNSET) {
+        axis1GoToCurrentMemory();
+        axis2GoToCurrentMemory();
+        return;
+    }
+    axis1Stop();
+    axis2Stop();
+    m_axis1Status = "returning";
+    m_axis2Status = "returning";
+    m_motionController->moveLinear({ { m_axis1Motor, m_axis1Memory.at(m_currentMemory) },
+                                     { m_axis2Motor, m_axis2Memory.at(m_currentMemory) } });
+}
+
 void Model::axis1GoToCurrentMemory()
 {
     if (m_axis1Memory.at(m_currentMemory) == AXIS1_UNSET) {
@@ -555,28 +856,29 @@ void Model::axis1GoToCurrentMemory()
     axis1Stop();
     m_axis1Status = "returning";
     axis1CheckForSynchronisation(m_axis1Memory.at(m_currentMemory));
-    // If threading, we need to start at the same point each time - we
-    // wait for zero degrees on the chuck before starting:
-    if (m_enabledFunction == Mode::Threading) {
-        m_rotaryEncoder->callbackAtZeroDegrees([&]() {
-            axis1GoToStep(m_axis1Memory.at(m_currentMemory));
-        });
-    } else {
-        axis1GoToStep(m_axis1Memory.at(m_currentMemory));
-    }
+    // If threading, this waits for zero degrees on the chuck before starting
+    axis1GoToStep(m_axis1Memory.at(m_currentMemory));
 }
 
 void Model::axis1Nudge(ZDirection direction, double nudgeAmountMm)
 {
-    if (m_axis1Motor->isRunning()) {
+    if (m_axis1Motor->isRunning() && !m_axis1Motor->hasQueuedMoves()) {
         axis1Stop();
     }
-    const double oldSpeed = m_axis1Motor->getSpeed();
-    m_axis1Motor->setSpeed(m_axis1Motor->getMaxRpm() / 10.0);
     long steps = nudgeAmountMm / m_axis1Motor->getConversionFactor();
     if (direction == ZDirection::Left) {
         steps = -steps;
     }
+    if (m_enabledFunction == Mode::None) {
+        // Nudges are queued, so repeated nudges run on from one
+        // another rather than each waiting for the last to finish
+        axisNudgeQueued(m_motionController->queueMove(
+            { { m_axis1Motor, m_axis1Motor->getPlannedStep() + steps } },
+            m_axis1Motor->getMaxRpm() / 10.0));
+        return;
+    }
+    const double oldSpeed = m_axis1Motor->getSpeed();
+    m_axis1Motor->setSpeed(m_axis1Motor->getMaxRpm() / 10.0);
     m_axis1Motor->stop();
     m_axis1Motor->wait();
     axis1GoToStep(getAxis1MotorCurrentStep() + steps);
@@ -587,15 +889,32 @@ void Model::axis1Nudge(ZDirection direction, double nudgeAmountMm)
     axis1SaveBreadcrumbPosition();
 }
 
+// Nudges are dropped if the queue's full (or the motor's synchronised), so
+// the operator's told rather than wondering where a nudge went
+void Model::axisNudgeQueued(bool queued)
+{
+    if (queued) {
+        if (m_warning == NUDGE_DROPPED_WARNING) {
+            m_warning = "";
+        }
+        return;
+    }
+    MGOLOG("Nudge couldn't be queued");
+    m_warning = NUDGE_DROPPED_WARNING;
+}
+
 void Model::axis1Zero()
 {
     if (m_enabledFunction == Mode::Taper) {
         changeMode(Mode::None);
     }
-    if (m_config.readBool("Axis1UseLinearScale", false)) {
-        m_linearScaleAxis1->setZeroMm();
+    if (usingLinearScale(1)) {
+        linearScale(1)->setZeroMm();
     }
     m_axis1Motor->zeroPosition();
+    if (m_axis1LostStepMonitor) {
+        m_axis1LostStepMonitor->rebaseline();
+    }
     // Zeroing will invalidate any memorised Z positions, so we clear them
     for (auto& m : m_axis1Memory) {
         m = AXIS1_UNSET;
@@ -667,7 +986,7 @@ void Model::axis2GoToOffset(double offset)
 {
     m_axis2LastRelativeMove = offset;
     m_lastRelativeMoveAxis = Axis::Axis2;
-    axis2GoToPosition(m_axis2Motor->getPosition() + offset);
+    axis2GoToPosition(getAxis2MotorPosition() + offset);
     m_axis2Status = fmt::format("To rel {}", offset);
 }
 
@@ -787,6 +1106,9 @@ void Model::axis2Wait()
 
 void Model::axis1Stop()
 {
+    if (m_axis1Feedback) {
+        m_axis1Feedback->cancel();
+    }
     m_axis1Motor->stop();
     m_axis1Motor->wait();
 }
@@ -818,6 +1140,9 @@ void Model::axis2Zero()
     if (m_enabledFunction == Mode::Taper) {
         changeMode(Mode::None);
     }
+    if (usingLinearScale(2)) {
+        linearScale(2)->setZeroMm();
+    }
     m_axis2Motor->zeroPosition();
     // Zeroing will invalidate any memorised X positions, so we clear them
     for (auto& m : m_axis2Memory) {
@@ -863,11 +1188,9 @@ void Model::axis2SpeedIncrease()
 
 void Model::axis2Nudge(XDirection direction, double nudgeAmountMm)
 {
-    if (m_axis2Motor->isRunning()) {
+    if (m_axis2Motor->isRunning() && !m_axis2Motor->hasQueuedMoves()) {
         axis2Stop();
     }
-    const double oldSpeed = m_axis2Motor->getSpeed();
-    m_axis2Motor->setSpeed(m_axis2Motor->getMaxRpm() / 10.0);
     long steps = nudgeAmountMm / m_axis2Motor->getConversionFactor();
     if (direction == XDirection::Inwards) {
         steps = -steps;
@@ -875,6 +1198,15 @@ void Model::axis2Nudge(XDirection direction, double nudgeAmountMm)
     if (m_config.readBool("Axis2MotorFlipDirection", false)) {
         steps = -steps;
     }
+    if (m_enabledFunction == Mode::None) {
+        // See axis1Nudge()
+        axisNudgeQueued(m_motionController->queueMove(
+            { { m_axis2Motor, m_axis2Motor->getPlannedStep() + steps } },
+            m_axis2Motor->getMaxRpm() / 10.0));
+        return;
+    }
+    const double oldSpeed = m_axis2Motor->getSpeed();
+    m_axis2Motor->setSpeed(m_axis2Motor->getMaxRpm() / 10.0);
     m_axis2Motor->goToStep(m_axis2Motor->getCurrentStep() + steps);
     m_axis2Motor->wait();
     m_axis2Motor->setSpeed(oldSpeed);
@@ -912,20 +1244,25 @@ void Model::axis2Retract()
         m_xOldPosition = m_axis2Motor->getCurrentStep();
         m_previousAxis2Speed = m_axis2Motor->getSpeed();
         m_axis2Motor->setSpeed(100.0);
-        int direction = -1;
-        if (m_xRetractionDirection == XDirection::Inwards) {
-            direction = 1;
-        }
-        long stepsForRetraction = 2.0 / std::abs(m_axis2Motor->getConversionFactor());
-        if (m_config.readBool("Axis2MotorFlipDirection", false)) {
-            stepsForRetraction = -stepsForRetraction;
-        }
-        m_axis2Motor->goToStep(m_axis2Motor->getCurrentStep() + stepsForRetraction * direction);
+        m_axis2Motor->goToStep(m_axis2Motor->getCurrentStep() + axis2RetractionSteps());
         m_axis2Retracted = true;
         m_axis2Status = "Retracting";
     }
 }
 
+long Model::axis2RetractionSteps() const
+{
+    int direction = -1;
+    if (m_xRetractionDirection == XDirection::Inwards) {
+        direction = 1;
+    }
+    long stepsForRetraction = 2.0 / std::abs(m_axis2Motor->getConversionFactor());
+    if (m_config.readBool("Axis2MotorFlipDirection", false)) {
+        stepsForRetraction = -stepsForRetraction;
+    }
+    return stepsForRetraction * direction;
+}
+
 void Model::axis2StorePosition()
 {
     m_axis2Memory.at(m_currentMemory) = m_axis2Motor->getCurrentStep();
@@ -1090,6 +1427,36 @@ void Model::setCurrentDisplayMode(Mode mode)
     m_currentDisplayMode = mode;
 }
 
+bool Model::getShowHistory() const
+{
+    return m_showHistory;
+}
+
+void Model::setShowHistory(bool flag)
+{
+    m_showHistory = flag;
+}
+
+bool Model::getShowProfiler() const
+{
+    return m_showProfiler;
+}
+
+void Model::setShowProfiler(bool flag)
+{
+    m_showProfiler = flag;
+}
+
+const std::optional<Dialog>& Model::getDialog() const
+{
+    return m_dialog;
+}
+
+std::optional<Dialog>& Model::getDialog()
+{
+    return m_dialog;
+}
+
 double Model::getRadius() const
 {
     return m_radius;
@@ -1263,18 +1630,32 @@ void Model::setAxis2MotorSpeed(double speed)
 
 void Model::setAxis1Position(double mm)
 {
+    // Keep the scale in step, so closed-loop moves agree with the display
+    if (usingLinearScale(1)) {
+        linearScale(1)->setPositionMm(mm);
+    }
     m_axis1Motor->setPosition(mm);
+    if (m_axis1LostStepMonitor) {
+        m_axis1LostStepMonitor->rebaseline();
+    }
 }
 
 void Model::setAxis2Position(double mm)
 {
+    if (usingLinearScale(2)) {
+        linearScale(2)->setPositionMm(mm);
+    }
     m_axis2Motor->setPosition(mm);
 }
 
 void Model::resetMotorThreads()
 {
-    m_axis2Motor.reset();
-    m_axis1Motor.reset();
+    // Both of these threads read the motors' positions
+    m_history.stop();
+    m_axis1LostStepMonitor.reset();
+    m_axis2Motor = nullptr;
+    m_axis1Motor = nullptr;
+    m_motionController.reset();
 }
 
 double Model::getAxis1MotorPosition() const
@@ -1282,8 +1663,8 @@ double Model::getAxis1MotorPosition() const
     if (!m_axis1Motor) {
         return 0.0;
     }
-    if (m_config.readBool("Axis1UseLinearScale", false)) {
-        return m_linearScaleAxis1->getPositionInMm();
+    if (usingLinearScale(1)) {
+        return linearScale(1)->getPositionInMm();
     }
     return m_axis1Motor->getPosition();
 }
@@ -1293,6 +1674,9 @@ double Model::getAxis2MotorPosition() const
     if (!m_axis2Motor) {
         return 0.0;
     }
+    if (usingLinearScale(2)) {
+        return linearScale(2)->getPositionInMm();
+    }
     return m_axis2Motor->getPosition();
 }
 
@@ -1317,8 +1701,8 @@ double Model::getAxis1MotorCurrentStep() const
     if (!m_axis1Motor) {
         return 0.0;
     }
-    if (m_config.readBool("Axis1UseLinearScale", false)) {
-        return m_linearScaleAxis1->getPositionInMm() / m_axis1Motor->getConversionFactor();
+    if (usingLinearScale(1)) {
+        return linearScale(1)->getPositionInMm() / m_axis1Motor->getConversionFactor();
     }
     return m_axis1Motor->getCurrentStep();
 }
@@ -1328,6 +1712,9 @@ double Model::getAxis2MotorCurrentStep() const
     if (!m_axis2Motor) {
         return 0.0;
     }
+    if (usingLinearScale(2)) {
+        return linearScale(2)->getPositionInMm() / m_axis2Motor->getConversionFactor();
+    }
     return m_axis2Motor->getCurrentStep();
 }
 
@@ -1381,15 +1768,243 @@ float Model::getRotaryEncoderRpm() const
     return m_rotaryEncoder->getRpm();
 }
 
-float Model::getAxis1LinearScalePosMm() const
+uint32_t Model::getRotaryEncoderRejectedEdges() const
+{
+    if (!m_rotaryEncoder) {
+        return 0;
+    }
+    return m_rotaryEncoder->getRejectedEdges();
+}
+
+bool Model::isRotaryEncoderHighSpeed() const
+{
+    if (!m_rotaryEncoder) {
+        return false;
+    }
+    return m_rotaryEncoder->getState().highSpeed;
+}
+
+StepTimingSnapshot Model::getStepTiming() const
+{
+    if (!m_motionController) {
+        return {};
+    }
+    return m_motionController->stepTiming().snapshot();
+}
+
+uint32_t Model::getLateStepThresholdMicroseconds() const
+{
+    if (!m_motionController) {
+        return 0;
+    }
+    return m_motionController->stepTiming().getLateThresholdMicroseconds();
+}
+
+// Corrects axis1's position from its linear scale, while closed loop positioning is active
+void Model::axis1CloseLoop()
+{
+    if (!m_axis1Feedback || !m_axis1Feedback->isActive()) {
+        return;
+    }
+    if (m_enabledFunction != Mode::None || m_axis1Motor->hasQueuedMoves()) {
+        // Something else has taken over the motor
+        m_axis1Feedback->cancel();
+        return;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    const long currentStep = m_axis1Motor->getCurrentStep();
+    const double scaleMm = linearScale(1)->getPositionInMm();
+    if (m_axis1Motor->isRunning()) {
+        const double seconds = std::chrono::duration<double>(now - m_axis1FeedbackAt).count();
+        m_axis1FeedbackAt = now;
+        m_axis1Motor->setTargetStep(m_axis1Feedback->duringMove(currentStep, scaleMm, seconds));
+        return;
+    }
+    // Give the scale's readings time to catch up with the motor
+    const auto settle
+        = std::chrono::milliseconds(m_config.readLong("Axis1ClosedLoopSettleMilliseconds", 50));
+    if (now - m_axis1FeedbackAt < settle) {
+        return;
+    }
+    m_axis1FeedbackAt = now;
+    switch (m_axis1Feedback->afterMove(currentStep, scaleMm)) {
+        case ScaleFeedbackResult::Correcting:
+            m_axis1Motor->goToStep(m_axis1Feedback->getTargetStep());
+            m_axis1Status = "correcting";
+            break;
+        case ScaleFeedbackResult::GaveUp:
+            MGOLOG(fmt::format(
+                "Axis1 stopped at {:.3f} mm on the scale, rather than {:.3f} mm",
+                scaleMm,
+                m_axis1Feedback->getTargetMm()));
+            m_warning = AXIS1_SCALE_WARNING;
+            break;
+        case ScaleFeedbackResult::InPosition:
+            break;
+    }
+}
+
+// Reports any steps the lost-step monitor has found to have been lost
+void Model::axis1CheckLostSteps()
+{
+    if (!m_axis1LostStepMonitor) {
+        return;
+    }
+    const uint32_t losses = m_axis1LostStepMonitor->getLosses();
+    if (losses == m_axis1LostStepsReported) {
+        return;
+    }
+    m_axis1LostStepsReported = losses;
+    const std::vector<float> history = m_axis1LostStepMonitor->getHistory();
+    std::string samples;
+    for (std::size_t n = history.size() - std::min(history.size(), LOST_STEP_HISTORY_LOGGED);
+         n < history.size();
+         ++n) {
+        samples += fmt::format(" {:.3f}", history[n]);
+    }
+    MGOLOG(fmt::format(
+        "*** Warning *** axis1 motor and scale have diverged; latest divergence (mm):{}",
+        samples));
+    m_warning = AXIS1_LOST_STEPS_WARNING;
+    if (m_config.readBool("LostStepStopMotors", true)) {
+        m_axis1Status = "stopped";
+        m_axis2Status = "stopped";
+    }
+}
+
+// The GPIO library's callback threads are placed the first time they
+// call us, so we can only report on them once that's happened
+void Model::reportCallbackThreadPlacement()
+{
+    if (!m_encoderPlacementReported && m_rotaryEncoder) {
+        if (const auto result = m_rotaryEncoder->callbackThreadPlacement().result()) {
+            MGOLOG(result->describe("Rotary encoder callback thread"));
+            m_encoderPlacementReported = true;
+        }
+    }
+    for (const auto& [axis, scale] : m_linearScales) {
+        if (m_scalePlacementReported.count(axis)) {
+            continue;
+        }
+        if (const auto result = scale->callbackThreadPlacement().result()) {
+            MGOLOG(result->describe(fmt::format("Axis{} linear scale callback thread", axis)));
+            m_scalePlacementReported.insert(axis);
+        }
+    }
+}
+
+// Periodically logs how late steps have been since the last time,
+// so that any pre-emption of the motion controller's thread is recorded
+void Model::logStepTiming()
+{
+    const auto interval = std::chrono::seconds(m_config.readLong("StepTimingLogSeconds", 60));
+    const auto now = std::chrono::steady_clock::now();
+    if (interval.count() <= 0 || now - m_stepTimingLoggedAt < interval) {
+        return;
+    }
+    m_stepTimingLoggedAt = now;
+    const StepTimingSnapshot latest = getStepTiming();
+    const StepTimingSnapshot recent = latest.since(m_loggedStepTiming);
+    m_loggedStepTiming = latest;
+    if (recent.count == 0) {
+        return;
+    }
+    MGOLOG(fmt::format(
+        "Step timing: {} steps, late by p50 {} us, p99 {} us, max {} us; {} over {} us",
+        recent.count,
+        recent.percentile(0.5),
+        recent.percentile(0.99),
+        recent.maxMicroseconds,
+        recent.lateCount,
+        getLateStepThresholdMicroseconds()));
+}
+
+void Model::logLinearScaleIllegalTransitions()
+{
+    // They tend to come in bursts, so we log at most once a second
+    const auto now = std::chrono::steady_clock::now();
+    if (now - m_scaleIllegalTransitionsLoggedAt < std::chrono::seconds(1)) {
+        return;
+    }
+    for (const auto& [axis, scale] : m_linearScales) {
+        const uint32_t count = scale->getIllegalTransitions();
+        uint32_t& logged = m_loggedScaleIllegalTransitions[axis];
+        if (count == logged) {
+            continue;
+        }
+        MGOLOG(fmt::format(
+            "*** Warning *** axis{} linear scale missed edges: {} illegal transitions ({} in "
+            "total)",
+            axis,
+            count - logged,
+            count));
+        logged = count;
+        m_scaleIllegalTransitionsLoggedAt = now;
+    }
+}
+
+// Reads the configuration for the scale on this axis and starts reading it.
+// A scale that can't be read is left out (with a warning), so the axis
+// carries on using its motor's position.
+void Model::addLinearScale(unsigned axis)
+{
+    const std::string prefix = fmt::format("LinearScaleAxis{}", axis);
+    // Axis1's scale has always had default pins
+    const int pinA = m_config.readLong(prefix + "GpioPinA", axis == 1 ? 5 : 0);
+    const int pinB = m_config.readLong(prefix + "GpioPinB", axis == 1 ? 6 : 0);
+    if (pinA == pinB) {
+        MGOLOG(fmt::format(
+            "*** Warning *** {}GpioPinA and {}GpioPinB must be set (and different)",
+            prefix,
+            prefix));
+        return;
+    }
+    if (!mgo::LinearScale::canAttach(m_gpio, axis)) {
+        MGOLOG(fmt::format(
+            "*** Warning *** this GPIO library can only read axis1's linear scale (it "
+            "doesn't deliver edges in batches), so axis{} runs without one",
+            axis));
+        return;
+    }
+    auto scale = std::make_unique<mgo::LinearScale>(
+        m_gpio, pinA, pinB, m_config.readLong(prefix + "StepsPerMM", 200), axis);
+    scale->callbackThreadPlacement().request(readThreadPlacement(m_config, prefix + "Thread"));
+    m_linearScales[axis] = std::move(scale);
+}
+
+mgo::LinearScale* Model::linearScale(unsigned axis) const
+{
+    const auto it = m_linearScales.find(axis);
+    if (it == m_linearScales.end()) {
+        return nullptr;
+    }
+    return it->second.get();
+}
+
+// Whether the axis's position comes from its scale rather than its motor
+bool Model::usingLinearScale(unsigned axis) const
+{
+    return m_config.readBool(fmt::format("Axis{}UseLinearScale", axis), false)
+        && linearScale(axis) != nullptr;
+}
+
+float Model::getLinearScalePosMm(unsigned axis) const
 {
-    if (m_linearScaleAxis1) {
-        return m_linearScaleAxis1->getPositionInMm();
+    if (mgo::LinearScale* scale = linearScale(axis)) {
+        return scale->getPositionInMm();
     } else {
         return 0.f;
     }
 }
 
+uint32_t Model::getLinearScaleIllegalTransitions(unsigned axis) const
+{
+    if (mgo::LinearScale* scale = linearScale(axis)) {
+        return scale->getIllegalTransitions();
+    }
+    return 0;
+}
+
 void Model::clearCurrentMemorySlot(Axis axis)
 {
     if (axis == Axis::Axis1) {
@@ -1400,6 +2015,31 @@ void Model::clearCurrentMemorySlot(Axis axis)
     }
 }
 
+const mgo::History& Model::getHistory() const
+{
+    return m_history;
+}
+
+const mgo::LostStepMonitor* Model::getAxis1LostStepMonitor() const
+{
+    return m_axis1LostStepMonitor.get();
+}
+
+mgo::Wakeup& Model::wakeup()
+{
+    return m_wakeup;
+}
+
+mgo::Profiler& Model::profiler()
+{
+    return m_profiler;
+}
+
+const mgo::Profiler& Model::profiler() const
+{
+    return m_profiler;
+}
+
 bool Model::limitSwitchTriggered() const
 {
     // TODO monitor any limit switches - needs config option for pin
@@ -1441,6 +2081,11 @@ const IConfigReader& Model::config() const
     return m_config;
 }
 
+double Model::getStepOver() const
+{
+    return m_stepOver;
+}
+
 void Model::setStepOver(double stepover)
 {
     m_stepOver = stepover;
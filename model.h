@@ -1,11 +1,23 @@
 #pragma once
 
 #include "configreader.h"
+#include "dialog.h"
+#include "edgecapture.h"
+#include "electronicleadscrew.h"
+#include "history.h"
 #include "linearscale.h"
+#include "loststepmonitor.h"
+#include "motioncontroller.h"
+#include "motor.h"
+#include "profiler.h"
 #include "rotaryencoder.h"
-#include "stepperControl/steppermotor.h"
+#include "scalefeedback.h"
+#include "wakeup.h"
 
+#include <chrono>
+#include <cmath>
 #include <limits>
+#include <map>
 #include <memory>
 #include <optional>
 #include <set>
@@ -39,7 +51,8 @@ enum class Mode {
     Threading,
     Taper,
     Radius,
-    MultiPass
+    MultiPass,
+    Diagnostics
 };
 
 // "Key Modes" allow for two-key actions, a bit like vim.
@@ -150,6 +163,8 @@ public:
     void axis2SaveBreadcrumbPosition();
     void axis2ClearBreadcrumbs();
 
+    // Moves both axes to the current memory slot together
+    void goToCurrentMemory();
     void repeatLastRelativeMove(Axis axis);
     void diameterIsSet();
 
@@ -169,6 +184,21 @@ public:
     Mode getCurrentDisplayMode() const;
     void setCurrentDisplayMode(Mode mode);
 
+    // Whether the diagnostics screen shows plots of the history rather
+    // than figures
+    bool getShowHistory() const;
+    void setShowHistory(bool flag);
+
+    // Whether the control loop's timings are shown over the display
+    bool getShowProfiler() const;
+    void setShowProfiler(bool flag);
+
+    // The dialog the operator is answering, if any. It's held here so it's
+    // displayed along with everything else, but it's only opened, fed keys
+    // and closed by the controller.
+    const std::optional<Dialog>& getDialog() const;
+    std::optional<Dialog>& getDialog();
+
     double getRadius() const;
     void setRadius(double radius);
 
@@ -229,13 +259,37 @@ public:
     std::string formatAxis2Position(long step) const;
 
     float getRotaryEncoderRpm() const;
-    float getAxis1LinearScalePosMm() const;
+    // See EncoderFilter
+    uint32_t getRotaryEncoderRejectedEdges() const;
+    bool isRotaryEncoderHighSpeed() const;
+    // Zero if the axis has no scale
+    float getLinearScalePosMm(unsigned axis) const;
+    // See LinearScale::getIllegalTransitions()
+    uint32_t getLinearScaleIllegalTransitions(unsigned axis) const;
+    // How late the motors' steps have been (since startup)
+    StepTimingSnapshot getStepTiming() const;
+    uint32_t getLateStepThresholdMicroseconds() const;
 
     void clearCurrentMemorySlot(Axis axis);
 
     // Checks to see whether any limit switches have been triggered
     bool limitSwitchTriggered() const;
 
+    // Only set if Axis1LostStepMonitor is enabled
+    const mgo::LostStepMonitor* getAxis1LostStepMonitor() const;
+
+    // Sampled from initialise() onwards, for plotting
+    const mgo::History& getHistory() const;
+
+    // Notified whenever something happens which the control loop should
+    // react to straight away, such as a motor starting or stopping
+    mgo::Wakeup& wakeup();
+
+    // Timings of the control loop's stages (and the display's, which it
+    // shows them with)
+    mgo::Profiler& profiler();
+    const mgo::Profiler& profiler() const;
+
     void lockAxis(unsigned axisNumber);
     void unlockAxis(unsigned axisNumber);
     bool isAxisLocked(unsigned axisNumber) const;
@@ -244,6 +298,7 @@ public:
 
     const IConfigReader& config() const;
 
+    double getStepOver() const;
     void setStepOver(double stepover);
     void setMultiPassStage(MultiPassStage stage);
     void setMultiPassPauseBetweenCuts(bool value);
@@ -252,11 +307,30 @@ public:
 private:
     IGpio& m_gpio;
     IConfigReader& m_config;
+    // Must outlive the motion controller and lost step monitor, which notify it
+    mgo::Wakeup m_wakeup;
+    mgo::Profiler m_profiler;
+    // Must outlive the rotary encoder and motors, which both refer to it
+    std::unique_ptr<mgo::ElectronicLeadscrew> m_leadscrew;
+    // Likewise for the encoder and scales. Only set if capturing edges
+    std::unique_ptr<mgo::EdgeRecorder> m_edgeRecorder;
     std::unique_ptr<mgo::RotaryEncoder> m_rotaryEncoder;
-    // Currently only one linear scale is supported; another could be added for Axis2
-    std::unique_ptr<mgo::LinearScale> m_linearScaleAxis1;
-    std::unique_ptr<mgo::StepperMotor> m_axis1Motor;
-    std::unique_ptr<mgo::StepperMotor> m_axis2Motor;
+    double m_encoderPulsesPerSpindleRev { 0.0 };
+    long m_leadscrewOverruns { 0 };
+    // Keyed by axis number. Only present if they could be set up
+    std::map<unsigned, std::unique_ptr<mgo::LinearScale>> m_linearScales;
+    // Only set if axis1 is to be positioned in closed loop from the scale
+    std::unique_ptr<mgo::ScaleFeedback> m_axis1Feedback;
+    std::chrono::steady_clock::time_point m_axis1FeedbackAt;
+    // All motors are stepped by the motion controller's thread
+    std::unique_ptr<mgo::MotionController> m_motionController;
+    mgo::Motor* m_axis1Motor { nullptr };
+    mgo::Motor* m_axis2Motor { nullptr };
+    // Reads axis1's motor and scale, so is declared after them
+    std::unique_ptr<mgo::LostStepMonitor> m_axis1LostStepMonitor;
+    uint32_t m_axis1LostStepsReported { 0 };
+    // Likewise, as it reads the motors and rotary encoder
+    mgo::History m_history;
     std::vector<long> m_axis1Memory { AXIS1_UNSET, AXIS1_UNSET, AXIS1_UNSET,
                                       AXIS1_UNSET, AXIS1_UNSET, AXIS1_UNSET };
     std::vector<long> m_axis2Memory { AXIS2_UNSET, AXIS2_UNSET, AXIS2_UNSET,
@@ -282,6 +356,16 @@ private:
     float m_taperPreviousXSpeed { 40.f };
     // Stores the current function displayed on the screen:
     Mode m_currentDisplayMode { Mode::None };
+    bool m_showHistory { false };
+    bool m_showProfiler { false };
+    std::optional<Dialog> m_dialog;
+    bool m_encoderPlacementReported { false };
+    std::set<unsigned> m_scalePlacementReported; // axes
+    std::map<unsigned, uint32_t> m_loggedScaleIllegalTransitions; // by axis
+    std::chrono::steady_clock::time_point m_scaleIllegalTransitionsLoggedAt;
+    // Step timing as it was when last logged
+    StepTimingSnapshot m_loggedStepTiming;
+    std::chrono::steady_clock::time_point m_stepTimingLoggedAt;
     // Stores current function, i.e. whether tapering or threading is on
     // we use the same enum class as "mode"
     Mode m_enabledFunction { Mode::None };
@@ -314,10 +398,26 @@ private:
     std::set<unsigned> m_axisLocks;
 
     // Private functions
+    void attachLeadscrew();
+    void axis1GoToStepAtZeroDegrees(long step);
+    void axis1GoToScalePosition(double pos);
+    void axis1CloseLoop();
+    void axis1CheckLostSteps();
+    void logStepTiming();
+    void logLinearScaleIllegalTransitions();
+    void addLinearScale(unsigned axis);
+    mgo::LinearScale* linearScale(unsigned axis) const;
+    bool usingLinearScale(unsigned axis) const;
+    void reportCallbackThreadPlacement();
     void multiPassFinished();
     void multiPassNextCut(mgo::StatusResult& statusResult);
     void multiPassStepOver();
+    std::optional<double> multiPassStepOverTarget() const;
+    void multiPassQueueNextCut();
+    void clearMultiPassQueueWarning();
     void multiPassEndCut(mgo::StatusResult& statusResult);
+    long axis2RetractionSteps() const;
+    void axisNudgeQueued(bool queued);
 };
 
 } // end namespace
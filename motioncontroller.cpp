@@ -0,0 +1,487 @@
+#include "motioncontroller.h"
+
+#include <algorithm>
+
+namespace mgo {
+
+namespace {
+
+// If we notice an armed move's start tick later than this (e.g. because the
+// thread was pre-empted), it starts from now rather than catching up
+constexpr std::chrono::microseconds MAX_ARMED_START_LATENESS { 1'000 };
+
+} // end anonymous namespace
+
+MotionController::MotionController(IGpio& gpio, const ThreadPlacement& placement)
+    : m_gpio(gpio)
+{
+    m_thread = std::thread(&MotionController::threadFunction, this);
+    m_placement = placeThread(m_thread.native_handle(), placement);
+}
+
+MotionController::~MotionController()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_terminate = true;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+}
+
+Motor& MotionController::addMotor(
+    int stepPin,
+    int reversePin,
+    long stepsPerRevolution,
+    double conversionFactor,
+    double maxRpm,
+    const MotionLimits& limits,
+    bool usingMockLinearScale,
+    long linearScaleStepsPerMm)
+{
+    m_motors.push_back(std::make_unique<Motor>(
+        *this,
+        m_gpio,
+        stepPin,
+        reversePin,
+        stepsPerRevolution,
+        conversionFactor,
+        maxRpm,
+        limits,
+        usingMockLinearScale,
+        linearScaleStepsPerMm));
+    m_due.reserve(m_motors.size());
+    return *m_motors.back();
+}
+
+void MotionController::moveLinear(const std::vector<Target>& targets)
+{
+    for (const auto& target : targets) {
+        if (target.motor->isRunning()) {
+            return;
+        }
+    }
+    Segment segment;
+    if (!planSegment(targets, 0.0, false, segment) || segment.axes == 0) {
+        return;
+    }
+    for (const auto& target : targets) {
+        target.motor->m_retargetable = false;
+    }
+    Motor* major = segment.targets[segment.major].motor;
+    const long majorSteps = segment.steps[segment.major];
+    const double peak = segment.profile.peakStepsPerSecond();
+    for (std::size_t n = 0; n < segment.axes; ++n) {
+        if (n != segment.major) {
+            Motor* motor = segment.targets[n].motor;
+            motor->startMockScale(segment.targets[n].step, peak * segment.steps[n] / majorSteps);
+            motor->requestMove(segment.targets[n].step, segment.steps[n], major, majorSteps, {});
+        }
+    }
+    major->m_moveLimits = segment.limits;
+    major->startMockScale(segment.targets[segment.major].step, peak);
+    major->requestMove(
+        segment.targets[segment.major].step, majorSteps, nullptr, 0, std::move(segment.profile));
+}
+
+bool MotionController::queueMove(const std::vector<Target>& targets, double speed)
+{
+    for (const auto& target : targets) {
+        target.motor->syncPlannedPosition();
+    }
+    Segment segment;
+    if (!planSegment(targets, speed, true, segment)) {
+        return false;
+    }
+    if (segment.axes == 0) {
+        return true;
+    }
+    const auto planned = segment.targets;
+    const std::size_t axes = segment.axes;
+    for (std::size_t n = 0; n < axes; ++n) {
+        ++planned[n].motor->m_queued;
+    }
+    if (!m_segments.push(std::move(segment))) {
+        for (std::size_t n = 0; n < axes; ++n) {
+            planned[n].motor->segmentDone();
+        }
+        return false;
+    }
+    for (std::size_t n = 0; n < axes; ++n) {
+        Motor* motor = planned[n].motor;
+        const bool reverse = planned[n].step < motor->m_plannedStep;
+        motor->m_plannedStep = planned[n].step;
+        motor->m_plannedBacklashPosition = reverse ? 0 : motor->m_backlashSize;
+    }
+    wake();
+    return true;
+}
+
+// Works out which motor leads the move, the limits it must observe so that
+// none of the other motors exceeds its own, and the profile it will follow.
+// Motors which don't need to move are left out. Returns false if the move
+// can't be made.
+bool MotionController::planSegment(
+    const std::vector<Target>& targets, double speed, bool fromPlan, Segment& segment) const
+{
+    if (targets.size() > MAX_SEGMENT_AXES) {
+        return false;
+    }
+    long majorSteps = 0;
+    for (const auto& target : targets) {
+        const Motor* motor = target.motor;
+        if (motor->m_synchronised || motor->m_leadscrew) {
+            return false;
+        }
+        const long steps = fromPlan
+            ? motor->physicalSteps(
+                  motor->m_plannedStep, motor->m_plannedBacklashPosition, target.step)
+            : motor->physicalStepsTo(target.step);
+        if (steps == MotionProfile::UNBOUNDED) {
+            return false;
+        }
+        if (steps == 0) {
+            continue;
+        }
+        if (steps > majorSteps) {
+            segment.major = segment.axes;
+            majorSteps = steps;
+        }
+        segment.targets[segment.axes] = target;
+        segment.steps[segment.axes] = steps;
+        ++segment.axes;
+    }
+    if (segment.axes == 0) {
+        return true;
+    }
+    const Motor* major = segment.targets[segment.major].motor;
+    // The other axes move at a fraction of the major axis's speed (and
+    // acceleration), so their limits may restrict how fast it can go
+    MotionLimits limits = major->m_limits;
+    for (std::size_t n = 0; n < segment.axes; ++n) {
+        const Motor* motor = segment.targets[n].motor;
+        if (n == segment.major) {
+            continue;
+        }
+        const double ratio = static_cast<double>(majorSteps) / segment.steps[n];
+        limits.maxStepsPerSecond
+            = std::min(limits.maxStepsPerSecond, motor->m_limits.maxStepsPerSecond * ratio);
+        if (motor->m_limits.acceleration > 0.0) {
+            limits.acceleration
+                = std::min(limits.acceleration, motor->m_limits.acceleration * ratio);
+        }
+        if (motor->m_limits.jerk > 0.0) {
+            limits.jerk = std::min(limits.jerk, motor->m_limits.jerk * ratio);
+        }
+    }
+    segment.limits = limits;
+    double cruise = major->stepsPerSecond();
+    if (speed > 0.0) {
+        const double minRpm = 60.0 / major->m_stepsPerRevolution;
+        const double rpm = std::clamp(major->rpmForSpeed(speed), minRpm, major->m_maxRpm);
+        cruise = rpm * major->m_stepsPerRevolution / 60.0;
+    }
+    if (!major->m_rampingEnabled) {
+        limits.acceleration = 0.0;
+        limits.jerk = 0.0;
+    }
+    segment.profile = MotionProfile(majorSteps, cruise, limits);
+    return true;
+}
+
+bool MotionController::isRunningRealTimeScheduled() const
+{
+    return m_placement.realTime;
+}
+
+const PlacementResult& MotionController::getPlacement() const
+{
+    return m_placement;
+}
+
+StepTimingStats& MotionController::stepTiming()
+{
+    return m_stepTiming;
+}
+
+const StepTimingStats& MotionController::stepTiming() const
+{
+    return m_stepTiming;
+}
+
+void MotionController::setWakeup(Wakeup* wakeup)
+{
+    m_wakeup = wakeup;
+}
+
+void MotionController::motorStartedOrStopped()
+{
+    if (Wakeup* wakeup = m_wakeup.load()) {
+        wakeup->notify();
+    }
+}
+
+void MotionController::wake()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_wake = true;
+    }
+    m_cv.notify_all();
+}
+
+void MotionController::flushSegments()
+{
+    m_flushSegments = true;
+    wake();
+}
+
+bool MotionController::anyBusy() const
+{
+    return !m_segments.empty()
+        || std::any_of(m_motors.begin(), m_motors.end(), [](const auto& motor) {
+               return motor->m_busy.load();
+           });
+}
+
+void MotionController::threadFunction()
+{
+    prefaultStack();
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this]() {
+                return m_terminate || anyBusy();
+            });
+            if (m_terminate) {
+                return;
+            }
+        }
+        run();
+    }
+}
+
+// Steps the motors until none of them has anything left to do
+void MotionController::run()
+{
+    auto now = std::chrono::steady_clock::now();
+    while (!m_terminate) {
+        m_wake = false;
+        if (m_flushSegments.exchange(false)) {
+            if (m_segmentLeader) {
+                // Let the move in progress decelerate, then drop the rest
+                m_segmentLeader->m_stopRequested = true;
+                m_dropSegmentsWhenDone = true;
+            } else {
+                dropSegments();
+            }
+        }
+        if (!m_segmentLeader) {
+            startNextSegment();
+        }
+        bool moving = false;
+        bool armed = false;
+        auto next = std::chrono::steady_clock::time_point::max();
+        for (auto& motor : m_motors) {
+            if (motor->m_busy && !motor->m_moving && !motor->m_lineMaster) {
+                auto start = now;
+                if (motor->m_armed) {
+                    if (motor->m_stopRequested) {
+                        motor->m_stopRequested = false;
+                        motor->m_armed = false;
+                        motor->finishMove();
+                        continue;
+                    }
+                    const auto wait = std::chrono::microseconds(
+                        static_cast<int32_t>(motor->m_startTick - m_gpio.getTick()));
+                    if (wait.count() > 0) {
+                        armed = true;
+                        next = std::min(next, now + wait);
+                        continue;
+                    }
+                    // Time the move from the start tick rather than from
+                    // when we noticed it, unless we're very late
+                    motor->m_armed = false;
+                    start = now + std::max(wait, -MAX_ARMED_START_LATENESS);
+                }
+                for (auto& other : m_motors) {
+                    if (other->m_lineMaster == motor.get()) {
+                        other->setDirection(other->m_reverseRequested);
+                    }
+                }
+                motor->startMove(start);
+                motorStartedOrStopped();
+                if (!motor->m_moving) {
+                    finishLine(motor.get());
+                }
+            }
+            if (motor->m_moving || motor->m_followPending) {
+                moving = true;
+                next = std::min(next, motor->m_deadline);
+            }
+        }
+        if (!moving && !armed) {
+            return;
+        }
+        waitUntil(next);
+        now = std::chrono::steady_clock::now();
+        if (now >= next) {
+            stepDue(now);
+        }
+    }
+}
+
+void MotionController::stepDue(std::chrono::steady_clock::time_point now)
+{
+    m_due.clear();
+    for (auto& motor : m_motors) {
+        if (motor->m_moving && motor->m_deadline <= now) {
+            // Geared motors only step if the spindle has given them a step
+            if (motor->m_leadscrew && !motor->gearedStepDue(now)) {
+                if (!motor->m_moving) {
+                    finishLine(motor.get());
+                }
+                continue;
+            }
+            m_due.push_back(motor.get());
+        }
+    }
+    const std::size_t leaders = m_due.size();
+    for (std::size_t n = 0; n < leaders; ++n) {
+        const auto late = std::chrono::duration_cast<std::chrono::microseconds>(
+            now - m_due[n]->m_deadline);
+        m_stepTiming.record(static_cast<uint32_t>(late.count()));
+    }
+    // Motors in a coordinated move step on the same edge as the
+    // motor leading the move, whenever the DDA says they should
+    for (std::size_t n = 0; n < leaders; ++n) {
+        for (auto& motor : m_motors) {
+            if (motor->m_lineMaster == m_due[n]) {
+                motor->m_lineError += motor->m_lineSteps;
+                if (motor->m_lineError >= motor->m_lineMajorSteps) {
+                    motor->m_lineError -= motor->m_lineMajorSteps;
+                    m_due.push_back(motor.get());
+                }
+            }
+        }
+    }
+    // Followers (tapers, radii) catch up with their masters' earlier steps
+    const std::size_t followers = m_due.size();
+    for (auto& motor : m_motors) {
+        if (motor->followStepDue(now)) {
+            m_due.push_back(motor.get());
+        }
+    }
+    for (Motor* motor : m_due) {
+        m_gpio.setStepPin(motor->m_stepPin, PinState::high);
+    }
+    m_gpio.delayMicroSeconds(STEP_PULSE_MICROSECONDS);
+    for (Motor* motor : m_due) {
+        m_gpio.setStepPin(motor->m_stepPin, PinState::low);
+    }
+    for (std::size_t n = leaders; n < m_due.size(); ++n) {
+        m_due[n]->countStep();
+    }
+    for (std::size_t n = followers; n < m_due.size(); ++n) {
+        m_due[n]->followStepTaken(now);
+    }
+    for (std::size_t n = 0; n < leaders; ++n) {
+        Motor* leader = m_due[n];
+        leader->stepTaken(now);
+        for (auto& motor : m_motors) {
+            if (motor->m_synchronised && motor->m_master == leader) {
+                motor->follow(now);
+            }
+        }
+        if (!leader->m_moving) {
+            finishLine(leader);
+        }
+    }
+}
+
+// Ends the coordinated move (if any) being led by "leader"
+void MotionController::finishLine(Motor* leader)
+{
+    for (auto& motor : m_motors) {
+        if (motor->m_lineMaster == leader) {
+            motor->finishMove();
+        }
+    }
+    if (leader == m_segmentLeader) {
+        segmentFinished();
+    }
+}
+
+// Starts the queued move at the front of the queue, unless one of its
+// motors is still busy with a move of its own
+void MotionController::startNextSegment()
+{
+    Segment* segment = m_segments.front();
+    if (!segment) {
+        return;
+    }
+    for (std::size_t n = 0; n < segment->axes; ++n) {
+        if (segment->targets[n].motor->m_busy) {
+            return;
+        }
+    }
+    Motor* major = segment->targets[segment->major].motor;
+    const long majorSteps = segment->steps[segment->major];
+    const double peak = segment->profile.peakStepsPerSecond();
+    for (std::size_t n = 0; n < segment->axes; ++n) {
+        Motor* motor = segment->targets[n].motor;
+        const long step = segment->targets[n].step;
+        motor->m_segmentMove = true;
+        if (motor == major) {
+            motor->startMockScale(step, peak);
+            // The motor's previous profile is left in the queue's slot,
+            // to be freed by the queuing thread
+            motor->setUpMove(step, majorSteps, nullptr, 0, &segment->profile);
+        } else {
+            motor->startMockScale(step, peak * segment->steps[n] / majorSteps);
+            motor->setUpMove(step, segment->steps[n], major, majorSteps, nullptr);
+        }
+    }
+    m_segmentLeader = major;
+}
+
+void MotionController::segmentFinished()
+{
+    Segment* segment = m_segments.front();
+    for (std::size_t n = 0; n < segment->axes; ++n) {
+        segment->targets[n].motor->segmentDone();
+    }
+    m_segments.pop();
+    m_segmentLeader = nullptr;
+    if (m_dropSegmentsWhenDone) {
+        m_dropSegmentsWhenDone = false;
+        dropSegments();
+    }
+}
+
+void MotionController::dropSegments()
+{
+    while (Segment* segment = m_segments.front()) {
+        for (std::size_t n = 0; n < segment->axes; ++n) {
+            segment->targets[n].motor->segmentDone();
+        }
+        m_segments.pop();
+    }
+}
+
+void MotionController::waitUntil(std::chrono::steady_clock::time_point t)
+{
+    // Wait in slices so a new command for an idle motor isn't held
+    // up until a slow-moving motor's next step is due
+    constexpr auto slice = std::chrono::microseconds(1'000);
+    for (;;) {
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= t || m_wake || m_terminate) {
+            return;
+        }
+        const auto remaining = std::chrono::duration_cast<std::chrono::microseconds>(t - now);
+        m_gpio.delayMicroSeconds(std::min(remaining, slice).count());
+    }
+}
+
+} // end namespace
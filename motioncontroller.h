@@ -0,0 +1,136 @@
+#pragma once
+// Steps every motor axis from a single real-time thread. Independent moves
+// are interleaved by deadline; followers (tapers, radii) are scheduled as
+// their master steps, within their own speed limit, and coordinated moves
+// use a Bresenham-style DDA so that all axes arrive together. Only one
+// real-time core is needed however many axes there are. Moves can also be
+// queued ahead of time, in which case each starts in the same tick as the
+// previous one finishes.
+
+#include "motionprofile.h"
+#include "motor.h"
+#include "realtime.h"
+#include "spscqueue.h"
+#include "steptiming.h"
+#include "stepperControl/igpio.h"
+#include "wakeup.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mgo {
+
+// How long the step pin is held high
+constexpr uint32_t STEP_PULSE_MICROSECONDS = 10;
+// The most motors which can take part in a single move
+constexpr std::size_t MAX_SEGMENT_AXES = 4;
+// The most moves which can be queued at once
+constexpr std::size_t MAX_QUEUED_SEGMENTS = 32;
+
+class MotionController {
+public:
+    explicit MotionController(IGpio& gpio, const ThreadPlacement& placement = {});
+    ~MotionController();
+
+    MotionController(const MotionController&) = delete;
+    MotionController& operator=(const MotionController&) = delete;
+
+    // All motors must be added before any of them are moved
+    Motor& addMotor(
+        int stepPin,
+        int reversePin,
+        long stepsPerRevolution,
+        double conversionFactor,
+        double maxRpm,
+        const MotionLimits& limits,
+        bool usingMockLinearScale = false,
+        long linearScaleStepsPerMm = 200);
+
+    struct Target {
+        Motor* motor;
+        long step;
+    };
+    // Moves all of the given motors in a straight line, starting and
+    // arriving together. The motor with the furthest to go sets the pace at
+    // its current speed, slowed if necessary so no other axis exceeds its
+    // own limits. Ignored if any of the motors is busy.
+    void moveLinear(const std::vector<Target>& targets);
+
+    // Adds a (coordinated, if more than one motor is given) move to the end
+    // of the queue. Each queued move starts as soon as the one before it has
+    // finished, without waiting for the caller. Speed is in mm/min for the
+    // motor with furthest to go; zero means that motor's current speed.
+    // Queued moves are planned from where the motors will be by then (see
+    // Motor::getPlannedStep()). Returns false if the queue is full.
+    // Note moves must only be queued from one thread.
+    bool queueMove(const std::vector<Target>& targets, double speed = 0.0);
+
+    bool isRunningRealTimeScheduled() const;
+    // How the thread's placement (see ThreadPlacement) actually turned out
+    const PlacementResult& getPlacement() const;
+
+    // How late each step has been, compared with when it was due
+    StepTimingStats& stepTiming();
+    const StepTimingStats& stepTiming() const;
+
+    // Notified (from the controller's thread) whenever a motor starts or
+    // finishes a move
+    void setWakeup(Wakeup* wakeup);
+
+private:
+    friend class Motor;
+
+    struct Segment {
+        std::array<Target, MAX_SEGMENT_AXES> targets {};
+        std::array<long, MAX_SEGMENT_AXES> steps {};
+        std::size_t axes { 0 };
+        std::size_t major { 0 }; // index of the motor leading the move
+        MotionLimits limits;
+        MotionProfile profile;
+    };
+
+    IGpio& m_gpio;
+    std::vector<std::unique_ptr<Motor>> m_motors;
+    // Pre-allocated so the step loop doesn't allocate
+    std::vector<Motor*> m_due;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::atomic<bool> m_terminate { false };
+    // Set when a motor has been given a new command
+    std::atomic<bool> m_wake { false };
+
+    SpscQueue<Segment, MAX_QUEUED_SEGMENTS> m_segments;
+    std::atomic<bool> m_flushSegments { false };
+    // Only touched by the controller's thread:
+    Motor* m_segmentLeader { nullptr };
+    bool m_dropSegmentsWhenDone { false };
+
+    PlacementResult m_placement;
+    StepTimingStats m_stepTiming;
+    std::atomic<Wakeup*> m_wakeup { nullptr };
+    std::thread m_thread;
+
+    bool planSegment(
+        const std::vector<Target>& targets, double speed, bool fromPlan, Segment& segment) const;
+    void wake();
+    void motorStartedOrStopped();
+    void flushSegments();
+    bool anyBusy() const;
+    void threadFunction();
+    void run();
+    void stepDue(std::chrono::steady_clock::time_point now);
+    void finishLine(Motor* leader);
+    void startNextSegment();
+    void segmentFinished();
+    void dropSegments();
+    void waitUntil(std::chrono::steady_clock::time_point t);
+};
+
+} // end namespace
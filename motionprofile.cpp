@@ -0,0 +1,211 @@
+#include "motionprofile.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace {
+
+// Timings of the acceleration phase of an S-curve from rest to a given
+// speed. Phase one increases acceleration at the jerk limit, phase two
+// (which may be of zero length) holds acceleration constant, and phase
+// three reduces acceleration back to zero at the jerk limit.
+struct Ramp {
+    double jerkTime { 0.0 }; // duration of phases one and three
+    double constantTime { 0.0 }; // duration of phase two
+    double peakAcceleration { 0.0 };
+    bool trapezoidal { false }; // no jerk limit configured
+
+    double duration() const
+    {
+        return 2.0 * jerkTime + constantTime;
+    }
+};
+
+Ramp calculateRamp(double speed, const mgo::MotionLimits& limits)
+{
+    Ramp r;
+    if (limits.jerk <= 0.0) {
+        r.trapezoidal = true;
+        r.peakAcceleration = limits.acceleration;
+        r.constantTime = speed / limits.acceleration;
+        return r;
+    }
+    const double a = limits.acceleration;
+    const double j = limits.jerk;
+    if (speed >= a * a / j) {
+        r.jerkTime = a / j;
+        r.constantTime = speed / a - r.jerkTime;
+        r.peakAcceleration = a;
+    } else {
+        // We never reach the acceleration limit
+        r.jerkTime = std::sqrt(speed / j);
+        r.peakAcceleration = j * r.jerkTime;
+    }
+    return r;
+}
+
+// Distance (in steps) covered while accelerating from rest to "speed". The
+// velocity curve is symmetrical so the average speed is half the final one.
+double rampDistance(double speed, const mgo::MotionLimits& limits)
+{
+    return speed * calculateRamp(speed, limits).duration() / 2.0;
+}
+
+// Position (in steps) at time t into the ramp
+double rampPosition(const Ramp& r, double jerk, double t)
+{
+    if (r.trapezoidal) {
+        return r.peakAcceleration * t * t / 2.0;
+    }
+    const double t1 = r.jerkTime;
+    const double ap = r.peakAcceleration;
+    if (t <= t1) {
+        return jerk * t * t * t / 6.0;
+    }
+    const double v1 = jerk * t1 * t1 / 2.0;
+    const double s1 = jerk * t1 * t1 * t1 / 6.0;
+    if (t <= t1 + r.constantTime) {
+        const double tau = t - t1;
+        return s1 + v1 * tau + ap * tau * tau / 2.0;
+    }
+    const double v2 = v1 + ap * r.constantTime;
+    const double s2 = s1 + v1 * r.constantTime + ap * r.constantTime * r.constantTime / 2.0;
+    const double tau = std::min(t - t1 - r.constantTime, t1);
+    return s2 + v2 * tau + ap * tau * tau / 2.0 - jerk * tau * tau * tau / 6.0;
+}
+
+uint32_t secondsToDelay(double seconds)
+{
+    double us = std::round(seconds * 1'000'000.0);
+    us = std::clamp(us, 1.0, static_cast<double>(std::numeric_limits<uint32_t>::max()));
+    return static_cast<uint32_t>(us);
+}
+
+} // end anonymous namespace
+
+namespace mgo {
+
+uint32_t stepsPerSecondToDelay(double stepsPerSecond)
+{
+    if (stepsPerSecond <= 0.0) {
+        return std::numeric_limits<uint32_t>::max();
+    }
+    return secondsToDelay(1.0 / stepsPerSecond);
+}
+
+MotionProfile::MotionProfile(long steps, double cruiseStepsPerSecond, const MotionLimits& limits)
+    : m_steps(steps)
+{
+    assert(steps >= 0);
+    double cruise = cruiseStepsPerSecond;
+    if (limits.maxStepsPerSecond > 0.0) {
+        cruise = std::min(cruise, limits.maxStepsPerSecond);
+    }
+    m_peakStepsPerSecond = cruise;
+    if (limits.acceleration <= 0.0 || cruise <= 0.0) {
+        // No ramping required
+        m_cruiseDelay = stepsPerSecondToDelay(cruise);
+        return;
+    }
+    if (steps != UNBOUNDED && 2.0 * rampDistance(cruise, limits) > steps) {
+        // Short move: find the peak speed at which the acceleration
+        // and deceleration ramps just meet.
+        double low = 0.0;
+        double high = cruise;
+        for (int n = 0; n < 50; ++n) {
+            const double mid = (low + high) / 2.0;
+            if (2.0 * rampDistance(mid, limits) > steps) {
+                high = mid;
+            } else {
+                low = mid;
+            }
+        }
+        m_peakStepsPerSecond = low;
+    }
+    m_cruiseDelay = stepsPerSecondToDelay(m_peakStepsPerSecond);
+
+    const Ramp ramp = calculateRamp(m_peakStepsPerSecond, limits);
+    const auto rampSteps
+        = static_cast<std::size_t>(std::floor(rampDistance(m_peakStepsPerSecond, limits)));
+    m_ramp.reserve(rampSteps);
+    const double endTime = ramp.duration();
+    double previousTime = 0.0;
+    for (std::size_t step = 1; step <= rampSteps; ++step) {
+        // Position is monotonic so we can bisect for the time of each step
+        double low = previousTime;
+        double high = endTime;
+        for (int n = 0; n < 40; ++n) {
+            const double mid = (low + high) / 2.0;
+            if (rampPosition(ramp, limits.jerk, mid) < step) {
+                low = mid;
+            } else {
+                high = mid;
+            }
+        }
+        // Never allow a ramp step to be quicker than cruise
+        m_ramp.push_back(std::max(secondsToDelay(high - previousTime), m_cruiseDelay));
+        previousTime = high;
+    }
+}
+
+long MotionProfile::steps() const
+{
+    return m_steps;
+}
+
+std::size_t MotionProfile::rampLength() const
+{
+    return m_ramp.size();
+}
+
+uint32_t MotionProfile::rampDelay(std::size_t level) const
+{
+    if (level >= m_ramp.size()) {
+        return m_cruiseDelay;
+    }
+    return m_ramp[level];
+}
+
+uint32_t MotionProfile::cruiseDelay() const
+{
+    return m_cruiseDelay;
+}
+
+double MotionProfile::peakStepsPerSecond() const
+{
+    return m_peakStepsPerSecond;
+}
+
+uint32_t MotionProfile::delayForStep(long n) const
+{
+    const long ramp = static_cast<long>(m_ramp.size());
+    if (n < ramp) {
+        return m_ramp[n];
+    }
+    if (m_steps != UNBOUNDED && n >= m_steps - ramp) {
+        return m_ramp[std::max(0L, m_steps - 1 - n)];
+    }
+    return m_cruiseDelay;
+}
+
+std::size_t MotionProfile::levelForDelay(uint32_t delay) const
+{
+    // The ramp's delays are in descending order
+    auto it = std::find_if(m_ramp.begin(), m_ramp.end(), [delay](uint32_t d) {
+        return d <= delay;
+    });
+    return std::distance(m_ramp.begin(), it);
+}
+
+double MotionProfile::durationSeconds() const
+{
+    double total = 0.0;
+    for (auto d : m_ramp) {
+        total += 2.0 * d;
+    }
+    total += static_cast<double>(m_steps - 2 * static_cast<long>(m_ramp.size())) * m_cruiseDelay;
+    return total / 1'000'000.0;
+}
+
+} // end namespace
@@ -0,0 +1,63 @@
+#pragma once
+// Jerk-limited ("S-curve") motion profiles. A profile is a table of
+// inter-step delays which is built once per move (i.e. not in the real-time
+// step loop) and then simply read by the motor's step thread.
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace mgo {
+
+// All limits are expressed in motor steps, i.e. steps/sec, steps/sec²
+// and steps/sec³. An acceleration of zero means "no ramping": the motor
+// will start and stop at its cruise speed.
+struct MotionLimits {
+    double maxStepsPerSecond { 0.0 };
+    double acceleration { 0.0 };
+    double jerk { 0.0 };
+};
+
+class MotionProfile {
+public:
+    // Used for moves which have no defined end (e.g. arrow-key motion)
+    static constexpr long UNBOUNDED = std::numeric_limits<long>::max();
+
+    MotionProfile() = default;
+    // Builds the delay table for a move of "steps" steps which should
+    // cruise at cruiseStepsPerSecond. If the move is too short to reach
+    // the cruise speed then the peak speed is lowered such that the
+    // acceleration and deceleration phases meet in the middle.
+    MotionProfile(long steps, double cruiseStepsPerSecond, const MotionLimits& limits);
+
+    long steps() const;
+    // The number of entries in the acceleration ramp. The deceleration
+    // ramp is the same table read backwards.
+    std::size_t rampLength() const;
+    // Delay in microseconds before taking the step *after* ramp level "level"
+    // (level zero being at rest).
+    uint32_t rampDelay(std::size_t level) const;
+    uint32_t cruiseDelay() const;
+    double peakStepsPerSecond() const;
+    // Returns the delay preceding the nth step (zero-based) of the move
+    // if the move runs uninterrupted to completion.
+    uint32_t delayForStep(long n) const;
+    // Finds the ramp level whose delay is closest to (but not shorter than)
+    // the supplied delay. Used to carry on smoothly when a profile is
+    // replaced mid-move (e.g. following a speed change).
+    std::size_t levelForDelay(uint32_t delay) const;
+    // Total time for the move in seconds (only meaningful for bounded moves)
+    double durationSeconds() const;
+
+private:
+    long m_steps { 0 };
+    double m_peakStepsPerSecond { 0.0 };
+    uint32_t m_cruiseDelay { 0 };
+    std::vector<uint32_t> m_ramp;
+};
+
+// Converts a speed in steps/sec to an inter-step delay in microseconds
+uint32_t stepsPerSecondToDelay(double stepsPerSecond);
+
+} // end namespace
@@ -0,0 +1,628 @@
+#include "motor.h"
+#include "electronicleadscrew.h"
+#include "motioncontroller.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace mgo {
+
+namespace {
+
+// Model uses the extremes of the int range to mean "keep going until stopped"
+bool isUnboundedTarget(long step)
+{
+    return step == std::numeric_limits<int>::max() || step == std::numeric_limits<int>::min();
+}
+
+} // end anonymous namespace
+
+Motor::Motor(
+    MotionController& controller,
+    IGpio& gpio,
+    int stepPin,
+    int reversePin,
+    long stepsPerRevolution,
+    double conversionFactor,
+    double maxRpm,
+    const MotionLimits& limits,
+    bool usingMockLinearScale,
+    long linearScaleStepsPerMm)
+    : m_controller(controller)
+    , m_gpio(gpio)
+    , m_stepPin(stepPin)
+    , m_reversePin(reversePin)
+    , m_stepsPerRevolution(stepsPerRevolution)
+    , m_conversionFactor(conversionFactor)
+    , m_maxRpm(maxRpm)
+    , m_limits(limits)
+    , m_usingMockLinearScale(usingMockLinearScale)
+    , m_linearScaleStepsPerMm(linearScaleStepsPerMm)
+{
+    if (m_limits.maxStepsPerSecond <= 0.0) {
+        m_limits.maxStepsPerSecond = m_maxRpm * m_stepsPerRevolution / 60.0;
+    }
+    m_moveLimits = m_limits;
+    setRpm(60.0);
+}
+
+void Motor::goToStep(long step)
+{
+    goTo(step, std::nullopt);
+}
+
+void Motor::goToStepAt(long step, uint32_t tick)
+{
+    goTo(step, tick);
+}
+
+void Motor::goTo(long step, std::optional<uint32_t> startTick)
+{
+    if (isRunning() || m_synchronised) {
+        return;
+    }
+    const long current = m_currentStep;
+    if (step == current) {
+        return;
+    }
+    m_startTick = startTick.value_or(0);
+    m_armed = startTick.has_value();
+    if (m_leadscrew) {
+        // The spindle sets the pace, so there's no profile to follow
+        m_gearedTarget = step;
+        m_retargetable = false;
+        startMockScale(step, stepsPerSecond());
+        requestMove(step, physicalStepsTo(step), nullptr, 0, {});
+        return;
+    }
+    m_moveLimits = m_limits;
+    m_retargetable = true;
+    const long steps = physicalStepsTo(step);
+    MotionProfile profile = buildProfile(steps);
+    startMockScale(step, profile.peakStepsPerSecond());
+    requestMove(step, steps, nullptr, 0, std::move(profile));
+}
+
+void Motor::goToPosition(double mm)
+{
+    goToStep(std::lround(mm / m_conversionFactor));
+}
+
+void Motor::setTargetStep(long step)
+{
+    if (m_retargetable && m_busy) {
+        m_requestedTargetStep = step;
+    }
+}
+
+long Motor::getTargetStep() const
+{
+    return m_targetStep;
+}
+
+void Motor::stop()
+{
+    // Motors in a coordinated move stop along with the one leading it
+    if (m_queued > 0) {
+        m_controller.flushSegments();
+    }
+    Motor* lineMaster = m_lineMaster;
+    if (lineMaster) {
+        lineMaster->stop();
+    } else if (m_busy) {
+        m_stopRequested = true;
+        if (m_armed) {
+            // The controller may be waiting a while for the start tick
+            m_controller.wake();
+        }
+    }
+}
+
+void Motor::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this]() {
+        return !m_busy && m_queued == 0;
+    });
+}
+
+bool Motor::isRunning() const
+{
+    return m_busy || m_queued > 0;
+}
+
+bool Motor::hasQueuedMoves() const
+{
+    return m_queued > 0;
+}
+
+void Motor::setSpeed(double speed)
+{
+    m_speed = speed;
+    setRpm(rpmForSpeed(speed));
+}
+
+double Motor::getSpeed() const
+{
+    return m_speed;
+}
+
+void Motor::setRpm(double rpm)
+{
+    // Never allow a speed so low that a move can take forever
+    const double minRpm = 60.0 / m_stepsPerRevolution;
+    m_rpm = std::clamp(rpm, minRpm, m_maxRpm);
+    if (m_busy && !m_lineMaster && !m_segmentMove && !m_leadscrew) {
+        publishProfile(buildProfile(m_stepsRemaining));
+    }
+}
+
+double Motor::getRpm() const
+{
+    return m_rpm;
+}
+
+double Motor::getMaxRpm() const
+{
+    return m_maxRpm;
+}
+
+void Motor::enableRamping(bool flag)
+{
+    m_rampingEnabled = flag;
+}
+
+long Motor::getCurrentStep() const
+{
+    return m_currentStep;
+}
+
+long Motor::getPlannedStep() const
+{
+    return m_queued > 0 ? m_plannedStep : m_currentStep.load();
+}
+
+long Motor::getCurrentStepWithoutBacklashCompensation() const
+{
+    return m_physicalStep;
+}
+
+double Motor::getPosition() const
+{
+    return getPosition(m_currentStep);
+}
+
+double Motor::getPosition(long step) const
+{
+    return step * m_conversionFactor;
+}
+
+void Motor::setPosition(double mm)
+{
+    m_currentStep = std::lround(mm / m_conversionFactor);
+}
+
+void Motor::zeroPosition()
+{
+    m_currentStep = 0;
+}
+
+double Motor::getConversionFactor() const
+{
+    return m_conversionFactor;
+}
+
+void Motor::setBacklashCompensation(long size, long initialPosition)
+{
+    m_backlashSize = size;
+    m_backlashPosition = std::clamp(initialPosition, 0L, size);
+}
+
+void Motor::synchroniseOn(
+    const Motor* master,
+    std::function<double(double, double)> fn,
+    bool useZeroAsSyncStartPos)
+{
+    synchroniseOff();
+    wait();
+    m_master = master;
+    m_syncFunction = fn;
+    m_masterStartPosition = useZeroAsSyncStartPos ? 0.0 : master->getPosition();
+    m_followerStartPosition = useZeroAsSyncStartPos ? 0.0 : getPosition();
+    m_synchronised = true;
+}
+
+void Motor::synchroniseOff()
+{
+    m_synchronised = false;
+    // Don't return until the controller's thread has
+    // finished with the sync function (if it was using it)
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this]() {
+        return !m_following;
+    });
+}
+
+void Motor::setLeadscrew(ElectronicLeadscrew* leadscrew)
+{
+    m_leadscrew = leadscrew;
+}
+
+bool Motor::isGeared() const
+{
+    return m_leadscrew != nullptr;
+}
+
+long Motor::physicalSteps(long from, long backlashPosition, long to) const
+{
+    if (isUnboundedTarget(to)) {
+        return MotionProfile::UNBOUNDED;
+    }
+    if (to == from) {
+        return 0;
+    }
+    const long backlashTakeUp = to < from ? backlashPosition : m_backlashSize - backlashPosition;
+    return std::abs(to - from) + backlashTakeUp;
+}
+
+long Motor::physicalStepsTo(long step) const
+{
+    return physicalSteps(m_currentStep, m_backlashPosition, step);
+}
+
+// Queued moves are planned from where the motor will be once the moves
+// ahead of them are complete. With nothing queued that's where it is now.
+void Motor::syncPlannedPosition()
+{
+    if (!isRunning()) {
+        m_plannedStep = m_currentStep;
+        m_plannedBacklashPosition = m_backlashPosition;
+    }
+}
+
+void Motor::requestMove(
+    long step, long steps, Motor* lineMaster, long lineMajorSteps, MotionProfile profile)
+{
+    setUpMove(step, steps, lineMaster, lineMajorSteps, &profile);
+    m_controller.wake();
+}
+
+// Sets up a move for the controller's thread to carry out. If "lineMaster" is
+// set, this motor is being driven by that motor's steps as part of a
+// coordinated move, and "lineMajorSteps" is the length of the master's move.
+// Any profile is swapped in, so "profile" is left holding the previous one
+// (which means this never frees memory, so is safe to call from the
+// controller's thread).
+void Motor::setUpMove(
+    long step, long steps, Motor* lineMaster, long lineMajorSteps, MotionProfile* profile)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (profile) {
+        std::swap(m_profile, *profile);
+    }
+    m_profilePending = false;
+    m_stepsRemaining = steps;
+    m_targetStep = step;
+    m_requestedTargetStep = NO_TARGET;
+    m_reverseRequested = step < m_currentStep;
+    m_stopRequested = false;
+    m_lineSteps = steps;
+    m_lineMajorSteps = lineMajorSteps;
+    // Starting half way gives Bresenham's rounding to the nearest step
+    m_lineError = lineMajorSteps / 2;
+    m_lineMaster = lineMaster;
+    m_busy = true;
+}
+
+void Motor::publishProfile(MotionProfile profile)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pendingProfile = std::move(profile);
+    m_profilePending = true;
+}
+
+MotionProfile Motor::buildProfile(long steps) const
+{
+    if (m_rampingEnabled) {
+        return MotionProfile(steps, stepsPerSecond(), m_moveLimits);
+    }
+    MotionLimits noRamp;
+    noRamp.maxStepsPerSecond = m_moveLimits.maxStepsPerSecond;
+    return MotionProfile(steps, stepsPerSecond(), noRamp);
+}
+
+double Motor::stepsPerSecond() const
+{
+    return m_rpm * m_stepsPerRevolution / 60.0;
+}
+
+double Motor::rpmForSpeed(double speed) const
+{
+    return std::abs(speed / m_conversionFactor / m_stepsPerRevolution);
+}
+
+void Motor::startMockScale([[maybe_unused]] long step, [[maybe_unused]] double stepsPerSecond)
+{
+#ifdef FAKE
+    if (m_usingMockLinearScale) {
+        m_gpio.scaleSetSpeedStepsPerSec(
+            stepsPerSecond * std::abs(m_conversionFactor) * m_linearScaleStepsPerMm);
+        m_gpio.scaleGoToPositionMm(getPosition(step));
+    }
+#endif
+}
+
+void Motor::startMove(std::chrono::steady_clock::time_point now)
+{
+    setDirection(m_reverseRequested);
+    m_level = 0;
+    m_delay = 0;
+    m_deadline = now;
+    m_moving = true;
+    if (ElectronicLeadscrew* leadscrew = m_leadscrew) {
+        m_lastGearedStep = now - std::chrono::hours(1);
+        leadscrew->engage();
+        return;
+    }
+    if (!advance()) {
+        finishMove();
+    }
+}
+
+// Works out when the next step is due. Returns false if the move is complete.
+bool Motor::advance()
+{
+    long remaining = m_stepsRemaining;
+    if (m_stopRequested) {
+        // Decelerate down the ramp from wherever we currently are on it
+        m_stopRequested = false;
+        remaining = std::min(remaining, static_cast<long>(m_level));
+        m_stepsRemaining = remaining;
+    } else if (m_requestedTargetStep.load(std::memory_order_relaxed) != NO_TARGET) {
+        remaining = retarget(m_requestedTargetStep.exchange(NO_TARGET), remaining);
+    }
+    if (remaining == 0) {
+        return false;
+    }
+    if (m_profilePending) {
+        adoptPendingProfile();
+    }
+    if (remaining <= static_cast<long>(m_level)) {
+        --m_level;
+        m_delay = m_profile.rampDelay(m_level);
+    } else if (m_level < m_profile.rampLength()) {
+        m_delay = m_profile.rampDelay(m_level);
+        ++m_level;
+    } else {
+        m_delay = m_profile.cruiseDelay();
+    }
+    m_deadline += std::chrono::microseconds(m_delay);
+    return true;
+}
+
+// Moves the end of the move as close to "requested" as we can, and returns
+// the number of steps now remaining
+long Motor::retarget(long requested, long remaining)
+{
+    // Coordinated moves can't have one axis changing on its own
+    if (requested == NO_TARGET || remaining == MotionProfile::UNBOUNDED || m_lineMaster
+        || m_segmentMove) {
+        return remaining;
+    }
+    const long target = m_targetStep;
+    const long change = m_reverse ? target - requested : requested - target;
+    // We can't go backwards, nor stop short of the deceleration ramp
+    const long adjusted
+        = std::max(remaining + change, std::min(remaining, static_cast<long>(m_level)));
+    const long applied = adjusted - remaining;
+    m_targetStep = m_reverse ? target - applied : target + applied;
+    m_stepsRemaining = adjusted;
+    return adjusted;
+}
+
+void Motor::stepTaken(std::chrono::steady_clock::time_point now)
+{
+    countStep();
+    if (ElectronicLeadscrew* leadscrew = m_leadscrew) {
+        m_lastGearedStep = now;
+        if (m_currentStep == m_gearedTarget) {
+            leadscrew->disengage();
+            finishMove();
+        }
+        // Look for the next step straight away
+        m_deadline = now;
+        return;
+    }
+    const long remaining = m_stepsRemaining;
+    if (remaining != MotionProfile::UNBOUNDED) {
+        m_stepsRemaining = remaining - 1;
+    }
+    if (now - m_deadline > std::chrono::microseconds(m_delay)) {
+        // We've been pre-empted for longer than a whole step. Don't
+        // try to catch up with a burst of steps, just carry on from here.
+        m_deadline = now;
+    }
+    if (!advance()) {
+        finishMove();
+    }
+}
+
+void Motor::finishMove()
+{
+    m_moving = false;
+#ifdef FAKE
+    if (m_usingMockLinearScale) {
+        m_gpio.scaleGoToPositionMm(getPosition());
+    }
+#endif
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_lineMaster = nullptr;
+        m_busy = false;
+    }
+    m_cv.notify_all();
+    m_controller.motorStartedOrStopped();
+}
+
+void Motor::segmentDone()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        --m_queued;
+        m_segmentMove = false;
+    }
+    m_cv.notify_all();
+}
+
+void Motor::adoptPendingProfile()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // Swapping (rather than assigning) means any memory is freed
+    // outside of this thread, the next time a profile is published.
+    std::swap(m_profile, m_pendingProfile);
+    m_profilePending = false;
+    m_level = m_delay == 0 ? 0 : m_profile.levelForDelay(m_delay);
+}
+
+void Motor::setDirection(bool reverse)
+{
+    m_reverse = reverse;
+    m_gpio.setReversePin(m_reversePin, reverse ? PinState::high : PinState::low);
+    // Allow the driver's direction setup time before the next step
+    m_gpio.delayMicroSeconds(5);
+}
+
+void Motor::countStep()
+{
+    // Any backlash has to be taken up before the logical position changes
+    if (m_reverse) {
+        --m_physicalStep;
+        if (m_backlashPosition > 0) {
+            --m_backlashPosition;
+        } else {
+            --m_currentStep;
+        }
+    } else {
+        ++m_physicalStep;
+        if (m_backlashPosition < m_backlashSize) {
+            ++m_backlashPosition;
+        } else {
+            ++m_currentStep;
+        }
+    }
+}
+
+// Called each time the master steps: works out where the sync function says
+// we should be, and if that's somewhere else, schedules our next step
+void Motor::follow(std::chrono::steady_clock::time_point now)
+{
+    m_following = true;
+    if (!m_synchronised) {
+        m_followPending = false;
+        stopFollowing();
+        return;
+    }
+    const double masterPosition = m_master->getPosition();
+    const double required = m_followerStartPosition
+        + m_syncFunction(masterPosition - m_masterStartPosition, masterPosition);
+    m_followTarget = std::lround(required / m_conversionFactor);
+    if (m_currentStep == m_followTarget) {
+        m_followPending = false;
+        stopFollowing();
+    } else if (!m_followPending) {
+        m_followPending = true;
+        m_deadline = std::max(now, m_lastFollowStep + followInterval());
+    }
+}
+
+// Returns true if a step towards the follow target is due now
+bool Motor::followStepDue(std::chrono::steady_clock::time_point now)
+{
+    if (!m_followPending || m_deadline > now) {
+        return false;
+    }
+    if (!m_synchronised) {
+        // Synchronisation's been turned off, so we stop where we are
+        m_followPending = false;
+        stopFollowing();
+        return false;
+    }
+    const bool reverse = m_followTarget < m_currentStep;
+    if (reverse != m_reverse) {
+        setDirection(reverse);
+    }
+    return true;
+}
+
+void Motor::followStepTaken(std::chrono::steady_clock::time_point now)
+{
+    m_lastFollowStep = now;
+    if (m_currentStep == m_followTarget) {
+        m_followPending = false;
+        stopFollowing();
+    } else {
+        m_deadline = now + followInterval();
+    }
+}
+
+// A master's step can call for several of ours (e.g. near the tangent of a
+// radius), which are taken no faster than our limits allow
+std::chrono::microseconds Motor::followInterval() const
+{
+    return std::chrono::microseconds(stepsPerSecondToDelay(m_limits.maxStepsPerSecond));
+}
+
+void Motor::stopFollowing()
+{
+    m_following = false;
+    // Only synchroniseOff() waits for this, having cleared m_synchronised
+    // first, so there's no need to take the lock while we're synchronised
+    if (!m_synchronised) {
+        {
+            // So the waiter is either yet to check m_following or is
+            // already waiting, and can't miss the notification
+            std::lock_guard<std::mutex> lock(m_mutex);
+        }
+        m_cv.notify_all();
+    }
+}
+
+// For geared moves, which have no profile: returns true if the leadscrew has
+// a step due now, otherwise sets the deadline for when to look again
+bool Motor::gearedStepDue(std::chrono::steady_clock::time_point now)
+{
+    ElectronicLeadscrew* leadscrew = m_leadscrew;
+    if (m_stopRequested || m_currentStep == m_gearedTarget) {
+        // There's no ramp to follow, so we stop dead
+        m_stopRequested = false;
+        leadscrew->disengage();
+        finishMove();
+        return false;
+    }
+    const ElectronicLeadscrew::Step* step = leadscrew->nextStep();
+    if (!step) {
+        m_deadline = now + std::chrono::microseconds(leadscrew->getLatencyMicroseconds() / 4);
+        return false;
+    }
+    const auto wait = static_cast<int32_t>(step->tick - m_gpio.getTick());
+    auto due = now + std::chrono::microseconds(std::max(wait, 0));
+    // If we've been held up, catch up no faster than the motor can go
+    const auto minInterval
+        = std::chrono::microseconds(stepsPerSecondToDelay(m_limits.maxStepsPerSecond));
+    due = std::max(due, m_lastGearedStep + minInterval);
+    m_deadline = due;
+    if (due > now) {
+        return false;
+    }
+    // A forward step is towards the target. If the spindle is turned
+    // backwards, so is the motor, which keeps it in step with the thread.
+    const bool reverse = step->forward ? m_reverseRequested : !m_reverseRequested;
+    leadscrew->popStep();
+    if (reverse != m_reverse) {
+        setDirection(reverse);
+    }
+    return true;
+}
+
+} // end namespace
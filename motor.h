@@ -0,0 +1,225 @@
+#pragma once
+// A single stepper motor axis. Motors don't have threads of their own: all
+// of them are stepped by their MotionController's real-time thread. Step
+// timing comes from a MotionProfile, which is built when a move is requested
+// (or the speed changes), so the step loop itself only has to look up the
+// next delay in a table.
+
+#include "motionprofile.h"
+#include "stepperControl/igpio.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <optional>
+
+namespace mgo {
+
+class ElectronicLeadscrew;
+class MotionController;
+
+class Motor {
+public:
+    // Motors are created via MotionController::addMotor()
+    Motor(
+        MotionController& controller,
+        IGpio& gpio,
+        int stepPin,
+        int reversePin,
+        long stepsPerRevolution,
+        double conversionFactor, // i.e. mm per step
+        double maxRpm,
+        const MotionLimits& limits,
+        bool usingMockLinearScale = false,
+        long linearScaleStepsPerMm = 200);
+
+    Motor(const Motor&) = delete;
+    Motor& operator=(const Motor&) = delete;
+
+    // Requests are ignored if the motor is already busy; stop() and wait() first.
+    void goToStep(long step);
+    // As goToStep(), but the move is armed to start when the GPIO tick
+    // reaches "tick" (e.g. so each pass of a thread starts at the same
+    // spindle angle). The controller's thread waits for it, not the caller.
+    void goToStepAt(long step, uint32_t tick);
+    void goToPosition(double mm);
+    // Moves the end of a move started by goToStep() while it's under way
+    // (e.g. to correct it from a linear scale). The controller's thread makes
+    // as much of the change as it can without reversing or stopping sooner
+    // than it can decelerate, so see getTargetStep() for where it will end.
+    void setTargetStep(long step);
+    // Where the current (or last) move ends
+    long getTargetStep() const;
+    // Decelerates to a halt (immediately if ramping is disabled). Any
+    // queued moves (see MotionController::queueMove()) are abandoned.
+    void stop();
+    // Waits until the motor has stopped and has no queued moves left
+    void wait();
+    bool isRunning() const;
+    bool hasQueuedMoves() const;
+
+    // Speed is in units (normally mm) per minute
+    void setSpeed(double speed);
+    double getSpeed() const;
+    void setRpm(double rpm);
+    double getRpm() const;
+    double getMaxRpm() const;
+    void enableRamping(bool flag);
+
+    long getCurrentStep() const;
+    // Where the motor will be once all of its queued moves are complete
+    long getPlannedStep() const;
+    long getCurrentStepWithoutBacklashCompensation() const;
+    double getPosition() const;
+    double getPosition(long step) const;
+    void setPosition(double mm);
+    void zeroPosition();
+    double getConversionFactor() const;
+
+    // "size" is the number of steps of slop. "initialPosition" is where in
+    // that slop we currently are, so size/size means any backlash has already
+    // been taken up in the forward direction.
+    void setBacklashCompensation(long size, long initialPosition);
+
+    // Causes this motor to follow the master. The supplied function is given
+    // the master's change in position since synchronisation started, and the
+    // master's current position, and returns this motor's required offset.
+    // If useZeroAsSyncStartPos is set, offsets are from zero on both axes
+    // rather than from where each axis was when synchronisation started.
+    // The follower's steps are scheduled as each of the master's is taken,
+    // no faster than the follower's own maximum speed, so it's never more
+    // than a step behind unless the sync function asks more of it than that.
+    void synchroniseOn(
+        const Motor* master,
+        std::function<double(double, double)> fn,
+        bool useZeroAsSyncStartPos = false);
+    void synchroniseOff();
+
+    // While a leadscrew is attached, this motor's moves are driven by the
+    // spindle instead of by its own speed: each step is taken when the
+    // spindle has turned far enough (see ElectronicLeadscrew). Pass nullptr
+    // to detach it. Only change this while the motor is stopped.
+    void setLeadscrew(ElectronicLeadscrew* leadscrew);
+    bool isGeared() const;
+
+private:
+    friend class MotionController;
+
+    MotionController& m_controller;
+    IGpio& m_gpio;
+    int m_stepPin;
+    int m_reversePin;
+    long m_stepsPerRevolution;
+    double m_conversionFactor;
+    double m_maxRpm;
+    MotionLimits m_limits;
+    // The limits for the current move, which may be lower than
+    // our own if this motor is leading a coordinated move
+    MotionLimits m_moveLimits;
+    // Only used in FAKE builds, to drive the mock scale along with the motor
+    [[maybe_unused]] bool m_usingMockLinearScale;
+    [[maybe_unused]] long m_linearScaleStepsPerMm;
+
+    std::atomic<double> m_speed { 0.0 };
+    std::atomic<double> m_rpm { 0.0 };
+    std::atomic<bool> m_rampingEnabled { true };
+
+    std::atomic<long> m_currentStep { 0 };
+    std::atomic<long> m_physicalStep { 0 };
+    long m_backlashSize { 0 };
+    long m_backlashPosition { 0 };
+    bool m_reverse { false };
+
+    // Command state, shared with the controller's thread. m_busy is set
+    // (last) by the requesting thread and cleared by the controller thread.
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::atomic<bool> m_busy { false };
+    // Set if the move mustn't start until m_startTick (see goToStepAt())
+    std::atomic<bool> m_armed { false };
+    std::atomic<uint32_t> m_startTick { 0 };
+    std::atomic<bool> m_stopRequested { false };
+    std::atomic<long> m_stepsRemaining { 0 };
+    bool m_reverseRequested { false };
+    MotionProfile m_profile;
+    MotionProfile m_pendingProfile;
+    std::atomic<bool> m_profilePending { false };
+    // Moves queued with the controller which involve this motor
+    std::atomic<int> m_queued { 0 };
+    std::atomic<bool> m_segmentMove { false };
+    // Only used by the thread queuing moves
+    long m_plannedStep { 0 };
+    long m_plannedBacklashPosition { 0 };
+
+    // Retargeting (see setTargetStep()). m_retargetable is only used by
+    // the requesting thread.
+    static constexpr long NO_TARGET = std::numeric_limits<long>::min();
+    bool m_retargetable { false };
+    std::atomic<long> m_targetStep { 0 };
+    std::atomic<long> m_requestedTargetStep { NO_TARGET };
+
+    // Only touched by the controller's thread while a move is in progress
+    bool m_moving { false };
+    std::size_t m_level { 0 };
+    uint32_t m_delay { 0 };
+    std::chrono::steady_clock::time_point m_deadline;
+
+    // Synchronisation with another motor (tapers, radii)
+    std::atomic<bool> m_synchronised { false };
+    std::atomic<bool> m_following { false };
+    const Motor* m_master { nullptr };
+    std::function<double(double, double)> m_syncFunction;
+    double m_masterStartPosition { 0.0 };
+    double m_followerStartPosition { 0.0 };
+    // Only touched by the controller's thread
+    long m_followTarget { 0 };
+    bool m_followPending { false };
+    std::chrono::steady_clock::time_point m_lastFollowStep;
+
+    // Coordinated (straight line) move, driven by another motor's steps
+    std::atomic<Motor*> m_lineMaster { nullptr };
+    long m_lineSteps { 0 };
+    long m_lineMajorSteps { 0 };
+    long m_lineError { 0 };
+
+    // Geared (electronic leadscrew) move
+    std::atomic<ElectronicLeadscrew*> m_leadscrew { nullptr };
+    long m_gearedTarget { 0 };
+    std::chrono::steady_clock::time_point m_lastGearedStep;
+
+    void goTo(long step, std::optional<uint32_t> startTick);
+    long physicalSteps(long from, long backlashPosition, long to) const;
+    long physicalStepsTo(long step) const;
+    void syncPlannedPosition();
+    void requestMove(
+        long step, long steps, Motor* lineMaster, long lineMajorSteps, MotionProfile profile);
+    void setUpMove(
+        long step, long steps, Motor* lineMaster, long lineMajorSteps, MotionProfile* profile);
+    void publishProfile(MotionProfile profile);
+    MotionProfile buildProfile(long steps) const;
+    double stepsPerSecond() const;
+    double rpmForSpeed(double speed) const;
+    void startMockScale(long step, double stepsPerSecond);
+
+    // Called from the controller's thread:
+    void startMove(std::chrono::steady_clock::time_point now);
+    bool advance();
+    long retarget(long requested, long remaining);
+    void stepTaken(std::chrono::steady_clock::time_point now);
+    void finishMove();
+    void segmentDone();
+    void adoptPendingProfile();
+    void setDirection(bool reverse);
+    void countStep();
+    void follow(std::chrono::steady_clock::time_point now);
+    bool followStepDue(std::chrono::steady_clock::time_point now);
+    void followStepTaken(std::chrono::steady_clock::time_point now);
+    std::chrono::microseconds followInterval() const;
+    void stopFollowing();
+    bool gearedStepDue(std::chrono::steady_clock::time_point now);
+};
+
+} // end namespace
@@ -0,0 +1,66 @@
+#include "profiler.h"
+
+#include <algorithm>
+
+namespace mgo {
+
+std::string_view profileStageName(ProfileStage stage)
+{
+    switch (stage) {
+        case ProfileStage::Iteration:
+            return "Loop iteration";
+        case ProfileStage::GetEvents:
+            return "getEvents";
+        case ProfileStage::ProcessKeyPress:
+            return "processKeyPress";
+        case ProfileStage::CheckStatus:
+            return "checkStatus";
+        case ProfileStage::UpdateDisplay:
+            return "updateDisplay";
+        case ProfileStage::UpdateText:
+            return "Update text";
+        case ProfileStage::Draw:
+            return "Draw";
+        case ProfileStage::Display:
+            return "display()";
+    }
+    return "";
+}
+
+void Profiler::record(ProfileStage stage, Clock::time_point start)
+{
+    const int64_t nanoseconds
+        = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    Stage& s = m_stages[static_cast<std::size_t>(stage)];
+    const uint64_t count = s.count.load(std::memory_order_relaxed);
+    s.nanoseconds[count & (PROFILE_HISTORY - 1)].store(nanoseconds, std::memory_order_relaxed);
+    if (nanoseconds > s.worstNanoseconds.load(std::memory_order_relaxed)) {
+        s.worstNanoseconds.store(nanoseconds, std::memory_order_relaxed);
+    }
+    s.count.store(count + 1, std::memory_order_release);
+}
+
+ProfileSummary Profiler::summary(ProfileStage stage) const
+{
+    // A run recorded while we're reading may replace one of those we add
+    // up, which is no matter for a rolling average
+    const Stage& s = m_stages[static_cast<std::size_t>(stage)];
+    ProfileSummary summary;
+    summary.count = s.count.load(std::memory_order_acquire);
+    const std::size_t runs = std::min<uint64_t>(summary.count, PROFILE_HISTORY);
+    int64_t total = 0;
+    int64_t max = 0;
+    for (std::size_t n = 0; n < runs; ++n) {
+        const int64_t nanoseconds = s.nanoseconds[n].load(std::memory_order_relaxed);
+        total += nanoseconds;
+        max = std::max(max, nanoseconds);
+    }
+    if (runs > 0) {
+        summary.meanMicroseconds = total / 1'000.0 / runs;
+    }
+    summary.maxMicroseconds = max / 1'000.0;
+    summary.worstMicroseconds = s.worstNanoseconds.load(std::memory_order_relaxed) / 1'000.0;
+    return summary;
+}
+
+} // end namespace
@@ -0,0 +1,62 @@
+#pragma once
+// How long each stage of the control loop, and of drawing the display, has
+// been taking. Each stage keeps the durations of its most recent runs in a
+// small ring, from which a rolling average and the worst case are worked
+// out. A stage must only be timed by one thread (the control loop's or the
+// render thread's), but any thread can read the results, without locking.
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace mgo {
+
+enum class ProfileStage {
+    // The control loop's, from Controller::run()
+    Iteration, // all of the below, i.e. everything but waiting for input
+    GetEvents,
+    ProcessKeyPress, // including GetEvents
+    CheckStatus,
+    UpdateDisplay,
+    // The render thread's, from ViewSfml::render()
+    UpdateText,
+    Draw,
+    Display
+};
+
+constexpr std::size_t PROFILE_STAGES = 8;
+// Must be a power of two
+constexpr std::size_t PROFILE_HISTORY = 64;
+
+std::string_view profileStageName(ProfileStage stage);
+
+struct ProfileSummary {
+    // Over the last PROFILE_HISTORY runs (or however many there have been)
+    double meanMicroseconds { 0.0 };
+    double maxMicroseconds { 0.0 };
+    // Since startup
+    double worstMicroseconds { 0.0 };
+    uint64_t count { 0 };
+};
+
+class Profiler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Records a run of "stage" which started at "start" and ended now
+    void record(ProfileStage stage, Clock::time_point start);
+    ProfileSummary summary(ProfileStage stage) const;
+
+private:
+    struct Stage {
+        std::array<std::atomic<int64_t>, PROFILE_HISTORY> nanoseconds {};
+        std::atomic<uint64_t> count { 0 };
+        std::atomic<int64_t> worstNanoseconds { 0 };
+    };
+    std::array<Stage, PROFILE_STAGES> m_stages;
+};
+
+} // end namespace
@@ -0,0 +1,146 @@
+#include "realtime.h"
+
+#include "log.h"
+
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <sstream>
+
+#include <fmt/format.h>
+
+namespace mgo {
+
+ThreadPlacement readThreadPlacement(const IConfigReader& config, const std::string& prefix)
+{
+    ThreadPlacement placement;
+    const std::string cpu = config.read(prefix + "Cpu", "");
+    if (!cpu.empty()) {
+        // A typo here shouldn't stop the lathe starting, it just means the
+        // thread runs on whichever CPU it's given
+        int value = -1;
+        const auto [end, ec] = std::from_chars(cpu.data(), cpu.data() + cpu.size(), value);
+        if (ec == std::errc() && end == cpu.data() + cpu.size() && value >= 0) {
+            placement.cpu = value;
+        } else {
+            MGOLOG(fmt::format(
+                "*** Warning *** ignoring {}Cpu = {}, which isn't a CPU number", prefix, cpu));
+        }
+    }
+    placement.priority = config.readLong(prefix + "Priority", 0);
+    return placement;
+}
+
+bool PlacementResult::ok() const
+{
+    return realTime && (cpu < 0 || pinned);
+}
+
+std::string PlacementResult::describe(const std::string& threadName) const
+{
+    std::string description = realTime
+        ? fmt::format("{}: SCHED_FIFO priority {}", threadName, priority)
+        : fmt::format("{}: *** NOT real-time ***", threadName);
+    if (cpu >= 0) {
+        description += pinned ? fmt::format(", pinned to CPU {}", cpu)
+                              : fmt::format(", *** NOT pinned to CPU {} ***", cpu);
+    }
+    return description;
+}
+
+PlacementResult placeThread(pthread_t thread, const ThreadPlacement& placement)
+{
+    const int maxPriority = sched_get_priority_max(SCHED_FIFO);
+    sched_param sch {};
+    sch.sched_priority
+        = placement.priority > 0 ? std::min(placement.priority, maxPriority) : maxPriority;
+    pthread_setschedparam(thread, SCHED_FIFO, &sch);
+    if (placement.cpu >= 0 && placement.cpu < CPU_SETSIZE) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(placement.cpu, &cpus);
+        pthread_setaffinity_np(thread, sizeof(cpus), &cpus);
+    }
+
+    // We report what the thread actually has, rather than trusting the above
+    PlacementResult result;
+    int policy = 0;
+    if (pthread_getschedparam(thread, &policy, &sch) == 0) {
+        result.realTime = policy == SCHED_FIFO;
+        result.priority = sch.sched_priority;
+    }
+    result.cpu = placement.cpu;
+    if (placement.cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        if (pthread_getaffinity_np(thread, sizeof(cpus), &cpus) == 0) {
+            result.pinned = CPU_COUNT(&cpus) == 1 && CPU_ISSET(placement.cpu, &cpus);
+        }
+    }
+    return result;
+}
+
+void prefaultStack()
+{
+    // Volatile so the compiler can't optimise the writes away
+    [[maybe_unused]] volatile unsigned char stack[PREFAULT_STACK_BYTES];
+    for (std::size_t n = 0; n < PREFAULT_STACK_BYTES; n += 1'024) {
+        stack[n] = 0;
+    }
+}
+
+bool lockMemory()
+{
+    int flags = MCL_CURRENT | MCL_FUTURE;
+#ifdef MCL_ONFAULT
+    // Only lock pages once they're used, otherwise every thread's (mostly
+    // unused) stack would be faulted in in full. Stacks we care about
+    // are faulted in by prefaultStack().
+    flags |= MCL_ONFAULT;
+#endif
+    if (mlockall(flags) == 0) {
+        return true;
+    }
+    const int error = errno;
+    std::string reason = std::strerror(error);
+    rlimit limit {};
+    if ((error == ENOMEM || error == EPERM) && getrlimit(RLIMIT_MEMLOCK, &limit) == 0
+        && limit.rlim_cur != RLIM_INFINITY) {
+        // Usually the case when not running as root: the default limit is
+        // far less than the process needs
+        reason += fmt::format(
+            "; RLIMIT_MEMLOCK is only {} KB, raise it with \"ulimit -l unlimited\" or in "
+            "/etc/security/limits.conf, or set LockMemory = false",
+            limit.rlim_cur / 1'024);
+    }
+    MGOLOG("*** Warning *** mlockall() failed: " + reason);
+    return false;
+}
+
+void DeferredPlacement::request(const ThreadPlacement& placement)
+{
+    m_placement = placement;
+    m_state.store(State::Requested, std::memory_order_release);
+}
+
+std::optional<PlacementResult> DeferredPlacement::result() const
+{
+    if (m_state.load(std::memory_order_acquire) != State::Applied) {
+        return std::nullopt;
+    }
+    return m_result;
+}
+
+void DeferredPlacement::applyNow()
+{
+    m_result = placeThread(pthread_self(), m_placement);
+    prefaultStack();
+    m_state.store(State::Applied, std::memory_order_release);
+}
+
+} // end namespace
@@ -0,0 +1,82 @@
+#pragma once
+// Helpers for keeping time-critical threads on time: SCHED_FIFO scheduling,
+// pinning to a CPU (ideally one kept free of everything else with the
+// isolcpus kernel parameter), locking the process's memory so it is never
+// paged out, and faulting in thread stacks before they are needed.
+
+#include "configreader.h"
+
+#include <pthread.h>
+
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <string>
+
+namespace mgo {
+
+constexpr std::size_t PREFAULT_STACK_BYTES = 64 * 1'024;
+
+struct ThreadPlacement {
+    int cpu { -1 }; // -1 to allow any CPU
+    int priority { 0 }; // SCHED_FIFO priority; 0 for the highest available
+};
+
+// Reads <prefix>Cpu and <prefix>Priority, e.g. MotionThreadCpu. A Cpu
+// which isn't a number is logged and ignored.
+ThreadPlacement readThreadPlacement(const IConfigReader& config, const std::string& prefix);
+
+// What actually took effect, read back from the thread
+struct PlacementResult {
+    bool realTime { false };
+    int priority { 0 };
+    int cpu { -1 }; // the CPU asked for, if any
+    bool pinned { false };
+
+    // i.e. whether everything that was asked for took effect
+    bool ok() const;
+    std::string describe(const std::string& threadName) const;
+};
+
+PlacementResult placeThread(pthread_t thread, const ThreadPlacement& placement);
+
+// Touches the top PREFAULT_STACK_BYTES of the calling thread's stack, so
+// using that much of it later won't cause page faults
+void prefaultStack();
+
+// Locks the process's current and future memory into RAM. Returns false,
+// having logged why (e.g. RLIMIT_MEMLOCK too low), if that wasn't allowed.
+bool lockMemory();
+
+// Places whichever thread next calls apply(), for threads we don't create
+// ourselves, such as the GPIO library's callback thread.
+class DeferredPlacement {
+public:
+    // Only to be called once
+    void request(const ThreadPlacement& placement);
+
+    // Call from the thread to be placed; it's cheap once placement is done
+    void apply()
+    {
+        if (m_state.load(std::memory_order_acquire) == State::Requested) {
+            applyNow();
+        }
+    }
+
+    // Only set once the placement has been applied
+    std::optional<PlacementResult> result() const;
+
+private:
+    enum class State {
+        None,
+        Requested,
+        Applied
+    };
+    std::atomic<State> m_state { State::None };
+    ThreadPlacement m_placement;
+    PlacementResult m_result;
+
+    void applyNow();
+};
+
+} // end namespace
@@ -0,0 +1,156 @@
+#pragma once
+// A MockGpio which feeds the encoder and scales with edges from a capture
+// (see EdgeRecorder) instead of simulating them, at the speed they were
+// captured, faster, or as fast as they can be decoded. Edges are delivered
+// in batches of a millisecond's worth, as the GPIO library does, and
+// getTick() follows the capture's clock rather than ours.
+
+#include "edgecapture.h"
+#include "gpioedge.h"
+#include "stepperControl/mockgpio.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mgo {
+
+class ReplayGpio : public MockGpio, public IGpioEdgeBatches {
+public:
+    // A speed of 2 replays twice as fast as the capture; 0 means flat out
+    ReplayGpio(IConfigReader& config, const std::string& filename, double speed = 1.0)
+        : MockGpio(false, config)
+        , m_edges(readEdgeCapture(filename))
+        , m_speed(speed)
+    {
+        if (!m_edges.empty()) {
+            m_tick = m_edges.front().tick;
+        }
+    }
+
+    ~ReplayGpio() override
+    {
+        m_terminate = true;
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+
+    void setEdgeBatchCallback(
+        int pinA, int pinB, GpioEdgeBatchCallback callback, void* userData) override
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_consumers.push_back({ pinA, pinB, callback, userData });
+    }
+
+    void removeEdgeBatchCallback(void* userData) override
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::erase_if(m_consumers, [userData](const Consumer& consumer) {
+            return consumer.userData == userData;
+        });
+    }
+
+    uint32_t getTick() override
+    {
+        if (m_speed <= 0.0 || !m_started || m_finished) {
+            return m_tick;
+        }
+        const double elapsed = std::chrono::duration<double, std::micro>(
+                                   std::chrono::steady_clock::now() - m_startedAt)
+                                   .count();
+        return m_startTick + static_cast<uint32_t>(elapsed * m_speed);
+    }
+
+    // Starts the replay, once everything which wants edges has registered
+    void start()
+    {
+        if (m_started.exchange(true)) {
+            return;
+        }
+        m_startTick = m_tick;
+        m_startedAt = std::chrono::steady_clock::now();
+        m_thread = std::thread(&ReplayGpio::threadFunction, this);
+    }
+
+    void waitUntilFinished()
+    {
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+
+    bool isFinished() const
+    {
+        return m_finished;
+    }
+
+    std::size_t getEdgeCount() const
+    {
+        return m_edges.size();
+    }
+
+private:
+    struct Consumer {
+        int pinA;
+        int pinB;
+        GpioEdgeBatchCallback callback;
+        void* userData;
+    };
+
+    static constexpr uint32_t BATCH_MICROSECONDS = 1'000;
+
+    std::vector<GpioEdge> m_edges;
+    double m_speed;
+    std::mutex m_mutex;
+    std::vector<Consumer> m_consumers;
+    std::atomic<uint32_t> m_tick { 0 };
+    uint32_t m_startTick { 0 };
+    std::chrono::steady_clock::time_point m_startedAt;
+    std::atomic<bool> m_started { false };
+    std::atomic<bool> m_finished { false };
+    std::atomic<bool> m_terminate { false };
+    std::thread m_thread;
+
+    void threadFunction()
+    {
+        std::vector<GpioEdge> theirs;
+        std::size_t next = 0;
+        while (next < m_edges.size() && !m_terminate) {
+            // Ticks wrap, so they're only compared as differences
+            const uint32_t batchStart = m_edges[next].tick;
+            std::size_t end = next + 1;
+            while (end < m_edges.size() && m_edges[end].tick - batchStart < BATCH_MICROSECONDS) {
+                ++end;
+            }
+            const uint32_t batchEnd = m_edges[end - 1].tick;
+            if (m_speed > 0.0) {
+                const double due = (batchEnd - m_startTick) / m_speed;
+                std::this_thread::sleep_until(
+                    m_startedAt + std::chrono::duration<double, std::micro>(due));
+            }
+            m_tick = batchEnd;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (const auto& consumer : m_consumers) {
+                theirs.clear();
+                for (std::size_t n = next; n < end; ++n) {
+                    if (m_edges[n].pin == consumer.pinA || m_edges[n].pin == consumer.pinB) {
+                        theirs.push_back(m_edges[n]);
+                    }
+                }
+                if (!theirs.empty()) {
+                    consumer.callback(theirs.data(), theirs.size(), consumer.userData);
+                }
+            }
+            next = end;
+        }
+        m_finished = true;
+    }
+};
+
+} // end namespace
@@ -1,29 +1,187 @@
 #include "rotaryencoder.h"
+#include "edgecapture.h"
+#include "electronicleadscrew.h"
+
+#include <algorithm>
+#include <cmath>
 
 namespace mgo {
 
+namespace {
+
+// High-speed mode is left below this fraction of EncoderFilter::highSpeedRpm,
+// so it doesn't flip back and forth at the threshold
+constexpr float HIGH_SPEED_HYSTERESIS = 0.8f;
+
+// Edges reach us in batches, so the latest pulse we know of can be this
+// old without the spindle having slowed at all
+constexpr uint32_t MAX_EDGE_LATENCY_MICROSECONDS = 2'000;
+
+} // end anonymous namespace
+
 void RotaryEncoder::staticCallback(int pin, int level, uint32_t tick, void* userData)
 {
     RotaryEncoder* self = reinterpret_cast<RotaryEncoder*>(userData);
     self->callback(pin, level, tick);
 }
 
+void RotaryEncoder::staticBatchCallback(const GpioEdge* edges, std::size_t count, void* userData)
+{
+    RotaryEncoder* self = reinterpret_cast<RotaryEncoder*>(userData);
+    self->onEdges(edges, count);
+}
+
 void RotaryEncoder::callback(int pin, int level, uint32_t tick)
 {
+    const GpioEdge edge { pin, level, tick };
+    onEdges(&edge, 1);
+}
+
+void RotaryEncoder::onEdges(const GpioEdge* edges, std::size_t count)
+{
+    m_callbackThreadPlacement.apply();
+    if (EdgeRecorder* recorder = m_recorder) {
+        recorder->record(edges, count);
+    }
+    std::lock_guard<std::mutex> lock(m_decodeMutex);
+    bool changed = false;
+    uint32_t rejected = 0;
+    for (std::size_t n = 0; n < count; ++n) {
+        changed |= filterEdge(edges[n], rejected);
+    }
+    changed |= releaseOldEdges(m_gpio.getTick(), rejected);
+    publish(changed, rejected);
+}
+
+void RotaryEncoder::releaseHeldEdges()
+{
+    if (m_filter.minEdgeMicroseconds == 0) {
+        return;
+    }
+    // If the callback's thread has the lock, it's decoding, and will
+    // release whatever's old enough itself
+    std::unique_lock<std::mutex> lock(m_decodeMutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return;
+    }
+    uint32_t rejected = 0;
+    const bool changed = releaseOldEdges(m_gpio.getTick(), rejected);
+    publish(changed, rejected);
+}
+
+void RotaryEncoder::publish(bool changed, uint32_t rejected)
+{
+    if (rejected != 0) {
+        m_rejectedEdges.store(
+            m_rejectedEdges.load(std::memory_order_relaxed) + rejected,
+            std::memory_order_relaxed);
+    }
+    // Other threads only need to see where the whole batch left us
+    if (changed) {
+        m_state.fastTickDelta = m_rpmEstimator.fastInterval();
+        m_state.smoothedTickDelta = m_rpmEstimator.smoothedInterval();
+        m_published.store(m_state);
+    }
+}
+
+// An edge only counts if its pin then stays put for the minimum edge width,
+// so of a glitch (or a burst of contact bounce) only the last edge is left,
+// and that only if it actually changes the pin's level. Edges are held until
+// a later edge (on either pin) shows whether they lasted, which works the
+// same whether the GPIO library gives us one edge per call or a batch.
+// Returns true if m_state has changed.
+bool RotaryEncoder::filterEdge(const GpioEdge& edge, uint32_t& rejected)
+{
+    if (m_filter.minEdgeMicroseconds == 0 || (edge.pin != m_pinA && edge.pin != m_pinB)) {
+        return decode(edge.pin, edge.level, edge.tick);
+    }
+    bool changed = false;
+    std::size_t stillHeld = 0;
+    for (std::size_t n = 0; n < m_heldEdgeCount; ++n) {
+        const GpioEdge held = m_heldEdges[n];
+        if (edge.tick - held.tick >= m_filter.minEdgeMicroseconds) {
+            changed |= releaseEdge(held, rejected);
+        } else if (held.pin == edge.pin) {
+            ++rejected; // its pin changed again too soon
+        } else {
+            m_heldEdges[stillHeld++] = held;
+        }
+    }
+    // Each pin has at most one edge held, so there's always room
+    m_heldEdges[stillHeld] = edge;
+    m_heldEdgeCount = stillHeld + 1;
+    return changed;
+}
+
+// Held edges are released by later edges, but if there aren't any (e.g. the
+// spindle has stopped) they're released once no later edge that could still
+// be on its way to us would be within the minimum edge width
+bool RotaryEncoder::releaseOldEdges(uint32_t now, uint32_t& rejected)
+{
+    const uint32_t age = m_filter.minEdgeMicroseconds + MAX_EDGE_LATENCY_MICROSECONDS;
+    bool changed = false;
+    std::size_t stillHeld = 0;
+    for (std::size_t n = 0; n < m_heldEdgeCount; ++n) {
+        const GpioEdge held = m_heldEdges[n];
+        if (now - held.tick >= age) {
+            changed |= releaseEdge(held, rejected);
+        } else {
+            m_heldEdges[stillHeld++] = held;
+        }
+    }
+    m_heldEdgeCount = stillHeld;
+    return changed;
+}
+
+bool RotaryEncoder::releaseEdge(const GpioEdge& edge, uint32_t& rejected)
+{
+    int& level = edge.pin == m_pinA ? m_filteredLevelA : m_filteredLevelB;
+    if (edge.level == level) {
+        ++rejected;
+        return false;
+    }
+    level = edge.level;
+    return decode(edge.pin, edge.level, edge.tick);
+}
+
+// Returns true if m_state has changed
+bool RotaryEncoder::decode(int pin, int level, uint32_t tick)
+{
+    if (m_state.highSpeed) {
+        // The direction can't change at this speed, so B's edges are only
+        // noted (for when we slow down again): missing one mustn't cost us
+        // a pulse, as it would with the debounce below
+        if (pin == m_pinB) {
+            m_levelB = level;
+            return false;
+        }
+        if (pin != m_pinA || level == m_levelA) {
+            return false;
+        }
+        m_levelA = level;
+        m_lastPin = pin;
+        if (level == 1) {
+            countPulse(tick);
+            return true;
+        }
+        return false;
+    }
+
     if (pin == m_lastPin) {
         // debounce
-        return;
+        return false;
     }
     m_lastPin = pin;
 
-    if (m_warmingUp) {
+    if (m_state.warmingUp) {
         // We ignore the first few calls until we can
         // set the previous tick
         if (pin == m_pinA && level == 1) {
-            m_lastTick = tick;
-            m_warmingUp = false;
+            m_state.lastTick = tick;
+            m_state.warmingUp = false;
+            return true;
         }
-        return;
+        return false;
     }
 
     // Check rotation
@@ -33,70 +191,111 @@ void RotaryEncoder::callback(int pin, int level, uint32_t tick)
         m_levelB = level;
     }
 
+    const RotationDirection previousDirection = m_state.direction;
     if (pin == m_pinA && level == 1) {
         if (m_levelB) {
-            m_direction = RotationDirection::normal;
+            m_state.direction = RotationDirection::normal;
         }
     } else if (pin == m_pinB && level == 1) {
         if (m_levelA) {
-            m_direction = RotationDirection::reversed;
+            m_state.direction = RotationDirection::reversed;
         }
     }
 
     // Note - we only count one pin's pulses, and measure from
     // rising edge to next rising edge
     if (pin == m_pinA && level == 1) {
-        if (m_direction == RotationDirection::normal) {
-            --m_pulseCount;
-        } else {
-            ++m_pulseCount;
-        }
-        // When physically setting up the rotary encoder, it's important
-        // to set gearing such that there are a round number of pulses
-        // per spindle revolution, otherwise we'll get a drift in the
-        // apparent position of pulse zero.
-        // Current gearing of the RE on my lathe is 35:100
-        // so the rotary encoder does 0.35 revolutions per spindle revolution.
-        // The RE has 2'000 pulses per rev, which means we get 700 pulses
-        // per chuck revolution.
-        bool hitZeroPulse = false;
-        if (m_direction == RotationDirection::reversed) {
-            if (m_pulseCount == static_cast<uint32_t>(m_pulsesPerSpindleRev)) {
-                hitZeroPulse = true;
-                m_pulseCount = 0;
-            }
-        } else {
-            if (m_pulseCount > static_cast<uint32_t>(m_pulsesPerSpindleRev)) {
-                hitZeroPulse = true;
-                m_pulseCount = static_cast<uint32_t>(m_pulsesPerSpindleRev) - 1;
-            }
+        countPulse(tick);
+        return true;
+    }
+    return m_state.direction != previousDirection;
+}
+
+void RotaryEncoder::countPulse(uint32_t tick)
+{
+    if (m_state.direction == RotationDirection::normal) {
+        --m_state.pulseCount;
+    } else {
+        ++m_state.pulseCount;
+    }
+    if (ElectronicLeadscrew* leadscrew = m_leadscrew) {
+        leadscrew->pulse(m_state.direction == RotationDirection::normal, tick);
+    }
+    // When physically setting up the rotary encoder, it's important
+    // to set gearing such that there are a round number of pulses
+    // per spindle revolution, otherwise we'll get a drift in the
+    // apparent position of pulse zero.
+    // Current gearing of the RE on my lathe is 35:100
+    // so the rotary encoder does 0.35 revolutions per spindle revolution.
+    // The RE has 2'000 pulses per rev, which means we get 700 pulses
+    // per chuck revolution.
+    if (m_state.direction == RotationDirection::reversed) {
+        if (m_state.pulseCount == static_cast<uint32_t>(m_pulsesPerSpindleRev)) {
+            m_state.pulseCount = 0;
         }
-        if (hitZeroPulse) {
-            m_averageTickDelta = m_tickDiffTotal / static_cast<float>(m_pulsesPerSpindleRev);
-            m_tickDiffTotal = 0;
-            // We remember what the tick was at the last zero degrees position
-            // (we arbitrarily call the start position zero) so we can extrapolate
-            // out to the next one for accurate starting when waiting to cut a
-            // thread. Owing to the latency on the callbacks, it's not sufficient
-            // to simply wait for the next zero-degree tick. With the 1 ms latency,
-            // this could result in an inaccuracy of up to 6° at 1,000 rpm.
-            m_lastZeroDegreesTick = tick;
+    } else {
+        if (m_state.pulseCount > static_cast<uint32_t>(m_pulsesPerSpindleRev)) {
+            m_state.pulseCount = static_cast<uint32_t>(m_pulsesPerSpindleRev) - 1;
         }
-        m_tickDiffTotal += tick - m_lastTick; // don't need to worry about wrap
-        m_lastTick = tick;
+    }
+    measure(tick);
+    m_state.lastTick = tick;
+}
+
+// Called for every pulse counted
+void RotaryEncoder::measure(uint32_t tick)
+{
+    // Ticks don't need us to worry about wrap
+    if (!m_state.highSpeed) {
+        m_rpmEstimator.addInterval(tick - m_state.lastTick);
+    } else if (++m_decimatedPulses == m_filter.decimation) {
+        m_rpmEstimator.addInterval(tick - m_decimationStartTick, m_decimatedPulses);
+    } else {
+        return;
+    }
+    m_decimatedPulses = 0;
+    m_decimationStartTick = tick;
+    if (m_filter.highSpeedRpm <= 0.f) {
+        return;
+    }
+    const float interval = m_rpmEstimator.smoothedInterval();
+    const float rpm = interval > 0.f ? 60'000'000.f / (interval * m_pulsesPerSpindleRev) : 0.f;
+    if (!m_state.highSpeed && rpm > m_filter.highSpeedRpm) {
+        m_state.highSpeed = true;
+    } else if (m_state.highSpeed && rpm < m_filter.highSpeedRpm * HIGH_SPEED_HYSTERESIS) {
+        m_state.highSpeed = false;
     }
 }
 
 float RotaryEncoder::getRpm()
+{
+    const State state = getState();
+    return rpmForTickDelta(state.smoothedTickDelta, state.lastTick);
+}
+
+float RotaryEncoder::getFastRpm()
+{
+    const State state = getState();
+    return rpmForTickDelta(state.fastTickDelta, state.lastTick);
+}
+
+float RotaryEncoder::rpmForTickDelta(float tickDelta, uint32_t lastTick)
 {
     // Ticks are in microseconds
-    if (warmingUp()) {
+    if (tickDelta <= 0.f) {
         return 0.f;
     }
-    if (m_gpio.getTick() - m_lastTick > 100'000) {
+    const uint32_t sinceLastPulse = m_gpio.getTick() - lastTick;
+    if (sinceLastPulse > RpmEstimator::MAX_INTERVAL_MICROSECONDS) {
         return 0.f;
     }
-    float rpm = 60'000'000.f / (m_averageTickDelta * m_pulsesPerSpindleRev);
+    // If the next pulse is already overdue, the spindle is slowing down,
+    // so we don't have to wait for it to know that
+    if (sinceLastPulse > MAX_EDGE_LATENCY_MICROSECONDS) {
+        tickDelta = std::max(
+            tickDelta, static_cast<float>(sinceLastPulse - MAX_EDGE_LATENCY_MICROSECONDS));
+    }
+    float rpm = 60'000'000.f / (tickDelta * m_pulsesPerSpindleRev);
     if (rpm > 5'000.f) {
         rpm = 0.f;
     }
@@ -105,46 +304,48 @@ float RotaryEncoder::getRpm()
 
 float RotaryEncoder::getPositionDegrees()
 {
-    // There will be latency in this as the pigpio thread which calls back to
-    // the callback in the anonymous namespace above only does so approx once
-    // per millisecond (it batches up the callbacks and calls us maybe thirty
-    // times per batch). So this shouldn't be used in real time - use the
-    // callbackAtPositionDegrees() function which extrapolates out based on
-    // previous data.
+    // This is worked out from the pulse count, which is only published once
+    // per batch of edges, and the GPIO library delivers those about once a
+    // millisecond. So it lags the spindle and shouldn't be used in real time:
+    // nextZeroDegreesTick() extrapolates from the last pulse instead.
 
     // However this is useful for manual chuck rotation.
 
-    return 360.f * (static_cast<float>(m_pulseCount) / m_pulsesPerSpindleRev);
+    return 360.f * (static_cast<float>(getState().pulseCount) / m_pulsesPerSpindleRev);
 }
 
 RotationDirection RotaryEncoder::getRotationDirection()
 {
-    return m_direction;
+    return getState().direction;
 }
 
-void RotaryEncoder::callbackAtZeroDegrees(std::function<void()> cb)
+std::optional<uint32_t> RotaryEncoder::nextZeroDegreesTick(uint32_t leadMicroseconds)
 {
     // We just need to start threading operations at a
     // repeatable rotational position each time, so we
     // arbitrarily choose zero.
-    // Because there is a latency on the callback (the pigpio
-    // library batches up the callbacks), we interpolate here
-    // for better accuracy.
     // Note: ramping should be turned off for threading operations
-    if (m_warmingUp) {
-        return; // spindle not running?
-    }
-    while (m_lastZeroDegreesTick == 0)
-        ; // spin if the last pos isn't set yet
-    uint32_t timeForOneRevolution = m_averageTickDelta * m_pulsesPerSpindleRev;
-    uint32_t targetTick
-        = m_lastZeroDegreesTick + (timeForOneRevolution - m_advanceValueMicroseconds);
-    while (m_gpio.getTick() > targetTick) {
-        targetTick += timeForOneRevolution;
-    }
-    // Now spin until we get to the right time
-    while (m_gpio.getTick() < targetTick)
-        ;
-    cb();
+    const State state = getState();
+    if (state.warmingUp || getRpm() == 0.f) {
+        return std::nullopt; // spindle not running?
+    }
+    // Zero degrees is where the pulse count wraps (see callback()). Owing to
+    // the latency on the callbacks, it's not sufficient to simply wait for the
+    // zero-degree pulse: with 1 ms latency, this could result in an inaccuracy
+    // of up to 6° at 1,000 rpm. So we extrapolate from the last pulse instead.
+    const auto pulsesPerRev = static_cast<uint32_t>(m_pulsesPerSpindleRev);
+    const uint32_t pulsesToZero = state.direction == RotationDirection::normal
+        ? state.pulseCount + 1
+        : pulsesPerRev - state.pulseCount;
+    const double timeForOneRevolution
+        = static_cast<double>(state.smoothedTickDelta) * pulsesPerRev;
+    // Microseconds after the last pulse
+    double offset = pulsesToZero * static_cast<double>(state.smoothedTickDelta)
+        - m_advanceValueMicroseconds;
+    const uint32_t earliest = (m_gpio.getTick() - state.lastTick) + leadMicroseconds;
+    while (offset < earliest) {
+        offset += timeForOneRevolution;
+    }
+    return state.lastTick + static_cast<uint32_t>(std::lround(offset));
 }
 } // end namespace
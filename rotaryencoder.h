@@ -2,48 +2,130 @@
 // This class is used to read and respond to a rotary
 // encoder which measures the lathe's spindle rotation.
 
+#include "gpioedge.h"
 #include "log.h"
+#include "realtime.h"
+#include "rpmestimator.h"
+#include "seqlock.h"
 #include "stepperControl/igpio.h"
 
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <cstddef>
 #include <cstdint>
-#include <functional>
+#include <mutex>
+#include <optional>
 #include <ostream>
 
 namespace mgo {
 
+class EdgeRecorder;
+class ElectronicLeadscrew;
+
 enum class RotationDirection {
     normal,
     reversed
 };
 
+// For keeping the speed steady when the spindle runs fast
+struct EncoderFilter {
+    // An edge is rejected as a glitch (or contact bounce) if its pin changes
+    // again within this many microseconds. 0 accepts every edge. Otherwise
+    // each edge is only decoded once the next one (on either pin) arrives,
+    // i.e. a fraction of a pulse later while the spindle's turning, though
+    // it keeps its own tick.
+    uint32_t minEdgeMicroseconds { 0 };
+    // Above this speed, only pin A's edges are decoded (the direction can't
+    // change at speed, and this way a missed edge on B doesn't cost us a
+    // pulse), and the speed is measured every "decimation" pulses rather
+    // than every one. Below 80% of it, full decoding resumes. 0 never
+    // switches.
+    float highSpeedRpm { 0.f };
+    uint32_t decimation { 4 };
+};
+
 class RotaryEncoder {
 public:
+    // Everything the callback's thread works out, published as one
+    // consistent snapshot for other threads
+    struct State {
+        uint32_t lastTick { 0 };
+        uint32_t pulseCount { 0 };
+        // Mean microseconds per pulse (see RpmEstimator)
+        float fastTickDelta { 0.f };
+        float smoothedTickDelta { 0.f };
+        RotationDirection direction { RotationDirection::normal };
+        bool warmingUp { true };
+        bool highSpeed { false }; // see EncoderFilter
+    };
+
     RotaryEncoder(
         IGpio& gpio,
         int pinA,
         int pinB,
         int pulsesPerRev, // of the RE, not spindle
-        float gearing)
+        float gearing,
+        const RpmWindow& rpmWindow = {},
+        const EncoderFilter& filter = {})
         : m_gpio(gpio)
         , m_pinA(pinA)
         , m_pinB(pinB)
         , m_pulsesPerRev(pulsesPerRev)
         , m_gearing(gearing)
+        , m_filter(filter)
+        , m_rpmEstimator(rpmWindow)
     {
+        m_filter.decimation = std::max<uint32_t>(m_filter.decimation, 1);
         m_pulsesPerSpindleRev = m_pulsesPerRev * m_gearing;
-        m_gpio.setRotaryEncoderCallback(m_pinA, m_pinB, staticCallback, this);
+        if (auto batches = dynamic_cast<IGpioEdgeBatches*>(&m_gpio)) {
+            batches->setEdgeBatchCallback(m_pinA, m_pinB, staticBatchCallback, this);
+        } else {
+            m_gpio.setRotaryEncoderCallback(m_pinA, m_pinB, staticCallback, this);
+        }
+    }
+
+    ~RotaryEncoder()
+    {
+        if (auto batches = dynamic_cast<IGpioEdgeBatches*>(&m_gpio)) {
+            batches->removeEdgeBatchCallback(this);
+        } else {
+            m_gpio.setRotaryEncoderCallback(m_pinA, m_pinB, ignoreGpioEdge, nullptr);
+        }
     }
 
+    RotaryEncoder(const RotaryEncoder&) = delete;
+    RotaryEncoder& operator=(const RotaryEncoder&) = delete;
+
     static void staticCallback(int pin, int level, uint32_t tick, void* userData);
+    static void staticBatchCallback(const GpioEdge* edges, std::size_t count, void* userData);
 
     void callback(int pin, int level, uint32_t tick);
+    // Decodes a batch of edges (in the order they happened)
+    void onEdges(const GpioEdge* edges, std::size_t count);
+    // The glitch filter holds each edge until a later one shows it wasn't a
+    // glitch. This decodes any which have been held long enough that no such
+    // edge can still arrive, so call it regularly, otherwise the last edges
+    // before the spindle stops are held until it turns again.
+    void releaseHeldEdges();
+
+    State getState() const
+    {
+        return m_published.load();
+    }
 
+    // Smoothed over RpmWindow, for display and threading
     float getRpm();
+    // Over the last few pulses only, so it reacts to the spindle stalling
+    float getFastRpm();
     float getPositionDegrees();
     RotationDirection getRotationDirection();
 
-    void callbackAtZeroDegrees(std::function<void()> cb);
+    // Predicts the GPIO tick at which the spindle will next be at zero degrees
+    // (less the advance value), at least leadMicroseconds from now. Returns
+    // nothing if the spindle isn't turning. This is extrapolated from the last
+    // pulse, as pulses reach us a millisecond or so late.
+    std::optional<uint32_t> nextZeroDegreesTick(uint32_t leadMicroseconds = 1'000);
 
     void setAdvanceValueMicroseconds(float value)
     {
@@ -52,7 +134,32 @@ public:
 
     bool warmingUp()
     {
-        return m_warmingUp;
+        return getState().warmingUp;
+    }
+
+    // Edges rejected as glitches (see EncoderFilter)
+    uint32_t getRejectedEdges() const
+    {
+        return m_rejectedEdges;
+    }
+
+    // Used to place the thread which calls us back
+    DeferredPlacement& callbackThreadPlacement()
+    {
+        return m_callbackThreadPlacement;
+    }
+
+    // Every pulse counted is passed on to the leadscrew (if any), from the
+    // callback's thread
+    void setLeadscrew(ElectronicLeadscrew* leadscrew)
+    {
+        m_leadscrew = leadscrew;
+    }
+
+    // Every edge we're given is also recorded (if there's a recorder)
+    void setRecorder(EdgeRecorder* recorder)
+    {
+        m_recorder = recorder;
     }
 
 private:
@@ -65,14 +172,39 @@ private:
     int m_pulsesPerRev; // of RE
     float m_pulsesPerSpindleRev;
     float m_gearing;
-    bool m_warmingUp { true };
-    uint32_t m_lastTick;
-    std::atomic<uint32_t> m_lastZeroDegreesTick { 0 }; // TODO other members need to be atomic too
-    uint32_t m_pulseCount { 0 };
-    uint32_t m_tickDiffTotal { 0 };
-    float m_averageTickDelta { 0.f };
-    RotationDirection m_direction { RotationDirection::normal};
+    EncoderFilter m_filter;
+    // Decoding is done by the callback's thread, or by releaseHeldEdges()
+    // while it holds this, and publishes m_state to m_published whenever
+    // it changes
+    std::mutex m_decodeMutex;
+    State m_state;
+    RpmEstimator m_rpmEstimator;
+    // Each pin's level as far as the glitch filter is concerned (-1 until
+    // it's known)
+    int m_filteredLevelA { -1 };
+    int m_filteredLevelB { -1 };
+    // Edges waiting to see if they last the minimum edge width, oldest
+    // first and at most one per pin
+    std::array<GpioEdge, 2> m_heldEdges {};
+    std::size_t m_heldEdgeCount { 0 };
+    // Pulses since the last measurement, in high-speed mode
+    uint32_t m_decimatedPulses { 0 };
+    uint32_t m_decimationStartTick { 0 };
+    std::atomic<uint32_t> m_rejectedEdges { 0 };
+    SeqLock<State> m_published;
     float m_advanceValueMicroseconds { 0.f };
+    std::atomic<ElectronicLeadscrew*> m_leadscrew { nullptr };
+    std::atomic<EdgeRecorder*> m_recorder { nullptr };
+    DeferredPlacement m_callbackThreadPlacement;
+
+    bool filterEdge(const GpioEdge& edge, uint32_t& rejected);
+    bool releaseOldEdges(uint32_t now, uint32_t& rejected);
+    bool releaseEdge(const GpioEdge& edge, uint32_t& rejected);
+    void publish(bool changed, uint32_t rejected);
+    bool decode(int pin, int level, uint32_t tick);
+    void countPulse(uint32_t tick);
+    void measure(uint32_t tick);
+    float rpmForTickDelta(float tickDelta, uint32_t lastTick);
 };
 
 } // end namespace
@@ -0,0 +1,83 @@
+#include "rpmestimator.h"
+
+#include <algorithm>
+
+namespace mgo {
+
+RpmEstimator::RpmEstimator(const RpmWindow& window)
+    // One slot is kept spare for the interval being added
+    : m_windowPulses(std::clamp<std::size_t>(window.pulses, 1, MAX_RPM_WINDOW_PULSES - 1))
+    , m_windowMicroseconds(window.microseconds)
+    , m_fastIntervals(std::clamp<std::size_t>(window.fastPulses, 1, MAX_RPM_WINDOW_PULSES - 1))
+{
+}
+
+void RpmEstimator::addInterval(uint32_t microseconds, uint32_t pulses)
+{
+    if (pulses == 0) {
+        return;
+    }
+    if (microseconds / pulses > MAX_INTERVAL_MICROSECONDS) {
+        reset();
+        return;
+    }
+    m_intervals[m_next] = { microseconds, pulses };
+    m_next = (m_next + 1) & (MAX_RPM_WINDOW_PULSES - 1);
+
+    m_fastSum += microseconds;
+    m_fastPulseSum += pulses;
+    if (m_fastCount == m_fastIntervals) {
+        const Interval& oldest = intervalAgo(m_fastIntervals + 1);
+        m_fastSum -= oldest.microseconds;
+        m_fastPulseSum -= oldest.pulses;
+    } else {
+        ++m_fastCount;
+    }
+
+    // Drop the oldest intervals until we're within the window, but always
+    // keep the newest one. As every interval is at least one pulse, the
+    // window can't outgrow the ring.
+    m_sum += microseconds;
+    m_pulses += pulses;
+    ++m_count;
+    while (m_count > 1 && (m_pulses > m_windowPulses || m_sum > m_windowMicroseconds)) {
+        const Interval& oldest = intervalAgo(m_count);
+        m_sum -= oldest.microseconds;
+        m_pulses -= oldest.pulses;
+        --m_count;
+    }
+}
+
+void RpmEstimator::reset()
+{
+    m_count = 0;
+    m_pulses = 0;
+    m_sum = 0;
+    m_fastCount = 0;
+    m_fastPulseSum = 0;
+    m_fastSum = 0;
+}
+
+float RpmEstimator::fastInterval() const
+{
+    if (m_fastPulseSum == 0) {
+        return 0.f;
+    }
+    return static_cast<float>(m_fastSum) / m_fastPulseSum;
+}
+
+float RpmEstimator::smoothedInterval() const
+{
+    if (m_pulses == 0) {
+        return 0.f;
+    }
+    return static_cast<float>(m_sum) / m_pulses;
+}
+
+// The interval added "intervals" intervals ago (one being the latest)
+const RpmEstimator::Interval& RpmEstimator::intervalAgo(std::size_t intervals) const
+{
+    return m_intervals[(m_next - intervals) & (MAX_RPM_WINDOW_PULSES - 1)];
+}
+
+} // end namespace
@@ -0,0 +1,68 @@
+#pragma once
+// Estimates the time between encoder pulses from a ring of the most recent
+// intervals, so speed changes are seen within a few pulses rather than once
+// per revolution. Two estimates are kept: a fast one over just the last few
+// pulses (for reacting to the spindle stalling) and a smoothed one over a
+// longer window (for display and threading). Both are running sums, so each
+// pulse costs the same however long the window is. At high speed, intervals
+// can be added a few pulses at a time (see EncoderFilter).
+// Only to be used from one thread (the encoder's callback).
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace mgo {
+
+// Must be a power of two
+constexpr std::size_t MAX_RPM_WINDOW_PULSES = 1'024;
+
+struct RpmWindow {
+    // The smoothed estimate covers this many pulses, or this long,
+    // whichever is shorter
+    std::size_t pulses { 100 };
+    uint32_t microseconds { 50'000 };
+    // The fast estimate covers this many intervals: a pulse each, or
+    // several pulses at high speed (see EncoderFilter)
+    std::size_t fastPulses { 8 };
+};
+
+class RpmEstimator {
+public:
+    explicit RpmEstimator(const RpmWindow& window = {});
+
+    // An interval longer than this means the spindle was stopped,
+    // so the estimates start again
+    static constexpr uint32_t MAX_INTERVAL_MICROSECONDS = 100'000;
+
+    // Adds the time taken by the last "pulses" pulses
+    void addInterval(uint32_t microseconds, uint32_t pulses = 1);
+    void reset();
+
+    // Mean microseconds per pulse, or zero if there's nothing to go on yet
+    float fastInterval() const;
+    float smoothedInterval() const;
+
+private:
+    struct Interval {
+        uint32_t microseconds;
+        uint32_t pulses;
+    };
+
+    std::size_t m_windowPulses;
+    uint32_t m_windowMicroseconds;
+    std::size_t m_fastIntervals;
+    std::array<Interval, MAX_RPM_WINDOW_PULSES> m_intervals {};
+    std::size_t m_next { 0 }; // where the next interval goes
+    // Intervals, pulses and microseconds in each window
+    std::size_t m_count { 0 };
+    uint64_t m_pulses { 0 };
+    uint64_t m_sum { 0 };
+    std::size_t m_fastCount { 0 };
+    uint64_t m_fastPulseSum { 0 };
+    uint64_t m_fastSum { 0 };
+
+    const Interval& intervalAgo(std::size_t intervals) const;
+};
+
+} // end namespace
@@ -0,0 +1,102 @@
+#include "scalefeedback.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace mgo {
+
+ScaleFeedback::ScaleFeedback(double mmPerStep, const ScaleFeedbackLimits& limits)
+    : m_mmPerStep(mmPerStep)
+    , m_limits(limits)
+{
+}
+
+long ScaleFeedback::start(double targetMm, long currentStep, double scaleMm)
+{
+    m_active = true;
+    m_targetMm = targetMm;
+    m_allowanceMm = 0.0;
+    m_correctiveMoves = 0;
+    // Whatever the scale and motor disagree by already is allowed for up
+    // front, so the move should end in the right place without correction
+    m_targetStep = stepForTarget(currentStep, scaleMm);
+    m_startTargetStep = m_targetStep;
+    return m_targetStep;
+}
+
+void ScaleFeedback::cancel()
+{
+    m_active = false;
+}
+
+bool ScaleFeedback::isActive() const
+{
+    return m_active;
+}
+
+double ScaleFeedback::getTargetMm() const
+{
+    return m_targetMm;
+}
+
+long ScaleFeedback::getTargetStep() const
+{
+    return m_targetStep;
+}
+
+long ScaleFeedback::duringMove(long currentStep, double scaleMm, double seconds)
+{
+    if (!m_active) {
+        return m_targetStep;
+    }
+    const double stepMm = std::abs(m_mmPerStep);
+    // The allowance is capped so a long spell without correction
+    // can't be saved up and spent all at once
+    m_allowanceMm = std::min(
+        m_allowanceMm + m_limits.correctionMmPerSecond * seconds,
+        std::max(m_limits.toleranceMm, stepMm));
+    const long wanted = stepForTarget(currentStep, scaleMm);
+    const long error = wanted - m_targetStep;
+    if (std::abs(error) * stepMm <= m_limits.toleranceMm || !withinLimit(wanted)) {
+        return m_targetStep;
+    }
+    // (allowing for rounding in the allowance)
+    const long allowed = static_cast<long>(m_allowanceMm / stepMm + 1e-6);
+    const long change = std::clamp(error, -allowed, allowed);
+    m_targetStep += change;
+    m_allowanceMm -= std::abs(change) * stepMm;
+    return m_targetStep;
+}
+
+ScaleFeedbackResult ScaleFeedback::afterMove(long currentStep, double scaleMm)
+{
+    if (!m_active) {
+        return ScaleFeedbackResult::InPosition;
+    }
+    if (std::abs(m_targetMm - scaleMm) <= m_limits.toleranceMm) {
+        m_active = false;
+        return ScaleFeedbackResult::InPosition;
+    }
+    const long wanted = stepForTarget(currentStep, scaleMm);
+    if (m_correctiveMoves >= m_limits.maxCorrectiveMoves || !withinLimit(wanted)
+        || wanted == currentStep) {
+        m_active = false;
+        return ScaleFeedbackResult::GaveUp;
+    }
+    ++m_correctiveMoves;
+    m_targetStep = wanted;
+    return ScaleFeedbackResult::Correcting;
+}
+
+long ScaleFeedback::stepForTarget(long currentStep, double scaleMm) const
+{
+    return currentStep + std::lround((m_targetMm - scaleMm) / m_mmPerStep);
+}
+
+bool ScaleFeedback::withinLimit(long step) const
+{
+    return std::abs(step - m_startTargetStep) * std::abs(m_mmPerStep)
+        <= m_limits.maxCorrectionMm;
+}
+
+} // end namespace
@@ -0,0 +1,69 @@
+#pragma once
+// Closed-loop positioning from a linear scale. The motor's step count can
+// disagree with where the carriage really is (leadscrew wear, backlash which
+// isn't quite what's configured, etc.), so while a move is under way its end
+// is nudged so the scale, rather than the step count, reads the position
+// asked for. Once the motor has stopped, any error left over is taken out with
+// short corrective moves. Corrections are limited in both rate and size so a
+// faulty scale can't send the carriage anywhere unexpected.
+// This holds no references to the motor or scale: it's given their
+// positions and says which step the motor should be aiming for.
+
+namespace mgo {
+
+struct ScaleFeedbackLimits {
+    // Errors smaller than this are left alone
+    double toleranceMm { 0.01 };
+    // How quickly a move's end is allowed to shift while it's under way
+    double correctionMmPerSecond { 0.5 };
+    // The most the scale and motor may disagree over a single move before
+    // we give up (and assume the scale is at fault)
+    double maxCorrectionMm { 0.5 };
+    // How many corrective moves to make once the motor has stopped
+    int maxCorrectiveMoves { 3 };
+};
+
+enum class ScaleFeedbackResult {
+    InPosition,
+    Correcting, // the motor should go to getTargetStep()
+    GaveUp
+};
+
+class ScaleFeedback {
+public:
+    // mmPerStep is the motor's conversion factor (so may be negative)
+    ScaleFeedback(double mmPerStep, const ScaleFeedbackLimits& limits);
+
+    // Starts closing the loop on a move to "targetMm" (as read by the scale).
+    // Returns the step the motor should go to, given where it is now.
+    long start(double targetMm, long currentStep, double scaleMm);
+    void cancel();
+    bool isActive() const;
+    double getTargetMm() const;
+    long getTargetStep() const;
+
+    // Called periodically while the motor is moving. "seconds" is the time
+    // since the last call. Returns the step the move should now end at.
+    long duringMove(long currentStep, double scaleMm, double seconds);
+
+    // Called once the motor has stopped (and the scale has settled)
+    ScaleFeedbackResult afterMove(long currentStep, double scaleMm);
+
+private:
+    double m_mmPerStep;
+    ScaleFeedbackLimits m_limits;
+    bool m_active { false };
+    double m_targetMm { 0.0 };
+    long m_targetStep { 0 };
+    long m_startTargetStep { 0 };
+    // Correction (in mm) we're currently allowed to make during the move
+    double m_allowanceMm { 0.0 };
+    int m_correctiveMoves { 0 };
+
+    // The step which would put the scale at the target, if the motor and
+    // scale keep their current relationship
+    long stepForTarget(long currentStep, double scaleMm) const;
+    bool withinLimit(long step) const;
+};
+
+} // end namespace
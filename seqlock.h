@@ -0,0 +1,70 @@
+#pragma once
+// Sequence lock for publishing a small value from exactly one writer thread
+// to any number of readers. Neither side ever blocks: the writer just bumps
+// a sequence number either side of its update, and a reader retries its copy
+// if that number was odd (mid-update) or changed while it was copying. So
+// readers always see a whole value from one store(), never a torn mixture.
+// The value is held as atomic words so the concurrent copy is well defined.
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace mgo {
+
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable_v<T>, "SeqLock values must be trivially copyable");
+
+public:
+    SeqLock()
+    {
+        store(T {});
+    }
+
+    // Writer only
+    void store(const T& value)
+    {
+        std::array<uint64_t, WORDS> words {};
+        std::memcpy(words.data(), &value, sizeof(T));
+        const uint32_t sequence = m_sequence.load(std::memory_order_relaxed);
+        m_sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t n = 0; n < WORDS; ++n) {
+            m_words[n].store(words[n], std::memory_order_relaxed);
+        }
+        m_sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    T load() const
+    {
+        std::array<uint64_t, WORDS> words;
+        for (;;) {
+            const uint32_t before = m_sequence.load(std::memory_order_acquire);
+            if (before & 1) {
+                continue;
+            }
+            for (std::size_t n = 0; n < WORDS; ++n) {
+                words[n] = m_words[n].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (m_sequence.load(std::memory_order_relaxed) == before) {
+                break;
+            }
+        }
+        T value;
+        std::memcpy(static_cast<void*>(&value), words.data(), sizeof(T));
+        return value;
+    }
+
+private:
+    static constexpr std::size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    std::atomic<uint32_t> m_sequence { 0 };
+    std::array<std::atomic<uint64_t>, WORDS> m_words {};
+};
+
+} // end namespace
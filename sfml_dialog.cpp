@@ -1,418 +1,163 @@
 #include "sfml_dialog.h"
 
-#include <unordered_map>
+#include "log.h"
 
-// Note this has its own event loop so acts as a modal dialog
+#include <algorithm>
+#include <stdexcept>
+
+namespace mgo {
 
 namespace {
-char convertScanCodeToChar(sf::Keyboard::Scancode scancode)
+
+constexpr unsigned BODY_TEXT_FONT_SIZE = 16;
+constexpr float LINE_HEIGHT = 16.f;
+constexpr float LINE_SPACING = 28.f;
+const sf::Color TEXT_COLOUR { 192, 192, 192 };
+
+void loadTexture(sf::Texture& texture, const std::string& filename)
 {
-    // Scancodes can't readily be converted to a char hence
-    // this...
-    switch (scancode) {
-        case sf::Keyboard::Scancode::A:
-            return 'a';
-        case sf::Keyboard::Scancode::B:
-            return 'b';
-        case sf::Keyboard::Scancode::C:
-            return 'c';
-        case sf::Keyboard::Scancode::D:
-            return 'd';
-        case sf::Keyboard::Scancode::E:
-            return 'e';
-        case sf::Keyboard::Scancode::F:
-            return 'f';
-        case sf::Keyboard::Scancode::G:
-            return 'g';
-        case sf::Keyboard::Scancode::H:
-            return 'h';
-        case sf::Keyboard::Scancode::I:
-            return 'i';
-        case sf::Keyboard::Scancode::J:
-            return 'j';
-        case sf::Keyboard::Scancode::K:
-            return 'k';
-        case sf::Keyboard::Scancode::L:
-            return 'l';
-        case sf::Keyboard::Scancode::M:
-            return 'm';
-        case sf::Keyboard::Scancode::N:
-            return 'n';
-        case sf::Keyboard::Scancode::O:
-            return 'o';
-        case sf::Keyboard::Scancode::P:
-            return 'p';
-        case sf::Keyboard::Scancode::Q:
-            return 'q';
-        case sf::Keyboard::Scancode::R:
-            return 'r';
-        case sf::Keyboard::Scancode::S:
-            return 's';
-        case sf::Keyboard::Scancode::T:
-            return 't';
-        case sf::Keyboard::Scancode::U:
-            return 'u';
-        case sf::Keyboard::Scancode::V:
-            return 'v';
-        case sf::Keyboard::Scancode::W:
-            return 'w';
-        case sf::Keyboard::Scancode::X:
-            return 'x';
-        case sf::Keyboard::Scancode::Y:
-            return 'y';
-        case sf::Keyboard::Scancode::Z:
-            return 'z';
-        default:
-            return 0;
+    if (!texture.loadFromFile(filename)) {
+        MGOLOG("Could not load " + filename);
+        throw std::runtime_error("Could not load " + filename);
     }
 }
-} // anonymous namespace
 
-namespace mgo {
-namespace dialog {
+} // end anonymous namespace
 
-Input::Return getInput(
-    sf::RenderWindow& window,
-    sf::Font& font,
-    Input::Type type,
-    std::string_view prompt,
-    std::vector<std::string> additionalText,
-    std::string_view defaultEntry,
-    std::optional<std::vector<std::string>> listItems)
+DialogBox::DialogBox(const sf::Font& font, sf::Vector2u windowSize)
+    : m_font(font)
+    , m_windowSize(static_cast<float>(windowSize.x), static_cast<float>(windowSize.y))
+    , m_shade(m_windowSize)
 {
-    // Parameter checks, this shouldn't be an issue
-    // as this function is designed to be called from
-    // more specialised wrappers in controller. But just
-    // to check...
-    if (additionalText.size() > 0) {
-        assert(!listItems.has_value()); // Can't have both
-    }
-    if (listItems.has_value()) {
-        assert(additionalText.size() == 0);
+    loadTexture(m_upArrowTexture, "img/upArrow.png");
+    loadTexture(m_downArrowTexture, "img/downArrow.png");
+    m_tickTexture = std::make_unique<sf::Texture>();
+    if (!m_tickTexture->loadFromFile("img/tick.png")) {
+        MGOLOG("Could not load img/tick.png");
+        m_tickTexture.reset();
     }
+    m_shade.setFillColor({ 0, 0, 0, 135 });
+    m_background.setFillColor({ 40, 40, 40 });
+    m_background.setOutlineColor({ 128, 128, 128 });
+    m_background.setOutlineThickness(2);
+    m_inputBox.setFillColor(sf::Color::White);
+    m_inputBox.setOutlineColor({ 192, 0, 0 });
+    m_inputBox.setOutlineThickness(2);
+    m_prompt = std::make_unique<sf::Text>(m_font, "", 20);
+    m_prompt->setFillColor(sf::Color::Green);
+    m_entry = std::make_unique<sf::Text>(m_font, "", 20);
+    m_entry->setFillColor(sf::Color::Black);
+}
 
-    // Save the existing main window's contents so we're not displaying on a black screen
-    sf::Texture windowContent(sf::Vector2u(window.getSize().x, window.getSize().y));
-    windowContent.update(window);
-
-    sf::Vector2f screenCentre;
-    screenCentre.x = window.getSize().x / 2.f;
-    screenCentre.y = window.getSize().y / 2.f;
-
-    float width = 550.f;
-    float height = 60.f;
+void DialogBox::setDialog(const Dialog& dialog)
+{
+    const Input::Type type = dialog.getType();
+    m_showEntry = type == Input::Type::Text || type == Input::Type::Numeric;
 
     // Create all the text items first so we can determine what size
     // we need for the background box:
-    constexpr unsigned bodyTextFontSize = 16;
-    constexpr float lineHeight = 16.f;
-    if (type == Input::Type::Text || type == Input::Type::Numeric) {
+    float width = 550.f;
+    float height = 60.f;
+    if (m_showEntry) {
         // Add space for the input box
         height += 120.f;
     }
-    std::vector<char> hotkeys;
-    std::vector<sf::Text> addText;
-    std::unordered_map<std::size_t, char> hotkeyMap;
-    std::size_t addTextCounter = 0;
-    for (auto& a : additionalText) {
-        // "Hotkeys" are defined as & + a non-whitespace character in
-        // the string
-        auto pos = a.find("&");
-        if (pos != a.npos) {
-            if (pos < a.size() - 1 && !(std::isspace(a.at(pos + 1)))) {
-                char c = std::tolower(a.at(pos + 1));
-                hotkeys.push_back(c);
-                hotkeyMap[addTextCounter] = c;
-            }
-            a.erase(pos, 1);
-        }
-        sf::Text t(font, std::string(prompt), bodyTextFontSize);
-        t.setString(a);
-        auto sz = t.getGlobalBounds().size;
-        if (sz.x + 50.f > width) {
-            width = sz.x + 50.f;
-        }
-        height += sz.y + lineHeight;
-        addText.push_back(t);
-        ++addTextCounter;
+    m_text.clear();
+    for (const auto& line : dialog.getText()) {
+        sf::Text& t = m_text.emplace_back(m_font, line, BODY_TEXT_FONT_SIZE);
+        t.setFillColor(TEXT_COLOUR);
+        const auto size = t.getGlobalBounds().size;
+        width = std::max(width, size.x + 50.f);
+        height += size.y + LINE_HEIGHT;
     }
-    constexpr unsigned maxListItemsInView = 8;
-    std::size_t currentScrollPosition = 0;
-    std::vector<sf::Text> listText;
-    constexpr sf::Color addTextColour = { 192, 192, 192 };
-    unsigned liCount = 0;
-    if (listItems.has_value()) {
-        for (const auto& li : listItems.value()) {
-            sf::Text t(font, std::string(prompt), bodyTextFontSize);
-            t.setString(li);
-            auto sz = t.getGlobalBounds().size;
-            if (sz.x + 50.f > width) {
-                width = sz.x + 50.f;
-            }
-            if (liCount < maxListItemsInView) {
-                height += sz.y + lineHeight;
+    // The box is as wide as the widest item, whether it's in view or not
+    const auto& listItems = dialog.getListItems();
+    const std::size_t firstInView = dialog.getListScrollPosition();
+    const std::size_t endOfView = std::min(firstInView + MAX_LIST_ITEMS_IN_VIEW, listItems.size());
+    m_listItems.clear();
+    for (std::size_t n = 0; n < listItems.size(); ++n) {
+        sf::Text t(m_font, listItems[n], BODY_TEXT_FONT_SIZE);
+        const auto size = t.getGlobalBounds().size;
+        width = std::max(width, size.x + 50.f);
+        if (n < MAX_LIST_ITEMS_IN_VIEW) {
+            height += size.y + LINE_HEIGHT;
+        }
+        if (n >= firstInView && n < endOfView) {
+            if (n == dialog.getListSelection()) {
+                t.setStyle(sf::Text::Bold);
+                t.setFillColor(sf::Color::White);
+            } else {
+                t.setFillColor(TEXT_COLOUR);
             }
-            t.setFillColor(addTextColour);
-            listText.push_back(t);
-            ++liCount;
+            m_listItems.push_back(t);
         }
+    }
+    if (!listItems.empty()) {
         height += 25.f; // Bit more for bottom margin
     }
-
-    sf::Text promptText(font, std::string(prompt), 20);
-    auto promptWidth = promptText.getGlobalBounds().size.x + 50.f;
-    if (promptWidth > width) {
-        width = promptWidth;
+    m_prompt->setString(dialog.getPrompt());
+    width = std::max(width, m_prompt->getGlobalBounds().size.x + 50.f);
+
+    // Everything's centred in the window
+    m_background.setSize({ width, height });
+    m_background.setPosition(
+        { (m_windowSize.x - width) / 2.f, (m_windowSize.y - height) / 2.f });
+    const auto bgPos = m_background.getPosition();
+    m_prompt->setPosition({ bgPos.x + 25.f, bgPos.y + 20.f });
+    m_inputBox.setSize({ width - 50.f, 40.f });
+    m_inputBox.setPosition({ bgPos.x + 20.f, bgPos.y + 60.f });
+    m_entry->setPosition({ bgPos.x + 25.f, bgPos.y + 65.f });
+    m_entry->setString(dialog.getEntry() + "_");
+
+    float textYPos = type == Input::Type::PressAnyKey ? 60.f : 140.f;
+    m_ticks.clear();
+    for (std::size_t n = 0; n < m_text.size(); ++n) {
+        m_text[n].setPosition({ bgPos.x + 25.f, bgPos.y + textYPos });
+        const char hotkey = dialog.getHotkeys()[n];
+        if (m_tickTexture && hotkey && dialog.getResult().optionsSelected.contains(hotkey)) {
+            sf::Sprite& tick = m_ticks.emplace_back(*m_tickTexture);
+            tick.setPosition({ bgPos.x + 7.f, bgPos.y + textYPos });
+        }
+        textYPos += LINE_SPACING;
     }
 
-    // Background box
-    sf::RectangleShape backgroundBox(sf::Vector2f(width, height));
-
-    backgroundBox.setFillColor({ 40, 40, 40 });
-    backgroundBox.setOutlineColor({ 128, 128, 128 });
-    backgroundBox.setOutlineThickness(2);
-    backgroundBox.setPosition({ screenCentre.x - width / 2.f, screenCentre.y - height / 2.f });
-
-    const auto bgPos = backgroundBox.getPosition();
-
-    // Text and input box elements
-    promptText.setFillColor(sf::Color::Green);
-    promptText.setPosition({ bgPos.x + 25.f, bgPos.y + 20.f });
-
-    sf::RectangleShape inputBox(sf::Vector2f(width - 50.f, 40.f));
-    inputBox.setFillColor(sf::Color::White);
-    inputBox.setOutlineColor({ 192, 0, 0 });
-    inputBox.setOutlineThickness(2);
-    inputBox.setPosition({ bgPos.x + 20.f, bgPos.y + 60.f });
-
-    sf::Text inputText(font, "", 20);
-    inputText.setFillColor(sf::Color::Black);
-    inputText.setPosition({ bgPos.x + 25.f, bgPos.y + 65.f });
-    inputText.setString(std::string(defaultEntry) + "_");
-
-    float addTextYPos = 140.f;
-    if (type == Input::Type::PressAnyKey) {
-        addTextYPos = 60.f;
+    float listYPos = 65.f;
+    m_arrows.clear();
+    if (firstInView > 0) {
+        sf::Sprite& upArrow = m_arrows.emplace_back(m_upArrowTexture);
+        upArrow.setPosition({ bgPos.x + 25.f, bgPos.y + listYPos });
     }
-    constexpr float lineSpacing = 28.f;
-
-    for (auto& t : addText) {
-        t.setFillColor(addTextColour);
-        t.setPosition({ bgPos.x + 25.f, bgPos.y + addTextYPos });
-        addTextYPos += lineSpacing;
+    for (sf::Text& t : m_listItems) {
+        t.setPosition({ bgPos.x + 45.f, bgPos.y + listYPos });
+        listYPos += LINE_SPACING;
     }
+    if (endOfView < listItems.size()) {
+        sf::Sprite& downArrow = m_arrows.emplace_back(m_downArrowTexture);
+        downArrow.setPosition({ bgPos.x + 25.f, bgPos.y + listYPos - LINE_SPACING });
+    }
+}
 
-    sf::Texture downArrowTexture;
-    if (!downArrowTexture.loadFromFile("img/downArrow.png")) {
-        MGOLOG("Could not load img/downArrow.png");
-        throw std::runtime_error("Could not load img/downArrow.png");
+void DialogBox::draw(sf::RenderTarget& target, sf::RenderStates states) const
+{
+    target.draw(m_shade, states);
+    target.draw(m_background, states);
+    target.draw(*m_prompt, states);
+    if (m_showEntry) {
+        target.draw(m_inputBox, states);
+        target.draw(*m_entry, states);
     }
-    sf::Sprite downArrow(downArrowTexture);
-    sf::Texture upArrowTexture;
-    if (!upArrowTexture.loadFromFile("img/upArrow.png")) {
-        MGOLOG("Could not load img/upArrow.png");
-        throw std::runtime_error("Could not load img/upArrow.png");
+    for (const sf::Text& t : m_text) {
+        target.draw(t, states);
     }
-    sf::Sprite upArrow(upArrowTexture);
-
-    std::string input = std::string(defaultEntry);
-    bool enterPressed = false;
-    bool firstKeyPress = true;
-    std::size_t currentListSelection = 0; // for list picker
-    Input::Return rc {};
-
-    // Dialog loop
-    std::optional event = window.pollEvent(); // Clear the keypress that got us here
-    while (!enterPressed) {
-        for (;;) {
-            event = window.pollEvent();
-            if (!event.has_value()) {
-                break;
-            }
-            if (auto e = event->getIf<sf::Event::TextEntered>()) {
-                auto keyPress = e->unicode;
-                char c = static_cast<char>(keyPress);
-                // If the user doesn't press enter or uses Alt then clear the entry
-                if (firstKeyPress && keyPress != '\r' && keyPress != '\n'
-                    && !sf::Keyboard::isKeyPressed(sf::Keyboard::Key::RAlt)
-                    && !sf::Keyboard::isKeyPressed(sf::Keyboard::Key::LAlt)) {
-                    {
-                        input.clear();
-                    }
-                }
-                if (keyPress == '\b') {
-                    if (!input.empty()) {
-                        input.pop_back();
-                    }
-                } else if (keyPress == '\r' || keyPress == '\n') {
-                    enterPressed = true;
-                } else if (keyPress > 31 && keyPress < 128) { // ASCII characters
-                    if (type == Input::Type::Numeric) {
-                        if (std::isdigit(c) || c == '.' || (input.length() == 0 && c == '-')) {
-                            firstKeyPress = false;
-                            input += c;
-                        }
-                    } else if (type == Input::Type::Text) {
-                        firstKeyPress = false;
-                        input += c;
-                    } else if (type == Input::Type::PressAnyKey) {
-                        enterPressed = true;
-                    }
-                }
-                inputText.setString(input + "_");
-            } else if (auto e = event->getIf<sf::Event::KeyPressed>()) {
-                if (e->scancode == sf::Keyboard::Scancode::Escape) { // Escape to cancel
-                    return Input::Return();
-                }
-                if (e->scancode == sf::Keyboard::Scancode::Down
-                    && currentListSelection < listText.size() - 1) {
-                    ++currentListSelection;
-                    if (currentListSelection >= currentScrollPosition + maxListItemsInView) {
-                        ++currentScrollPosition;
-                    }
-                }
-                if (e->scancode == sf::Keyboard::Scancode::Up && currentListSelection > 0) {
-                    --currentListSelection;
-                    if (currentListSelection < currentScrollPosition) {
-                        --currentScrollPosition;
-                    }
-                }
-                if ((sf::Keyboard::isKeyPressed(sf::Keyboard::Key::LAlt)
-                    || sf::Keyboard::isKeyPressed(sf::Keyboard::Key::RAlt))
-                    || type == Input::Type::Numeric ) {
-                    if (char charPressed = convertScanCodeToChar(e->scancode)) {
-                        if (std::find(hotkeys.begin(), hotkeys.end(), charPressed)
-                            != hotkeys.end()) {
-                            if (rc.optionsSelected.contains(charPressed)) {
-                                rc.optionsSelected.erase(charPressed);
-                            } else {
-                                rc.optionsSelected.insert(charPressed);
-                            }
-                        }
-                    }
-                }
-            }
-        }
-
-        // Clear and redraw the window
-        window.clear(sf::Color::Black);
-        sf::Sprite sprite(windowContent);
-        sprite.setColor({ 120, 120, 120 }); // dim it a bit
-        window.draw(sprite); // draw the static main window content
-
-        window.draw(backgroundBox);
-        window.draw(promptText);
-        if (type == Input::Type::Numeric || type == Input::Type::Text) {
-            window.draw(inputBox);
-            window.draw(inputText);
-        }
-        addTextCounter = 0;
-        for (auto& t : addText) {
-            window.draw(t);
-            auto it = hotkeyMap.find(addTextCounter);
-            if (it != hotkeyMap.end()) {
-                if (rc.optionsSelected.contains(it->second)) {
-                    sf::Texture tx;
-                    if (!tx.loadFromFile("img/tick.png")) {
-                        MGOLOG("Could not load img/tick.png");
-                    } else {
-                        sf::Sprite s(tx);
-                        auto p = t.getPosition();
-                        s.setPosition({ p.x - 18.f, p.y });
-                        window.draw(s);
-                    }
-                }
-            }
-            ++addTextCounter;
-        }
-        std::size_t count = 0;
-        float listPickerYPos = 65.f;
-        if (currentScrollPosition > 0) {
-            upArrow.setPosition({ bgPos.x + 25.f, bgPos.y + listPickerYPos });
-            window.draw(upArrow);
-        }
-        for (auto& li : listText) {
-            if (count >= currentScrollPosition
-                && count < currentScrollPosition + maxListItemsInView) {
-                if (count == currentListSelection) {
-                    li.setStyle(sf::Text::Bold);
-                    li.setFillColor(sf::Color::White);
-                } else {
-                    li.setStyle(sf::Text::Regular);
-                    li.setFillColor(addTextColour);
-                }
-                li.setPosition({ bgPos.x + 45.f, bgPos.y + listPickerYPos });
-                listPickerYPos += lineSpacing;
-                window.draw(li);
-            }
-            if (count >= currentScrollPosition + maxListItemsInView) {
-                downArrow.setPosition({ bgPos.x + 25.f, bgPos.y + listPickerYPos - lineSpacing });
-                window.draw(downArrow);
-            }
-            ++count;
-        }
-        window.display();
+    for (const sf::Sprite& tick : m_ticks) {
+        target.draw(tick, states);
     }
-    rc.cancelled = false;
-    rc.pickedItem = currentListSelection;
-    rc.text = input;
-    if (type == Input::Type::Numeric) {
-        try {
-            rc.number = std::stod(input);
-        } catch (...) {
-            // Just leave as zero. We should never get here as the user is constrained
-            // to enter just numeric characters in numeric entry
-        }
+    for (const sf::Sprite& arrow : m_arrows) {
+        target.draw(arrow, states);
     }
-    return rc;
-}
-
-void pressAnyKey(sf::RenderWindow& window, sf::Font& font, std::string_view prompt)
-{
-    // Save the existing main window's contents so we're not displaying on a black screen
-    sf::Texture windowContent(sf::Vector2u(window.getSize().x, window.getSize().y));
-    windowContent.update(window);
-
-    sf::Vector2f screenCentre;
-    screenCentre.x = window.getSize().x / 2.f;
-    screenCentre.y = window.getSize().y / 2.f;
-
-    // Background box
-    sf::RectangleShape backgroundBox(sf::Vector2f(400, 100));
-    backgroundBox.setFillColor({ 40, 40, 40 });
-    backgroundBox.setOutlineColor({ 128, 128, 128 });
-    backgroundBox.setOutlineThickness(2);
-    backgroundBox.setPosition(
-        { screenCentre.x - backgroundBox.getSize().x / 2, screenCentre.y - 150.f });
-
-    const auto bgPos = backgroundBox.getPosition();
-
-    // Text and input box elements
-    sf::Text promptText(font, std::string(prompt), 20);
-    promptText.setFillColor(sf::Color::White);
-    promptText.setPosition({ bgPos.x + 25.f, bgPos.y + 20.f });
-
-    // Dialog loop
-    std::optional event = window.pollEvent(); // Clear the keypress that got us here
-    for (;;) {
-        event = window.pollEvent();
-        if (!event.has_value()) {
-            continue;
-        }
-        if (event->is<sf::Event::KeyPressed>()) {
-            return;
-        }
-        // Clear and redraw the window
-        window.clear(sf::Color::Black);
-        sf::Sprite sprite(windowContent);
-        sprite.setColor({ 120, 120, 120 }); // dim it a bit
-        window.draw(sprite); // draw the static main window content
-
-        window.draw(backgroundBox);
-        window.draw(promptText);
-        window.display();
+    for (const sf::Text& t : m_listItems) {
+        target.draw(t, states);
     }
 }
 
-} // end namespace dialog
-} // end namespace mgo
\ No newline at end of file
+} // end namespace
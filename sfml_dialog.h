@@ -1,29 +1,49 @@
 #pragma once
-#include "iview.h" // for Input::*
+// Draws the open Dialog (see dialog.h) over the main display. It's laid out
+// again only when the dialog's state changes, i.e. when a key is pressed,
+// and the main display carries on being drawn (and updated) behind it.
+
+#include "dialog.h"
+
 #include <SFML/Graphics.hpp>
-#include <string>
+
+#include <memory>
+#include <vector>
 
 namespace mgo {
-namespace dialog {
 
-enum class InputType {
-    string,
-    numeric
+class DialogBox : public sf::Drawable {
+public:
+    // Loads the images it needs, so the window's OpenGL context must be
+    // active. Throws if they can't be loaded.
+    DialogBox(const sf::Font& font, sf::Vector2u windowSize);
+
+    void setDialog(const Dialog& dialog);
+
+private:
+    const sf::Font& m_font;
+    sf::Vector2f m_windowSize;
+    sf::Texture m_upArrowTexture;
+    sf::Texture m_downArrowTexture;
+    // Options are ticked only if this could be loaded
+    std::unique_ptr<sf::Texture> m_tickTexture;
+
+    // Dims the main display behind the dialog
+    sf::RectangleShape m_shade;
+    sf::RectangleShape m_background;
+    std::unique_ptr<sf::Text> m_prompt;
+    bool m_showEntry { false };
+    sf::RectangleShape m_inputBox;
+    std::unique_ptr<sf::Text> m_entry;
+    std::vector<sf::Text> m_text;
+    // Against the options which are selected
+    std::vector<sf::Sprite> m_ticks;
+    // Only the list items in view
+    std::vector<sf::Text> m_listItems;
+    // Shown if there are list items out of view
+    std::vector<sf::Sprite> m_arrows;
+
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
 };
 
-Input::Return getInput(
-    sf::RenderWindow& window,
-    sf::Font& font,
-    Input::Type type,
-    std::string_view prompt,
-    std::vector<std::string> additionalText,
-    std::string_view defaultEntry,
-    std::optional<std::vector<std::string>> listItems = std::nullopt);
-
-void pressAnyKey(
-    sf::RenderWindow& window,
-    sf::Font& font,
-    std::string_view prompt = "Press any key to continue");
-
-} // end namespace dialog
-} // end namespace mgo
\ No newline at end of file
+} // end namespace
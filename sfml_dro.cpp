@@ -0,0 +1,88 @@
+#include "sfml_dro.h"
+
+namespace mgo {
+
+namespace {
+
+// As sf::Text does, so glyphs aren't clipped by their neighbours in the atlas
+constexpr float GLYPH_PADDING = 1.f;
+
+} // end anonymous namespace
+
+DroText::DroText(const sf::Font& font, unsigned characterSize, std::size_t width)
+    : m_font(font)
+    , m_characterSize(characterSize)
+    , m_width(width)
+    , m_vertices(sf::PrimitiveType::Triangles, width * VERTICES_PER_CHARACTER)
+{
+    // This rasterises each glyph into the font's texture for this size, where
+    // it stays for as long as the font does
+    for (std::size_t n = 0; n < DRO_CHARACTERS.size(); ++n) {
+        m_glyphs[n] = m_font.getGlyph(DRO_CHARACTERS[n], m_characterSize, false);
+    }
+    setString("");
+}
+
+void DroText::setString(std::string_view text)
+{
+    // Text is laid out as sf::Text would lay it out: glyphs sit on a baseline
+    // one character size down from the top, each advancing by its own width
+    const float y = static_cast<float>(m_characterSize);
+    float x = 0.f;
+    for (std::size_t n = 0; n < m_width; ++n) {
+        sf::Vertex* quad = &m_vertices[n * VERTICES_PER_CHARACTER];
+        const std::size_t index
+            = n < text.size() ? DRO_CHARACTERS.find(text[n]) : std::string_view::npos;
+        if (index == 0 || index == std::string_view::npos) {
+            // A space (or past the end), so an empty quad
+            for (std::size_t v = 0; v < VERTICES_PER_CHARACTER; ++v) {
+                quad[v].position = { x, y };
+                quad[v].texCoords = {};
+            }
+            if (n < text.size()) {
+                x += m_glyphs[0].advance;
+            }
+            continue;
+        }
+        const sf::Glyph& glyph = m_glyphs[index];
+        const float left = x + glyph.bounds.position.x - GLYPH_PADDING;
+        const float top = y + glyph.bounds.position.y - GLYPH_PADDING;
+        const float right = x + glyph.bounds.position.x + glyph.bounds.size.x + GLYPH_PADDING;
+        const float bottom = y + glyph.bounds.position.y + glyph.bounds.size.y + GLYPH_PADDING;
+        const float u1 = static_cast<float>(glyph.textureRect.position.x) - GLYPH_PADDING;
+        const float v1 = static_cast<float>(glyph.textureRect.position.y) - GLYPH_PADDING;
+        const float u2 = static_cast<float>(glyph.textureRect.position.x + glyph.textureRect.size.x)
+            + GLYPH_PADDING;
+        const float v2 = static_cast<float>(glyph.textureRect.position.y + glyph.textureRect.size.y)
+            + GLYPH_PADDING;
+        quad[0].position = { left, top };
+        quad[0].texCoords = { u1, v1 };
+        quad[1].position = { right, top };
+        quad[1].texCoords = { u2, v1 };
+        quad[2].position = { left, bottom };
+        quad[2].texCoords = { u1, v2 };
+        quad[3].position = { left, bottom };
+        quad[3].texCoords = { u1, v2 };
+        quad[4].position = { right, top };
+        quad[4].texCoords = { u2, v1 };
+        quad[5].position = { right, bottom };
+        quad[5].texCoords = { u2, v2 };
+        x += glyph.advance;
+    }
+}
+
+void DroText::setFillColor(sf::Color colour)
+{
+    for (std::size_t n = 0; n < m_vertices.getVertexCount(); ++n) {
+        m_vertices[n].color = colour;
+    }
+}
+
+void DroText::draw(sf::RenderTarget& target, sf::RenderStates states) const
+{
+    states.transform *= getTransform();
+    states.texture = &m_font.getTexture(m_characterSize);
+    target.draw(m_vertices, states);
+}
+
+} // end namespace
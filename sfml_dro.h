@@ -0,0 +1,40 @@
+#pragma once
+// A digital readout: a fixed number of characters (digits, sign, decimal
+// point and so on) drawn from glyphs rasterised once, when it's created.
+// Unlike sf::Text, changing the value doesn't rebuild any geometry or
+// allocate: each character's quad already exists, and just has its
+// position and texture coordinates rewritten.
+
+#include <SFML/Graphics.hpp>
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+
+namespace mgo {
+
+// The only characters a readout can show; any others are shown as spaces
+constexpr std::string_view DRO_CHARACTERS = " 0123456789+-.";
+
+class DroText : public sf::Drawable, public sf::Transformable {
+public:
+    // "width" is the most characters the readout will ever show
+    DroText(const sf::Font& font, unsigned characterSize, std::size_t width);
+
+    void setString(std::string_view text);
+    void setFillColor(sf::Color colour);
+
+private:
+    static constexpr std::size_t VERTICES_PER_CHARACTER = 6;
+
+    const sf::Font& m_font;
+    unsigned m_characterSize;
+    std::size_t m_width;
+    // The glyphs of DRO_CHARACTERS, in the same order
+    std::array<sf::Glyph, DRO_CHARACTERS.size()> m_glyphs;
+    sf::VertexArray m_vertices;
+
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+};
+
+} // end namespace
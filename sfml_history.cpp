@@ -0,0 +1,165 @@
+#include "sfml_history.h"
+
+#include <algorithm>
+
+#include <fmt/format.h>
+
+namespace mgo {
+
+namespace {
+
+constexpr float PLOT_GAP = 10.f;
+// Room at the top of each plot for its label
+constexpr float LABEL_HEIGHT = 24.f;
+// Between the lines and the frame
+constexpr float PADDING = 4.f;
+
+// Indexed by HistoryChannel
+const std::array<sf::Color, HISTORY_CHANNELS> CHANNEL_COLOURS { sf::Color::Green,
+                                                                sf::Color { 209, 209, 50 },
+                                                                sf::Color::Cyan,
+                                                                sf::Color { 209, 209, 50 },
+                                                                sf::Color::Cyan };
+
+std::size_t index(HistoryChannel channel)
+{
+    return static_cast<std::size_t>(channel);
+}
+
+} // end anonymous namespace
+
+HistoryPlots::HistoryPlots(
+    const History& history,
+    const sf::Font& font,
+    sf::FloatRect area,
+    std::size_t samples,
+    const std::string& axis1Label,
+    const std::string& axis2Label)
+    : m_history(history)
+    , m_samples(std::clamp(samples, std::size_t { 2 }, HISTORY_SAMPLES))
+{
+    m_newSamples.reserve(HISTORY_SAMPLES);
+    for (std::size_t channel = 0; channel < HISTORY_CHANNELS; ++channel) {
+        m_lines[channel].resize(m_samples * 2);
+        for (std::size_t n = 0; n < m_lines[channel].size(); ++n) {
+            m_lines[channel][n].position = { static_cast<float>(n), 0.f };
+            m_lines[channel][n].color = CHANNEL_COLOURS[channel];
+        }
+    }
+
+    const std::string axes = fmt::format("{} (yellow) and {} (cyan)", axis1Label, axis2Label);
+    m_plots.resize(3);
+    m_plots[0].name = "Spindle RPM";
+    m_plots[0].channels = { HistoryChannel::Rpm };
+    m_plots[0].minimumSpan = 20.f;
+    m_plots[1].name = axes + " speed, mm/min";
+    m_plots[1].channels = { HistoryChannel::Axis1Speed, HistoryChannel::Axis2Speed };
+    m_plots[1].minimumSpan = 2.f;
+    m_plots[2].name = axes + " position, mm";
+    m_plots[2].channels = { HistoryChannel::Axis1Position, HistoryChannel::Axis2Position };
+    m_plots[2].minimumSpan = 0.1f;
+
+    const float height = (area.size.y - PLOT_GAP * (m_plots.size() - 1)) / m_plots.size();
+    for (std::size_t n = 0; n < m_plots.size(); ++n) {
+        Plot& plot = m_plots[n];
+        const sf::Vector2f position { area.position.x,
+                                      area.position.y + n * (height + PLOT_GAP) };
+        plot.frame.setSize({ area.size.x, height });
+        plot.frame.setPosition(position);
+        plot.frame.setFillColor(sf::Color::Transparent);
+        plot.frame.setOutlineColor({ 128, 128, 128 });
+        plot.frame.setOutlineThickness(1.f);
+        plot.label = std::make_unique<sf::Text>(font, plot.name, 18);
+        plot.label->setPosition({ position.x + PADDING, position.y + 2.f });
+        plot.label->setFillColor({ 128, 128, 128 });
+    }
+}
+
+void HistoryPlots::update()
+{
+    m_newSamples.clear();
+    m_nextSample = m_history.read(m_nextSample, m_newSamples);
+    for (const HistorySample& sample : m_newSamples) {
+        const std::size_t slot = m_written % m_samples;
+        for (std::size_t channel = 0; channel < HISTORY_CHANNELS; ++channel) {
+            m_lines[channel][slot].position.y = sample[channel];
+            m_lines[channel][slot + m_samples].position.y = sample[channel];
+        }
+        ++m_written;
+    }
+    for (Plot& plot : m_plots) {
+        rescale(plot);
+    }
+}
+
+std::size_t HistoryPlots::newestIndex() const
+{
+    return (m_written - 1) % m_samples + m_samples;
+}
+
+std::size_t HistoryPlots::visibleSamples() const
+{
+    return std::min(m_written, m_samples);
+}
+
+void HistoryPlots::rescale(Plot& plot) const
+{
+    if (visibleSamples() < 2) {
+        return;
+    }
+    const std::size_t newest = newestIndex();
+    const std::size_t oldest = newest + 1 - visibleSamples();
+    float lowest = m_lines[index(plot.channels.front())][newest].position.y;
+    float highest = lowest;
+    for (HistoryChannel channel : plot.channels) {
+        const auto& line = m_lines[index(channel)];
+        for (std::size_t n = oldest; n <= newest; ++n) {
+            lowest = std::min(lowest, line[n].position.y);
+            highest = std::max(highest, line[n].position.y);
+        }
+    }
+    if (lowest != plot.lowest || highest != plot.highest) {
+        plot.lowest = lowest;
+        plot.highest = highest;
+        plot.label->setString(
+            fmt::format("{}: {:.2f} to {:.2f}", plot.name, lowest, highest));
+    }
+
+    // Values are centred in the plot if they span less than its minimum
+    const float span = std::max(highest - lowest, plot.minimumSpan);
+    const float low = (lowest + highest - span) / 2.f;
+    const sf::FloatRect frame { plot.frame.getPosition(), plot.frame.getSize() };
+    const float lineHeight = frame.size.y - LABEL_HEIGHT - 2.f * PADDING;
+    const float lineBottom = frame.position.y + frame.size.y - PADDING;
+    // The newest sample is at the right-hand edge, the oldest the plot has
+    // room for at the left-hand edge, and screen y increases downwards
+    const float xScale = frame.size.x / (m_samples - 1);
+    const float yScale = -lineHeight / span;
+    plot.transform = sf::Transform::Identity;
+    plot.transform.translate(
+        { frame.position.x + frame.size.x - newest * xScale, lineBottom - low * yScale });
+    plot.transform.scale({ xScale, yScale });
+}
+
+void HistoryPlots::draw(sf::RenderTarget& target, sf::RenderStates states) const
+{
+    const std::size_t count = visibleSamples();
+    for (const Plot& plot : m_plots) {
+        target.draw(plot.frame, states);
+        target.draw(*plot.label, states);
+        if (count < 2) {
+            continue;
+        }
+        sf::RenderStates lineStates = states;
+        lineStates.transform *= plot.transform;
+        for (HistoryChannel channel : plot.channels) {
+            target.draw(
+                &m_lines[index(channel)][newestIndex() + 1 - count],
+                count,
+                sf::PrimitiveType::LineStrip,
+                lineStates);
+        }
+    }
+}
+
+} // end namespace
@@ -0,0 +1,75 @@
+#pragma once
+// Oscilloscope-style plots of the model's History: spindle RPM, the axes'
+// speeds, and their positions, scrolling from right to left.
+//
+// Each channel's line is held in a vertex array twice as long as the plot
+// is wide (in samples), with each sample written to it twice, N apart, so
+// the most recent N samples are always contiguous and each plot is one draw
+// call per channel. A vertex's x is its index in the array and its y is the
+// sample's value, and both the scrolling and the scaling to fit the values
+// on screen are done by the transform they're drawn with. So a new sample
+// only rewrites its own two vertices, and nothing is reallocated.
+
+#include "history.h"
+
+#include <SFML/Graphics.hpp>
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mgo {
+
+class HistoryPlots : public sf::Drawable {
+public:
+    // The plots share "area" between them, and show "samples" samples
+    // (at most HISTORY_SAMPLES) across their width
+    HistoryPlots(
+        const History& history,
+        const sf::Font& font,
+        sf::FloatRect area,
+        std::size_t samples,
+        const std::string& axis1Label,
+        const std::string& axis2Label);
+
+    // Takes any samples recorded since the last update
+    void update();
+
+private:
+    struct Plot {
+        std::string name;
+        std::vector<HistoryChannel> channels;
+        // The least span of values shown, so noise isn't magnified to fill
+        // the plot
+        float minimumSpan { 1.f };
+        sf::RectangleShape frame;
+        // The name, and the lowest and highest values shown
+        std::unique_ptr<sf::Text> label;
+        float lowest { 0.f };
+        float highest { 0.f };
+        // Scrolls and scales the lines to fit the frame
+        sf::Transform transform;
+    };
+
+    const History& m_history;
+    std::size_t m_samples;
+    // The number of the next sample to read from the history
+    std::size_t m_nextSample { 0 };
+    // How many samples have been written to the vertex arrays
+    std::size_t m_written { 0 };
+    // Read into, then copied from, so it's only ever allocated once
+    std::vector<HistorySample> m_newSamples;
+    // Indexed by HistoryChannel
+    std::array<std::vector<sf::Vertex>, HISTORY_CHANNELS> m_lines;
+    std::vector<Plot> m_plots;
+
+    // The index, in each vertex array, of the newest sample
+    std::size_t newestIndex() const;
+    std::size_t visibleSamples() const;
+    void rescale(Plot& plot) const;
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+};
+
+} // end namespace
@@ -0,0 +1,98 @@
+#include "sfml_toolpath.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace mgo {
+
+namespace {
+
+const sf::Color CUT_COLOUR { 209, 209, 50 };
+const sf::Color MOVE_COLOUR { 128, 128, 128 };
+
+} // end anonymous namespace
+
+ToolpathPreview::ToolpathPreview(sf::FloatRect area)
+    : m_area(area)
+    , m_frame(area.size)
+{
+    m_frame.setPosition(area.position);
+    m_frame.setFillColor(sf::Color::Transparent);
+    m_frame.setOutlineColor(MOVE_COLOUR);
+    m_frame.setOutlineThickness(1.f);
+    m_tool.setOrigin({ TOOL_RADIUS, TOOL_RADIUS });
+    m_tool.setFillColor(sf::Color::Red);
+}
+
+void ToolpathPreview::setPath(const std::vector<ToolpathLine>& path)
+{
+    // The scale is whatever fits the whole path in, on both axes
+    double minAxis1 = std::numeric_limits<double>::max();
+    double maxAxis1 = std::numeric_limits<double>::lowest();
+    double minAxis2 = std::numeric_limits<double>::max();
+    double maxAxis2 = std::numeric_limits<double>::lowest();
+    for (const ToolpathLine& line : path) {
+        for (const ToolpathPoint& point : { line.from, line.to }) {
+            minAxis1 = std::min(minAxis1, point.axis1);
+            maxAxis1 = std::max(maxAxis1, point.axis1);
+            minAxis2 = std::min(minAxis2, point.axis2);
+            maxAxis2 = std::max(maxAxis2, point.axis2);
+        }
+    }
+    if (!path.empty()) {
+        // A path which is a straight line along either axis has no extent
+        // on the other, so that axis doesn't limit the scale
+        const double width = std::max(maxAxis1 - minAxis1, 0.001);
+        const double height = std::max(maxAxis2 - minAxis2, 0.001);
+        m_scale = std::min(
+            (m_area.size.x - 2.f * MARGIN) / width, (m_area.size.y - 2.f * MARGIN) / height);
+        m_centre = { (minAxis1 + maxAxis1) / 2.0, (minAxis2 + maxAxis2) / 2.0 };
+    }
+
+    m_pathVertices.clear();
+    for (const ToolpathLine& line : path) {
+        const sf::Color colour = line.cutting ? CUT_COLOUR : MOVE_COLOUR;
+        m_pathVertices.push_back({ toPixels(line.from), colour });
+        m_pathVertices.push_back({ toPixels(line.to), colour });
+    }
+    if (sf::VertexBuffer::isAvailable() && m_pathBuffer.create(m_pathVertices.size())
+        && !m_pathVertices.empty()) {
+        [[maybe_unused]] bool rc = m_pathBuffer.update(m_pathVertices.data());
+    }
+}
+
+bool ToolpathPreview::isEmpty() const
+{
+    return m_pathVertices.empty();
+}
+
+void ToolpathPreview::setToolPosition(double axis1, double axis2)
+{
+    sf::Vector2f position = toPixels({ axis1, axis2 });
+    position.x = std::clamp(position.x, m_area.position.x, m_area.position.x + m_area.size.x);
+    position.y = std::clamp(position.y, m_area.position.y, m_area.position.y + m_area.size.y);
+    m_tool.setPosition(position);
+}
+
+sf::Vector2f ToolpathPreview::toPixels(ToolpathPoint point) const
+{
+    // Screen y increases downwards, but axis2 is drawn increasing upwards
+    const double x
+        = m_area.position.x + m_area.size.x / 2.0 + (point.axis1 - m_centre.axis1) * m_scale;
+    const double y
+        = m_area.position.y + m_area.size.y / 2.0 - (point.axis2 - m_centre.axis2) * m_scale;
+    return { static_cast<float>(x), static_cast<float>(y) };
+}
+
+void ToolpathPreview::draw(sf::RenderTarget& target, sf::RenderStates states) const
+{
+    target.draw(m_frame, states);
+    if (sf::VertexBuffer::isAvailable()) {
+        target.draw(m_pathBuffer, states);
+    } else if (!m_pathVertices.empty()) {
+        target.draw(m_pathVertices.data(), m_pathVertices.size(), sf::PrimitiveType::Lines, states);
+    }
+    target.draw(m_tool, states);
+}
+
+} // end namespace
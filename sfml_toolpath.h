@@ -0,0 +1,49 @@
+#pragma once
+// A preview of the planned toolpath (see toolpath.h), with the tool's
+// position overlaid. The path itself only changes when the settings it's
+// planned from do, so it's built into a vertex buffer (i.e. held by the
+// graphics card) once per change, and drawing it each frame costs a
+// single draw call. Only the tool's marker moves from frame to frame.
+
+#include "toolpath.h"
+
+#include <SFML/Graphics.hpp>
+
+#include <vector>
+
+namespace mgo {
+
+class ToolpathPreview : public sf::Drawable {
+public:
+    // The preview is drawn within "area" (in the window's coordinates), with
+    // axis1 increasing to the right and axis2 upwards, as a lathe's Z and X
+    // usually are
+    explicit ToolpathPreview(sf::FloatRect area);
+
+    // Rebuilds the path's vertex buffer, so must only be called when the
+    // path has changed, and with the window's OpenGL context active
+    void setPath(const std::vector<ToolpathLine>& path);
+    bool isEmpty() const;
+    // In mm. Kept within the preview's area even if it's off the path's.
+    void setToolPosition(double axis1, double axis2);
+
+private:
+    static constexpr float MARGIN = 10.f;
+    static constexpr float TOOL_RADIUS = 5.f;
+
+    sf::FloatRect m_area;
+    sf::RectangleShape m_frame;
+    sf::VertexBuffer m_pathBuffer { sf::PrimitiveType::Lines, sf::VertexBuffer::Usage::Static };
+    // Only drawn from if vertex buffers aren't available
+    std::vector<sf::Vertex> m_pathVertices;
+    sf::CircleShape m_tool { TOOL_RADIUS };
+    // How mm are mapped onto the area: the centre of the path is drawn at
+    // the centre of the area, at m_scale pixels per mm
+    ToolpathPoint m_centre;
+    double m_scale { 1.0 };
+
+    sf::Vector2f toPixels(ToolpathPoint point) const;
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+};
+
+} // end namespace
@@ -0,0 +1,66 @@
+#pragma once
+// Lock-free, fixed-capacity queue for exactly one producer thread and one
+// consumer thread. Slots are reused rather than reallocated: whatever the
+// consumer leaves in a slot is destroyed when the producer next writes to
+// it, so (for example) memory can be freed on the producer's side only.
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace mgo {
+
+template <typename T, std::size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+        "SpscQueue capacity must be a power of two");
+
+public:
+    // Producer only. Returns false (and leaves "item" alone) if the queue is full.
+    bool push(T&& item)
+    {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        m_slots[tail & (Capacity - 1)] = std::move(item);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. Returns nullptr if the queue is empty. The item stays
+    // in the queue (and may be modified in place) until pop() is called.
+    T* front()
+    {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &m_slots[head & (Capacity - 1)];
+    }
+
+    // Consumer only. Must only be called if front() returned an item.
+    void pop()
+    {
+        m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool empty() const
+    {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+    std::size_t size() const
+    {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+
+private:
+    std::array<T, Capacity> m_slots {};
+    // Kept on separate cache lines so the two threads don't contend
+    alignas(64) std::atomic<std::size_t> m_head { 0 }; // next slot to read
+    alignas(64) std::atomic<std::size_t> m_tail { 0 }; // next slot to write
+};
+
+} // end namespace
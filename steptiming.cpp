@@ -0,0 +1,111 @@
+#include "steptiming.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace mgo {
+
+namespace {
+
+constexpr uint32_t EXACT_BELOW = 32;
+constexpr uint32_t SUB_BUCKET_BITS = 4; // i.e. 16 buckets per power of two
+
+uint32_t bucketUpperBound(std::size_t bucket)
+{
+    if (bucket + 1 >= STEP_TIMING_BUCKETS) {
+        return UINT32_MAX;
+    }
+    return StepTimingStats::bucketLowerBound(bucket + 1) - 1;
+}
+
+} // end anonymous namespace
+
+uint32_t StepTimingSnapshot::percentile(double fraction) const
+{
+    if (count == 0) {
+        return 0;
+    }
+    const auto wanted = static_cast<uint64_t>(std::max(1.0, fraction * count));
+    uint64_t total = 0;
+    for (std::size_t n = 0; n < buckets.size(); ++n) {
+        total += buckets[n];
+        if (total >= wanted) {
+            return std::min(bucketUpperBound(n), maxMicroseconds);
+        }
+    }
+    return maxMicroseconds;
+}
+
+StepTimingSnapshot StepTimingSnapshot::since(const StepTimingSnapshot& earlier) const
+{
+    StepTimingSnapshot result;
+    for (std::size_t n = 0; n < buckets.size(); ++n) {
+        result.buckets[n] = buckets[n] - earlier.buckets[n];
+        result.count += result.buckets[n];
+        if (result.buckets[n] != 0) {
+            result.maxMicroseconds = std::min(bucketUpperBound(n), maxMicroseconds);
+        }
+    }
+    result.lateCount = lateCount - earlier.lateCount;
+    return result;
+}
+
+void StepTimingStats::record(uint32_t latenessMicroseconds)
+{
+    // As there's only one writer we don't need (slower) atomic increments
+    auto& bucket = m_buckets[bucketFor(latenessMicroseconds)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (latenessMicroseconds > m_lateThresholdMicroseconds.load(std::memory_order_relaxed)) {
+        m_lateCount.store(
+            m_lateCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    if (latenessMicroseconds > m_maxMicroseconds.load(std::memory_order_relaxed)) {
+        m_maxMicroseconds.store(latenessMicroseconds, std::memory_order_relaxed);
+    }
+}
+
+StepTimingSnapshot StepTimingStats::snapshot() const
+{
+    StepTimingSnapshot result;
+    for (std::size_t n = 0; n < m_buckets.size(); ++n) {
+        result.buckets[n] = m_buckets[n].load(std::memory_order_relaxed);
+        result.count += result.buckets[n];
+    }
+    result.lateCount = m_lateCount.load(std::memory_order_relaxed);
+    result.maxMicroseconds = m_maxMicroseconds.load(std::memory_order_relaxed);
+    return result;
+}
+
+void StepTimingStats::setLateThresholdMicroseconds(uint32_t threshold)
+{
+    m_lateThresholdMicroseconds = threshold;
+}
+
+uint32_t StepTimingStats::getLateThresholdMicroseconds() const
+{
+    return m_lateThresholdMicroseconds;
+}
+
+std::size_t StepTimingStats::bucketFor(uint32_t microseconds)
+{
+    if (microseconds < EXACT_BELOW) {
+        return microseconds;
+    }
+    // Keep the top five bits: the leading one, and which of
+    // the 16 divisions of this power of two we're in
+    const uint32_t shift = std::bit_width(microseconds) - 1 - SUB_BUCKET_BITS;
+    const std::size_t bucket = (shift << SUB_BUCKET_BITS) + (microseconds >> shift);
+    return std::min(bucket, STEP_TIMING_BUCKETS - 1);
+}
+
+uint32_t StepTimingStats::bucketLowerBound(std::size_t bucket)
+{
+    if (bucket < EXACT_BELOW) {
+        return static_cast<uint32_t>(bucket);
+    }
+    const std::size_t shift = (bucket >> SUB_BUCKET_BITS) - 1;
+    const uint32_t mantissa = (bucket & ((1u << SUB_BUCKET_BITS) - 1)) | (1u << SUB_BUCKET_BITS);
+    return mantissa << shift;
+}
+
+} // end namespace
@@ -0,0 +1,55 @@
+#pragma once
+// Records how late each step is taken compared with when it was scheduled,
+// so we can tell whether the step thread is being pre-empted (e.g. the
+// once-per-second "stutter" seen with some kernels). It's always on, so
+// recording has to be cheap: a histogram of plain atomic counters written
+// only by the motion controller's thread. Other threads take snapshots.
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace mgo {
+
+// Buckets are exact below 32 us, then each power of two is split into 16, so
+// every bucket is within about 6% of the values in it. 384 buckets covers
+// a couple of minutes.
+constexpr std::size_t STEP_TIMING_BUCKETS = 384;
+
+struct StepTimingSnapshot {
+    std::array<uint32_t, STEP_TIMING_BUCKETS> buckets {};
+    uint64_t count { 0 };
+    uint64_t lateCount { 0 };
+    uint32_t maxMicroseconds { 0 };
+
+    // Lateness which "fraction" (0 to 1) of steps were no later than, to
+    // the resolution of the buckets
+    uint32_t percentile(double fraction) const;
+    // What has been recorded since "earlier". Note maxMicroseconds is only
+    // as accurate as the buckets in the result.
+    StepTimingSnapshot since(const StepTimingSnapshot& earlier) const;
+};
+
+class StepTimingStats {
+public:
+    // Only to be called from one thread
+    void record(uint32_t latenessMicroseconds);
+
+    StepTimingSnapshot snapshot() const;
+
+    // Steps later than this are counted as late
+    void setLateThresholdMicroseconds(uint32_t threshold);
+    uint32_t getLateThresholdMicroseconds() const;
+
+    static std::size_t bucketFor(uint32_t microseconds);
+    static uint32_t bucketLowerBound(std::size_t bucket);
+
+private:
+    std::array<std::atomic<uint32_t>, STEP_TIMING_BUCKETS> m_buckets {};
+    std::atomic<uint64_t> m_lateCount { 0 };
+    std::atomic<uint32_t> m_maxMicroseconds { 0 };
+    std::atomic<uint32_t> m_lateThresholdMicroseconds { 100 };
+};
+
+} // end namespace
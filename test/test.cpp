@@ -1,22 +1,52 @@
 #include "configreader.h"
+#include "controller.h"
+#include "dialog.h"
+#include "displaysnapshot.h"
+#include "edgecapture.h"
+#include "electronicleadscrew.h"
+#include "gpioedge.h"
+#include "headlessview.h"
+#include "history.h"
+#include "keycodes.h"
+#include "linearscale.h"
 #include "log.h"
+#include "loststepmonitor.h"
 #include "model.h"
+#include "motioncontroller.h"
+#include "motionprofile.h"
+#include "profiler.h"
+#include "realtime.h"
+#include "replaygpio.h"
 #include "rotaryencoder.h"
+#include "rpmestimator.h"
+#include "scalefeedback.h"
+#include "seqlock.h"
+#include "spscqueue.h"
 #include "stepperControl/mockgpio.h"
-#include "stepperControl/steppermotor.h"
+#include "toolpath.h"
+#include "triplebuffer.h"
+#include "wakeup.h"
 
 #include <chrono>
 #include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <string>
 #include <thread>
+#include <vector>
 
 #define CATCH_CONFIG_MAIN
 #include "catch.hpp"
 
-TEST_CASE("Stepper: Step once")
+TEST_CASE("Motor:   Step once")
 {
     mgo::MockConfigReader config;
     mgo::MockGpio gpio(false, config);
-    mgo::StepperMotor motor(gpio, 0, 0, 0, 1'000, 1.0, 10'000.0);
+    mgo::MotionController motion(gpio);
+    mgo::Motor& motor = motion.addMotor(0, 0, 1'000, 1.0, 10'000.0, mgo::MotionLimits {});
     motor.setRpm(500.0);
     motor.goToStep(3);
     motor.wait();
@@ -24,11 +54,12 @@ TEST_CASE("Stepper: Step once")
     REQUIRE(motor.getCurrentStep() == 3);
 }
 
-TEST_CASE("Stepper: Stop motor")
+TEST_CASE("Motor:   Stop motor")
 {
     mgo::MockConfigReader config;
     mgo::MockGpio gpio(false, config);
-    mgo::StepperMotor motor(gpio, 0, 0, 0, 1'000, 1.0, 10'000.0);
+    mgo::MotionController motion(gpio);
+    mgo::Motor& motor = motion.addMotor(0, 0, 1'000, 1.0, 10'000.0, mgo::MotionLimits {});
     // High number of steps:
     motor.setRpm(500.0);
     motor.goToStep(1'000'000);
@@ -38,23 +69,26 @@ TEST_CASE("Stepper: Stop motor")
     motor.wait();
     REQUIRE(!motor.isRunning());
     REQUIRE(motor.getCurrentStep() > 0);
+    REQUIRE(motor.getCurrentStep() < 1'000'000);
 }
 
-TEST_CASE("Stepper: Stop stopped motor")
+TEST_CASE("Motor:   Stop stopped motor")
 {
     mgo::MockConfigReader config;
     mgo::MockGpio gpio(false, config);
-    mgo::StepperMotor motor(gpio, 0, 0, 0, 1'000, 1.0, 10'000.0);
+    mgo::MotionController motion(gpio);
+    mgo::Motor& motor = motion.addMotor(0, 0, 1'000, 1.0, 10'000.0, mgo::MotionLimits {});
     motor.stop();
     motor.wait();
     REQUIRE(!motor.isRunning());
 }
 
-TEST_CASE("Stepper: Move then move again")
+TEST_CASE("Motor:   Move then move again")
 {
     mgo::MockConfigReader config;
     mgo::MockGpio gpio(false, config);
-    mgo::StepperMotor motor(gpio, 0, 0, 0, 1'000, 1.0, 10'000.0);
+    mgo::MotionController motion(gpio);
+    mgo::Motor& motor = motion.addMotor(0, 0, 1'000, 1.0, 10'000.0, mgo::MotionLimits {});
     motor.setRpm(500.0);
     motor.goToStep(50);
     motor.wait();
@@ -66,11 +100,12 @@ TEST_CASE("Stepper: Move then move again")
     REQUIRE(motor.getCurrentStep() == 150);
 }
 
-TEST_CASE("Stepper: Forward and reverse")
+TEST_CASE("Motor:   Forward and reverse")
 {
     mgo::MockConfigReader config;
     mgo::MockGpio gpio(false, config);
-    mgo::StepperMotor motor(gpio, 0, 0, 0, 1'000, 1.0, 10'000.0);
+    mgo::MotionController motion(gpio);
+    mgo::Motor& motor = motion.addMotor(0, 0, 1'000, 1.0, 10'000.0, mgo::MotionLimits {});
     motor.setRpm(500.0);
     motor.goToStep(100);
     motor.wait();
@@ -80,59 +115,75 @@ TEST_CASE("Stepper: Forward and reverse")
     REQUIRE(motor.getCurrentStep() == 50);
 }
 
-TEST_CASE("Stepper: Check direction")
+TEST_CASE("Motor:   Check direction")
 {
     mgo::MockConfigReader config;
     mgo::MockGpio gpio(false, config);
-    mgo::StepperMotor motor(gpio, 0, 0, 0, 1'000, 1.0, 10'000.0);
-    motor.setRpm(500.0);
-    REQUIRE(motor.getDirection() == mgo::Direction::forward);
-    motor.goToStep(100);
-    motor.wait();
-    REQUIRE(motor.getDirection() == mgo::Direction::forward);
-    motor.goToStep(50); // This is a reverse now
-    motor.wait();
-    REQUIRE(motor.getDirection() == mgo::Direction::reverse);
-    motor.goToStep(100);
-    motor.wait();
-    REQUIRE(motor.getDirection() == mgo::Direction::forward);
+    mgo::MotionController motion(gpio);
+    mgo::Motor& motor = motion.addMotor(0, 0, 1'000, 1.0, 10'000.0, mgo::MotionLimits {});
+    // 1,000 steps per second, so each move takes a while
+    motor.setRpm(60.0);
+    // Each move only ever heads towards its target
+    auto goTo = [&](long target) {
+        long previous = motor.getCurrentStep();
+        const bool forward = target > previous;
+        motor.goToStep(target);
+        while (motor.isRunning()) {
+            const long step = motor.getCurrentStep();
+            REQUIRE((forward ? step >= previous : step <= previous));
+            previous = step;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        REQUIRE(motor.getCurrentStep() == target);
+    };
+    goTo(100);
+    goTo(50); // This is a reverse now
+    goTo(100);
 }
 
-TEST_CASE("Stepper: RPM")
+TEST_CASE("Motor:   RPM")
 {
     mgo::MockConfigReader config;
     mgo::MockGpio gpio(false, config);
-    mgo::StepperMotor motor(gpio, 0, 0, 0, 1'000, 1.0, 10'000.0);
+    mgo::MotionController motion(gpio);
+    mgo::Motor& motor = motion.addMotor(0, 0, 1'000, 1.0, 10'000.0, mgo::MotionLimits {});
     motor.setRpm(60);
-    // That's one revolution per second, and we've set steps per
-    // revolution to be 1000, so delay (which is used TWICE per
-    // thread loop), should be 500 usecs
-    REQUIRE(motor.getDelay() == 500);
-    motor.setRpm(120);
-    REQUIRE(motor.getDelay() == 250);
-    motor.setRpm(2'000);
-    REQUIRE(motor.getDelay() == 15);
-    motor.setRpm(1);
-    REQUIRE(motor.getDelay() == 30'000);
+    REQUIRE(motor.getRpm() == 60.0);
+    // Speed is in mm per minute, and we've one mm per step and 1000 steps
+    // per revolution
+    motor.setSpeed(120'000.0);
+    REQUIRE(motor.getRpm() == Approx(120.0));
+    // That's 10,000 steps per second, and there's no ramp, so 1,000 steps
+    // take a tenth of a second
+    motor.setRpm(600);
+    const auto start = std::chrono::steady_clock::now();
+    motor.goToStep(1'000);
+    motor.wait();
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    REQUIRE(elapsed >= std::chrono::milliseconds(95));
+    REQUIRE(elapsed < std::chrono::milliseconds(300));
 }
 
-TEST_CASE("Stepper: RPM Limits")
+TEST_CASE("Motor:   RPM Limits")
 {
     mgo::MockConfigReader config;
     mgo::MockGpio gpio(false, config);
-    mgo::StepperMotor motor(gpio, 0, 0, 0, 1'000, 1.0, 10'000.0);
+    mgo::MotionController motion(gpio);
+    mgo::Motor& motor = motion.addMotor(0, 0, 1'000, 1.0, 10'000.0, mgo::MotionLimits {});
     motor.setRpm(0);
-    motor.goToStep(10); // Shouldn't take infinite time :)
+    REQUIRE(motor.getRpm() > 0.0);
+    motor.goToStep(1); // Shouldn't take infinite time :)
     motor.wait();
     motor.setRpm(9'999'999); // bit too fast :)
-    REQUIRE(motor.getDelay() > 5);
+    REQUIRE(motor.getRpm() == motor.getMaxRpm());
 }
 
-TEST_CASE("Stepper: Change target step while busy")
+TEST_CASE("Motor:   Change target step while busy")
 {
     mgo::MockConfigReader config;
     mgo::MockGpio gpio(false, config);
-    mgo::StepperMotor motor(gpio, 0, 0, 0, 1'000, 1.0, 10'000.0);
+    mgo::MotionController motion(gpio);
+    mgo::Motor& motor = motion.addMotor(0, 0, 1'000, 1.0, 10'000.0, mgo::MotionLimits {});
     motor.setRpm(2'000);
     motor.goToStep(1'000);
     motor.goToStep(2'000);
@@ -141,7 +192,7 @@ TEST_CASE("Stepper: Change target step while busy")
     REQUIRE(motor.getCurrentStep() == 1'000);
 }
 
-TEST_CASE("Stepper: Rotary Encoder RPM")
+TEST_CASE("Encoder: RPM")
 {
     mgo::MockConfigReader config;
     mgo::MockGpio gpio(false, config);
@@ -153,27 +204,31 @@ TEST_CASE("Stepper: Rotary Encoder RPM")
     REQUIRE(re.getRpm() > 0.f);
 }
 
-TEST_CASE("Stepper: Rotary Encoder Position Callback")
+TEST_CASE("Encoder: Zero degrees prediction")
 {
     mgo::MockConfigReader config;
     mgo::MockGpio gpio(false, config);
     mgo::RotaryEncoder re(gpio, 23, 24, 2000, 35.f / 30.f);
-    bool called = false;
     while (re.warmingUp()) {
         gpio.delayMicroSeconds(1'000);
     }
-    re.callbackAtZeroDegrees([&]() {
-        called = true;
-    });
+    gpio.delayMicroSeconds(100'000);
+    const uint32_t now = gpio.getTick();
+    const auto tick = re.nextZeroDegreesTick(5'000);
     REQUIRE(re.warmingUp() == false);
-    REQUIRE(called == true);
+    REQUIRE(tick.has_value());
+    // No sooner than we asked, and within a revolution of that
+    const float revolutionMicroseconds = 60'000'000.f / re.getRpm();
+    REQUIRE(*tick - now >= 5'000);
+    REQUIRE(*tick - now < 5'000 + revolutionMicroseconds * 1.1f);
 }
 
-TEST_CASE("Stepper: Check backlash compensation")
+TEST_CASE("Motor:   Check backlash compensation")
 {
     mgo::MockConfigReader config;
     mgo::MockGpio gpio(false, config);
-    mgo::StepperMotor motor(gpio, 0, 0, 0, 1'000, 1.0, 10'000.0);
+    mgo::MotionController motion(gpio);
+    mgo::Motor& motor = motion.addMotor(0, 0, 1'000, 1.0, 10'000.0, mgo::MotionLimits {});
     // Set backlash compensation. This sets our backlash slop to be ten
     // steps which means if we move one step in a positive manner the
     // motor should really have to move eleven "real" steps
@@ -200,34 +255,47 @@ TEST_CASE("Stepper: Check backlash compensation")
     REQUIRE(motor.getCurrentStepWithoutBacklashCompensation() == 1);
 }
 
-TEST_CASE("Stepper: Check motor speed ramping")
+TEST_CASE("Motor:   Check motor speed ramping")
 {
     mgo::MockConfigReader config;
     mgo::MockGpio gpio(false, config);
-    double maxSpeed = 1'000.0; // mm/sec, not rpm
+    double maxSpeed = 1'000.0; // mm/min, not rpm
     long stepsPerRev = 4'000;
     double conversionFactor = 0.0005;
     double maxRpm = maxSpeed / conversionFactor / stepsPerRev;
-    mgo::StepperMotor motor(gpio, 0, 0, 0, stepsPerRev, conversionFactor, maxRpm);
+    // The model's default limits for axis 1, in steps
+    mgo::MotionLimits limits { 0.0, 50.0 / conversionFactor, 1'000.0 / conversionFactor };
+    mgo::MotionController motion(gpio);
+    mgo::Motor& motor = motion.addMotor(0, 0, stepsPerRev, conversionFactor, maxRpm, limits);
+    const double maxStepsPerSecond = maxRpm * stepsPerRev / 60.0;
     motor.setSpeed(maxSpeed);
     motor.goToStep(999'999'999);
-    // Motor should not be at full speed immediately:
-    double previousRampedRpm = 0.0;
+    // Motor should not be at full speed immediately, and should speed up
+    std::vector<double> speeds;
+    long previousStep = motor.getCurrentStep();
+    auto previousTime = std::chrono::steady_clock::now();
     for (int n = 0; n < 5; ++n) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(20));
-        double rampedSpeed = motor.getRampedSpeed();
-        REQUIRE(rampedSpeed < maxSpeed);
-        REQUIRE(rampedSpeed > previousRampedRpm);
-        previousRampedRpm = rampedSpeed;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        const long step = motor.getCurrentStep();
+        const auto time = std::chrono::steady_clock::now();
+        speeds.push_back(
+            (step - previousStep) / std::chrono::duration<double>(time - previousTime).count());
+        REQUIRE(speeds.back() < maxStepsPerSecond);
+        previousStep = step;
+        previousTime = time;
     }
+    REQUIRE(speeds.back() > speeds.front() * 2.0);
+    motor.stop();
+    motor.wait();
 }
 
-TEST_CASE("Stepper: Check motor synchronisation")
+TEST_CASE("Motor:   Check motor synchronisation")
 {
     mgo::MockConfigReader config;
     mgo::MockGpio gpio(false, config);
-    mgo::StepperMotor motor1(gpio, 0, 0, 0, 1'000, 0.01, 10'000.0);
-    mgo::StepperMotor motor2(gpio, 0, 0, 0, 1'000, 0.01, 10'000.0);
+    mgo::MotionController motion(gpio);
+    mgo::Motor& motor1 = motion.addMotor(0, 0, 1'000, 0.01, 10'000.0, mgo::MotionLimits {});
+    mgo::Motor& motor2 = motion.addMotor(1, 1, 1'000, 0.01, 10'000.0, mgo::MotionLimits {});
     motor1.setRpm(500.0);
     motor2.setRpm(500.0);
     REQUIRE(motor2.getPosition() == 0.0);
@@ -237,10 +305,810 @@ TEST_CASE("Stepper: Check motor synchronisation")
     motor1.setSpeed(1'000.0);
     motor1.goToPosition(2.4);
     motor1.wait();
-    motor2.wait();
+    // The follower's last step comes just after the master's
+    const auto start = std::chrono::steady_clock::now();
+    while (motor2.getCurrentStep() != 120
+           && std::chrono::steady_clock::now() - start < std::chrono::seconds(1)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    motor2.synchroniseOff();
     REQUIRE(motor2.getPosition() == Approx(1.2));
 }
 
+TEST_CASE("Profile: Ramp is symmetrical")
+{
+    mgo::MotionLimits limits { 10'000.0, 20'000.0, 200'000.0 };
+    mgo::MotionProfile profile(10'000, 5'000.0, limits);
+    REQUIRE(profile.rampLength() > 0);
+    REQUIRE(profile.peakStepsPerSecond() == Approx(5'000.0));
+    for (long n = 0; n < static_cast<long>(profile.rampLength()); ++n) {
+        REQUIRE(profile.delayForStep(n) == profile.delayForStep(profile.steps() - 1 - n));
+    }
+    REQUIRE(profile.delayForStep(5'000) == profile.cruiseDelay());
+}
+
+TEST_CASE("Profile: Ramp delays never increase while accelerating")
+{
+    mgo::MotionLimits limits { 10'000.0, 20'000.0, 200'000.0 };
+    mgo::MotionProfile profile(10'000, 5'000.0, limits);
+    for (std::size_t n = 1; n < profile.rampLength(); ++n) {
+        REQUIRE(profile.rampDelay(n) <= profile.rampDelay(n - 1));
+    }
+    REQUIRE(profile.rampDelay(profile.rampLength() - 1) >= profile.cruiseDelay());
+}
+
+TEST_CASE("Profile: Short move does not reach cruise speed")
+{
+    mgo::MotionLimits limits { 10'000.0, 20'000.0, 200'000.0 };
+    mgo::MotionProfile profile(100, 5'000.0, limits);
+    REQUIRE(profile.peakStepsPerSecond() < 5'000.0);
+    REQUIRE(profile.rampLength() * 2 <= 100);
+}
+
+TEST_CASE("Profile: Cruise speed is limited")
+{
+    mgo::MotionLimits limits { 1'000.0, 20'000.0, 200'000.0 };
+    mgo::MotionProfile profile(10'000, 5'000.0, limits);
+    REQUIRE(profile.peakStepsPerSecond() == Approx(1'000.0));
+    REQUIRE(profile.cruiseDelay() == 1'000);
+}
+
+TEST_CASE("Profile: No acceleration means no ramp")
+{
+    mgo::MotionLimits limits { 10'000.0, 0.0, 0.0 };
+    mgo::MotionProfile profile(mgo::MotionProfile::UNBOUNDED, 5'000.0, limits);
+    REQUIRE(profile.rampLength() == 0);
+    REQUIRE(profile.delayForStep(0) == 200);
+}
+
+TEST_CASE("Motor:   Ramped move reaches target")
+{
+    mgo::MockConfigReader config;
+    mgo::MockGpio gpio(false, config);
+    mgo::MotionLimits limits { 0.0, 50'000.0, 1'000'000.0 };
+    mgo::MotionController motion(gpio);
+    mgo::Motor& motor = motion.addMotor(0, 0, 1'000, 1.0, 1'000.0, limits);
+    motor.setRpm(600.0);
+    motor.goToStep(2'000);
+    motor.wait();
+    REQUIRE(motor.getCurrentStep() == 2'000);
+    motor.goToStep(-500);
+    motor.wait();
+    REQUIRE(motor.getCurrentStep() == -500);
+}
+
+TEST_CASE("Motor:   Stop decelerates an unbounded move")
+{
+    mgo::MockConfigReader config;
+    mgo::MockGpio gpio(false, config);
+    mgo::MotionLimits limits { 0.0, 50'000.0, 1'000'000.0 };
+    mgo::MotionController motion(gpio);
+    mgo::Motor& motor = motion.addMotor(0, 0, 1'000, 1.0, 1'000.0, limits);
+    motor.setRpm(600.0);
+    motor.goToStep(mgo::INF_LEFT);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    REQUIRE(motor.isRunning());
+    motor.stop();
+    motor.wait();
+    REQUIRE(!motor.isRunning());
+    REQUIRE(motor.getCurrentStep() > 0);
+}
+
+TEST_CASE("Motor:   Backlash compensation")
+{
+    mgo::MockConfigReader config;
+    mgo::MockGpio gpio(false, config);
+    mgo::MotionController motion(gpio);
+    mgo::Motor& motor = motion.addMotor(0, 0, 1'000, 1.0, 1'000.0, mgo::MotionLimits {});
+    motor.setRpm(600.0);
+    motor.setBacklashCompensation(10, 0);
+    motor.goToStep(1);
+    motor.wait();
+    REQUIRE(motor.getCurrentStep() == 1);
+    REQUIRE(motor.getCurrentStepWithoutBacklashCompensation() == 11);
+    motor.goToStep(0);
+    motor.wait();
+    REQUIRE(motor.getCurrentStep() == 0);
+    REQUIRE(motor.getCurrentStepWithoutBacklashCompensation() == 0);
+}
+
+TEST_CASE("Motor:   Independent moves on two axes")
+{
+    mgo::MockConfigReader config;
+    mgo::MockGpio gpio(false, config);
+    mgo::MotionController motion(gpio);
+    mgo::MotionLimits limits { 0.0, 50'000.0, 1'000'000.0 };
+    mgo::Motor& motor1 = motion.addMotor(0, 0, 1'000, 1.0, 1'000.0, limits);
+    mgo::Motor& motor2 = motion.addMotor(1, 1, 1'000, 1.0, 1'000.0, limits);
+    motor1.setRpm(600.0);
+    motor2.setRpm(60.0);
+    motor2.goToStep(-20);
+    motor1.goToStep(1'000);
+    motor1.wait();
+    REQUIRE(motor1.getCurrentStep() == 1'000);
+    motor2.wait();
+    REQUIRE(motor2.getCurrentStep() == -20);
+}
+
+TEST_CASE("Motor:   Coordinated move arrives together")
+{
+    mgo::MockConfigReader config;
+    mgo::MockGpio gpio(false, config);
+    mgo::MotionController motion(gpio);
+    mgo::MotionLimits limits { 0.0, 50'000.0, 1'000'000.0 };
+    mgo::Motor& motor1 = motion.addMotor(0, 0, 1'000, 1.0, 1'000.0, limits);
+    mgo::Motor& motor2 = motion.addMotor(1, 1, 1'000, 1.0, 1'000.0, limits);
+    motor1.setRpm(600.0);
+    motion.moveLinear({ { &motor1, 1'000 }, { &motor2, -300 } });
+    REQUIRE(motor1.isRunning());
+    REQUIRE(motor2.isRunning());
+    while (motor1.getCurrentStep() < 500) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    // Half way along axis1 means (about) half way along axis2
+    REQUIRE(std::abs(motor2.getCurrentStep() + 150) <= 2);
+    motor1.wait();
+    REQUIRE(!motor2.isRunning());
+    REQUIRE(motor1.getCurrentStep() == 1'000);
+    REQUIRE(motor2.getCurrentStep() == -300);
+}
+
+TEST_CASE("Motor:   Follower steps with its master")
+{
+    mgo::MockConfigReader config;
+    mgo::MockGpio gpio(false, config);
+    mgo::MotionController motion(gpio);
+    mgo::Motor& motor1 = motion.addMotor(0, 0, 1'000, 0.01, 1'000.0, mgo::MotionLimits {});
+    mgo::Motor& motor2 = motion.addMotor(1, 1, 1'000, 0.01, 1'000.0, mgo::MotionLimits {});
+    motor1.setRpm(300.0);
+    motor2.synchroniseOn(&motor1, [](double delta, double) {
+        return delta * 0.5;
+    });
+    motor1.goToStep(400);
+    while (motor1.isRunning()) {
+        REQUIRE(std::abs(motor1.getCurrentStep() / 2 - motor2.getCurrentStep()) <= 1);
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    REQUIRE(motor2.getCurrentStep() == 200);
+    motor2.synchroniseOff();
+}
+
+TEST_CASE("Motor:   Follower catches up no faster than its limit")
+{
+    mgo::MockConfigReader config;
+    mgo::MockGpio gpio(false, config);
+    mgo::MotionController motion(gpio);
+    mgo::MotionLimits followerLimits;
+    followerLimits.maxStepsPerSecond = 2'000.0;
+    mgo::Motor& motor1 = motion.addMotor(0, 0, 1'000, 0.01, 1'000.0, mgo::MotionLimits {});
+    mgo::Motor& motor2 = motion.addMotor(1, 1, 1'000, 0.01, 1'000.0, followerLimits);
+    motor1.setRpm(300.0);
+    // Ten of the follower's steps for each of the master's
+    motor2.synchroniseOn(&motor1, [](double delta, double) {
+        return delta * 10.0;
+    });
+    const auto start = std::chrono::steady_clock::now();
+    motor1.goToStep(100);
+    motor1.wait();
+    // The master isn't held up by the follower's steps
+    REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(250));
+    while (motor2.getCurrentStep() != 1'000
+           && std::chrono::steady_clock::now() - start < std::chrono::seconds(5)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    REQUIRE(motor2.getCurrentStep() == 1'000);
+    REQUIRE(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(490));
+    motor2.synchroniseOff();
+}
+
+TEST_CASE("Motor:   Queued moves run back to back")
+{
+    mgo::MockConfigReader config;
+    mgo::MockGpio gpio(false, config);
+    mgo::MotionController motion(gpio);
+    mgo::MotionLimits limits { 0.0, 50'000.0, 1'000'000.0 };
+    mgo::Motor& motor1 = motion.addMotor(0, 0, 1'000, 1.0, 1'000.0, limits);
+    mgo::Motor& motor2 = motion.addMotor(1, 1, 1'000, 1.0, 1'000.0, limits);
+    motor1.setRpm(600.0);
+    motor2.setRpm(600.0);
+    REQUIRE(motion.queueMove({ { &motor1, 200 } }));
+    REQUIRE(motion.queueMove({ { &motor2, -100 } }));
+    REQUIRE(motion.queueMove({ { &motor1, 0 }, { &motor2, 0 } }));
+    // Later moves are planned from where earlier ones will finish
+    REQUIRE(motor1.getPlannedStep() == 0);
+    REQUIRE(motor2.hasQueuedMoves());
+    // Neither motor should ever look idle until the last move is done
+    while (motor1.getCurrentStep() != 200) {
+        REQUIRE(motor1.isRunning());
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    while (motor1.isRunning() || motor2.isRunning()) {
+        REQUIRE(motor2.isRunning());
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    REQUIRE(motor1.getCurrentStep() == 0);
+    REQUIRE(motor2.getCurrentStep() == 0);
+    REQUIRE(!motor2.hasQueuedMoves());
+}
+
+TEST_CASE("Motor:   Stop abandons queued moves")
+{
+    mgo::MockConfigReader config;
+    mgo::MockGpio gpio(false, config);
+    mgo::MotionController motion(gpio);
+    mgo::MotionLimits limits { 0.0, 50'000.0, 1'000'000.0 };
+    mgo::Motor& motor = motion.addMotor(0, 0, 1'000, 1.0, 1'000.0, limits);
+    motor.setRpm(600.0);
+    motion.queueMove({ { &motor, 10'000 } });
+    motion.queueMove({ { &motor, 20'000 } });
+    while (motor.getCurrentStep() < 100) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    motor.stop();
+    motor.wait();
+    REQUIRE(!motor.hasQueuedMoves());
+    REQUIRE(motor.getCurrentStep() < 10'000);
+    REQUIRE(motor.getPlannedStep() == motor.getCurrentStep());
+}
+
+TEST_CASE("Motor:   Armed move waits for its start tick")
+{
+    mgo::MockConfigReader config;
+    mgo::MockGpio gpio(false, config);
+    mgo::MotionController motion(gpio);
+    mgo::MotionLimits limits { 0.0, 0.0, 0.0 };
+    mgo::Motor& motor = motion.addMotor(0, 0, 1'000, 1.0, 1'000.0, limits);
+    motor.setRpm(600.0);
+    const uint32_t start = gpio.getTick() + 50'000;
+    motor.goToStepAt(100, start);
+    REQUIRE(motor.isRunning());
+    std::this_thread::sleep_for(std::chrono::milliseconds(25));
+    REQUIRE(motor.getCurrentStep() == 0);
+    while (motor.getCurrentStep() == 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    // The first step is at the start tick (plus one step's delay)
+    REQUIRE(static_cast<int32_t>(gpio.getTick() - start) >= 0);
+    motor.wait();
+    REQUIRE(motor.getCurrentStep() == 100);
+    // Stopping an armed move cancels it straight away
+    motor.goToStepAt(200, gpio.getTick() + 10'000'000);
+    motor.stop();
+    motor.wait();
+    REQUIRE(motor.getCurrentStep() == 100);
+}
+
+TEST_CASE("Motor:   Target can be moved during a move")
+{
+    mgo::MockConfigReader config;
+    mgo::MockGpio gpio(false, config);
+    mgo::MotionController motion(gpio);
+    mgo::MotionLimits limits { 0.0, 50'000.0, 1'000'000.0 };
+    mgo::Motor& motor = motion.addMotor(0, 0, 1'000, 1.0, 1'000.0, limits);
+    motor.setRpm(300.0);
+    motor.goToStep(4'000);
+    while (motor.getCurrentStep() < 100) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    motor.setTargetStep(4'500);
+    motor.wait();
+    REQUIRE(motor.getCurrentStep() == 4'500);
+    REQUIRE(motor.getTargetStep() == 4'500);
+    // Shortening a move works too, but never as far as reversing it
+    motor.goToStep(0);
+    while (motor.getCurrentStep() > 4'400) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    motor.setTargetStep(5'000);
+    motor.wait();
+    REQUIRE(motor.getTargetStep() == motor.getCurrentStep());
+    REQUIRE(motor.getCurrentStep() < 4'400);
+    REQUIRE(motor.getCurrentStep() > 3'000);
+}
+
+TEST_CASE("Queue:   Wraps around and reports full")
+{
+    mgo::SpscQueue<int, 4> queue;
+    REQUIRE(queue.empty());
+    REQUIRE(queue.front() == nullptr);
+    for (int n = 0; n < 10; ++n) {
+        REQUIRE(queue.push(int { n }));
+        REQUIRE(*queue.front() == n);
+        queue.pop();
+    }
+    for (int n = 0; n < 4; ++n) {
+        REQUIRE(queue.push(int { n }));
+    }
+    REQUIRE(!queue.push(99));
+    REQUIRE(queue.size() == 4);
+    REQUIRE(*queue.front() == 0);
+}
+
+TEST_CASE("SeqLock: Readers never see a torn value")
+{
+    struct Value {
+        uint64_t a;
+        uint32_t b;
+        float c;
+    };
+    mgo::SeqLock<Value> published;
+    std::atomic<bool> done { false };
+    std::thread writer([&]() {
+        for (uint64_t n = 1; n <= 200'000; ++n) {
+            published.store({ n, static_cast<uint32_t>(n * 3), static_cast<float>(n % 1'000) });
+        }
+        done = true;
+    });
+    long torn = 0;
+    uint64_t last = 0;
+    while (!done) {
+        const Value value = published.load();
+        if (value.b != static_cast<uint32_t>(value.a * 3)
+            || value.c != static_cast<float>(value.a % 1'000) || value.a < last) {
+            ++torn;
+        }
+        last = value.a;
+    }
+    writer.join();
+    REQUIRE(torn == 0);
+    REQUIRE(published.load().a == 200'000);
+}
+
+TEST_CASE("Triple:  Reader gets whole values, newest last")
+{
+    mgo::TripleBuffer<std::vector<uint64_t>> buffer;
+    REQUIRE(!buffer.update());
+    std::atomic<bool> done { false };
+    std::thread writer([&]() {
+        for (uint64_t n = 1; n <= 100'000; ++n) {
+            buffer.writeBuffer().assign(8, n);
+            buffer.publish();
+        }
+        done = true;
+    });
+    long torn = 0;
+    uint64_t last = 0;
+    for (;;) {
+        const bool finished = done;
+        if (buffer.update()) {
+            const auto& value = buffer.readBuffer();
+            if (value.size() != 8 || value.front() != value.back() || value.front() <= last) {
+                ++torn;
+            }
+            last = value.front();
+        }
+        if (finished) {
+            break;
+        }
+    }
+    writer.join();
+    REQUIRE(torn == 0);
+    REQUIRE(last == 100'000);
+    REQUIRE(!buffer.update());
+}
+
+TEST_CASE("Wakeup:  Notifications wake a waiter, once")
+{
+    mgo::Wakeup wakeup;
+    REQUIRE(!wakeup.wait(std::chrono::milliseconds(0)));
+    wakeup.notify();
+    wakeup.notify();
+    REQUIRE(wakeup.wait(std::chrono::milliseconds(0)));
+    REQUIRE(!wakeup.wait(std::chrono::milliseconds(0)));
+
+    std::thread notifier([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        wakeup.notify();
+    });
+    const auto start = std::chrono::steady_clock::now();
+    REQUIRE(wakeup.wait(std::chrono::milliseconds(5'000)));
+    REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(1'000));
+    notifier.join();
+}
+
+TEST_CASE("Wakeup:  Motors starting and stopping wake the control loop")
+{
+    mgo::MockConfigReader config;
+    mgo::MockGpio gpio(false, config);
+    mgo::Model model(gpio, config);
+    model.initialise();
+    model.wakeup().wait(std::chrono::milliseconds(0));
+    model.axis1SetSpeed(200.0);
+    model.axis1GoToPosition(-1.0);
+    REQUIRE(model.wakeup().wait(std::chrono::milliseconds(1'000)));
+    model.axis1Wait();
+    REQUIRE(model.wakeup().wait(std::chrono::milliseconds(1'000)));
+    REQUIRE(!model.wakeup().wait(std::chrono::milliseconds(0)));
+}
+
+TEST_CASE("RPM:     Estimates follow a change of speed within the window")
+{
+    mgo::RpmWindow window;
+    window.pulses = 50;
+    window.microseconds = 1'000'000;
+    window.fastPulses = 4;
+    mgo::RpmEstimator estimator(window);
+    REQUIRE(estimator.fastInterval() == 0.f);
+    for (int n = 0; n < 200; ++n) {
+        estimator.addInterval(100);
+    }
+    REQUIRE(estimator.fastInterval() == 100.f);
+    REQUIRE(estimator.smoothedInterval() == 100.f);
+    // The spindle slows to half speed
+    for (int n = 0; n < 4; ++n) {
+        estimator.addInterval(200);
+    }
+    REQUIRE(estimator.fastInterval() == 200.f);
+    REQUIRE(estimator.smoothedInterval() == Approx(108.0));
+    for (int n = 0; n < 46; ++n) {
+        estimator.addInterval(200);
+    }
+    REQUIRE(estimator.smoothedInterval() == 200.f);
+}
+
+TEST_CASE("RPM:     Window is limited by time, and restarts after a stop")
+{
+    mgo::RpmWindow window;
+    window.pulses = 1'000;
+    window.microseconds = 10'000;
+    mgo::RpmEstimator estimator(window);
+    for (int n = 0; n < 1'000; ++n) {
+        estimator.addInterval(n < 900 ? 50 : 100);
+    }
+    // Only the last 10 ms (i.e. the last 100 intervals) count
+    REQUIRE(estimator.smoothedInterval() == 100.f);
+    estimator.addInterval(mgo::RpmEstimator::MAX_INTERVAL_MICROSECONDS + 1);
+    REQUIRE(estimator.smoothedInterval() == 0.f);
+    REQUIRE(estimator.fastInterval() == 0.f);
+    estimator.addInterval(300);
+    REQUIRE(estimator.smoothedInterval() == 300.f);
+}
+
+namespace {
+
+// Stands in for a GPIO library which delivers the encoder's edges in batches,
+// at whatever time the test says it is
+struct EncoderGpio : mgo::MockGpio, mgo::IGpioEdgeBatches {
+    using MockGpio::MockGpio;
+    void setEdgeBatchCallback(int, int, mgo::GpioEdgeBatchCallback cb, void* user) override
+    {
+        callback = cb;
+        userData = user;
+    }
+    void removeEdgeBatchCallback(void*) override
+    {
+        callback = nullptr;
+    }
+    uint32_t getTick() override
+    {
+        return tick;
+    }
+    void deliver(const std::vector<mgo::GpioEdge>& edges)
+    {
+        if (!edges.empty() && callback != nullptr) {
+            tick = edges.back().tick + 1'000; // the batch arrives a bit late
+            callback(edges.data(), edges.size(), userData);
+        }
+    }
+    mgo::GpioEdgeBatchCallback callback { nullptr };
+    void* userData { nullptr };
+    uint32_t tick { 0 };
+};
+
+// The edges of one pulse, turning in the normal direction (A rises while B
+// is high), starting at "tick" and lasting "microseconds"
+void addPulse(std::vector<mgo::GpioEdge>& edges, uint32_t tick, uint32_t microseconds)
+{
+    edges.push_back({ 24, 1, tick });
+    edges.push_back({ 23, 1, tick + microseconds / 4 });
+    edges.push_back({ 24, 0, tick + microseconds / 2 });
+    edges.push_back({ 23, 0, tick + microseconds * 3 / 4 });
+}
+
+} // end anonymous namespace
+
+TEST_CASE("Encoder: Glitches are rejected and counted")
+{
+    mgo::MockConfigReader config;
+    mgo::EncoderFilter filter;
+    filter.minEdgeMicroseconds = 2;
+    EncoderGpio filteredGpio(false, config);
+    EncoderGpio unfilteredGpio(false, config);
+    EncoderGpio oneByOneGpio(false, config);
+    mgo::RotaryEncoder filtered(filteredGpio, 23, 24, 700, 1.f, {}, filter);
+    mgo::RotaryEncoder unfiltered(unfilteredGpio, 23, 24, 700, 1.f);
+    mgo::RotaryEncoder oneByOne(oneByOneGpio, 23, 24, 700, 1.f, {}, filter);
+    std::vector<mgo::GpioEdge> edges;
+    uint32_t tick = 0;
+    for (int n = 0; n < 101; ++n) {
+        addPulse(edges, tick, 400);
+        if (n % 10 == 5) {
+            // A spike on A while it's low, which looks like an extra pulse
+            edges.push_back({ 23, 1, tick + 350 });
+            edges.push_back({ 23, 0, tick + 351 });
+            // Contact bounce as B rises
+            edges.push_back({ 24, 1, tick + 400 });
+            edges.push_back({ 24, 0, tick + 400 });
+            tick += 1;
+        }
+        tick += 400;
+    }
+    filteredGpio.deliver(edges);
+    unfilteredGpio.deliver(edges);
+    // As a GPIO library without batches would call us, so no glitch is
+    // ever seen whole within a call
+    for (const auto& edge : edges) {
+        oneByOneGpio.tick = edge.tick;
+        oneByOne.callback(edge.pin, edge.level, edge.tick);
+    }
+    // The first pulse only warms up the encoder
+    REQUIRE(filtered.getState().pulseCount == 700 - 100);
+    REQUIRE(filtered.getRejectedEdges() == 10 * 4);
+    REQUIRE(unfiltered.getRejectedEdges() == 0);
+    REQUIRE(oneByOne.getState().pulseCount == 700 - 100);
+    REQUIRE(oneByOne.getRejectedEdges() == 10 * 4);
+}
+
+TEST_CASE("Encoder: The filter lets go of the last edges once the spindle stops")
+{
+    mgo::MockConfigReader config;
+    mgo::EncoderFilter filter;
+    filter.minEdgeMicroseconds = 2;
+    EncoderGpio gpio(false, config);
+    mgo::RotaryEncoder re(gpio, 23, 24, 700, 1.f, {}, filter);
+    std::vector<mgo::GpioEdge> edges;
+    for (uint32_t n = 0; n < 10; ++n) {
+        addPulse(edges, n * 400, 400);
+    }
+    // The spindle stops just as A rises, which counts a pulse
+    edges.push_back({ 24, 1, 4'000 });
+    edges.push_back({ 23, 1, 4'100 });
+    gpio.deliver(edges);
+    const uint32_t pulseCount = re.getState().pulseCount;
+    // Nothing has come after the last edge yet, but something still could
+    re.releaseHeldEdges();
+    REQUIRE(re.getState().pulseCount == pulseCount);
+    gpio.tick = 4'100 + 10'000;
+    re.releaseHeldEdges();
+    REQUIRE(re.getState().pulseCount == pulseCount - 1);
+    REQUIRE(re.getRejectedEdges() == 0);
+}
+
+TEST_CASE("Encoder: Mock spindle run up to 5,000 rpm")
+{
+    mgo::MockConfigReader config;
+    mgo::EncoderFilter filter;
+    filter.minEdgeMicroseconds = 2;
+    filter.highSpeedRpm = 1'000.f;
+    filter.decimation = 4;
+    EncoderGpio gpio(false, config);
+    constexpr int PULSES_PER_REV = 700;
+    mgo::RotaryEncoder re(gpio, 23, 24, PULSES_PER_REV, 1.f, {}, filter);
+    struct Stage {
+        double rpm; // ramped to, then held
+        bool highSpeed; // expected once held
+    };
+    const std::vector<Stage> stages {
+        { 300.0, false }, { 1'200.0, true }, { 3'000.0, true }, { 4'950.0, true },
+        { 900.0, true },  { 700.0, false },  { 300.0, false }
+    };
+    double rpm = 0.0;
+    double time = 0.0; // microseconds
+    uint32_t glitches = 0;
+    std::vector<mgo::GpioEdge> batch;
+    for (const auto& stage : stages) {
+        const double from = std::max(rpm, 100.0);
+        // A quarter of a second of ramping, then a quarter at speed
+        const double stageStart = time;
+        while (time - stageStart < 500'000.0) {
+            const double ramp = std::min((time - stageStart) / 250'000.0, 1.0);
+            rpm = from + (stage.rpm - from) * ramp;
+            const double pulse = 60'000'000.0 / (rpm * PULSES_PER_REV);
+            // Timestamps have the resolution of pigpio's default 5 us sampling
+            const auto sampled = [](double t) {
+                return static_cast<uint32_t>(t / 5.0) * 5;
+            };
+            batch.push_back({ 24, 1, sampled(time) });
+            batch.push_back({ 23, 1, sampled(time + pulse / 4) });
+            batch.push_back({ 24, 0, sampled(time + pulse / 2) });
+            batch.push_back({ 23, 0, sampled(time + pulse * 3 / 4) });
+            if (static_cast<uint32_t>(time) % 97 == 0) {
+                // Noise on A while it's low
+                batch.push_back({ 23, 1, sampled(time + pulse * 7 / 8) });
+                batch.push_back({ 23, 0, sampled(time + pulse * 7 / 8) });
+                ++glitches;
+            }
+            time += pulse;
+            // The GPIO library delivers a millisecond's worth at a time
+            if (batch.back().tick - batch.front().tick >= 1'000) {
+                gpio.deliver(batch);
+                batch.clear();
+            }
+        }
+        gpio.deliver(batch);
+        batch.clear();
+        INFO("At " << stage.rpm << " rpm");
+        REQUIRE(re.getRpm() == Approx(stage.rpm).epsilon(0.01));
+        REQUIRE(re.getFastRpm() == Approx(stage.rpm).epsilon(0.05));
+        REQUIRE(re.getState().highSpeed == stage.highSpeed);
+    }
+    REQUIRE(glitches > 0);
+    REQUIRE(re.getRejectedEdges() == glitches * 2);
+}
+
+TEST_CASE("Gearing: Ratios are represented exactly")
+{
+    auto ratio = mgo::approximateRatio(3.0 / 7.0);
+    REQUIRE(ratio.numerator == 3);
+    REQUIRE(ratio.denominator == 7);
+    ratio = mgo::approximateRatio(1.25);
+    REQUIRE(ratio.numerator == 5);
+    REQUIRE(ratio.denominator == 4);
+    // 19 TPI on a 1 mm leadscrew with 1,000 steps per rev and 700 pulses per rev
+    ratio = mgo::approximateRatio(25.4 / 19.0 * 1'000.0 / 700.0);
+    REQUIRE(ratio.numerator == 254);
+    REQUIRE(ratio.denominator == 133);
+    ratio = mgo::approximateRatio(4.0);
+    REQUIRE(ratio.numerator == 4);
+    REQUIRE(ratio.denominator == 1);
+}
+
+TEST_CASE("Gearing: Steps follow encoder pulses without drift")
+{
+    mgo::ElectronicLeadscrew leadscrew(0);
+    leadscrew.setRatio({ 3, 7 });
+    leadscrew.pulse(true, 0);
+    REQUIRE(leadscrew.nextStep() == nullptr); // not engaged yet
+    leadscrew.engage();
+    uint32_t tick = 0;
+    uint32_t lastStepTick = 0;
+    long steps = 0;
+    auto drain = [&](bool forward) {
+        while (const auto* step = leadscrew.nextStep()) {
+            REQUIRE(step->forward == forward);
+            // Steps are spread between the pulses that cause them
+            REQUIRE(step->tick >= lastStepTick);
+            REQUIRE(step->tick <= tick);
+            lastStepTick = step->tick;
+            steps += forward ? 1 : -1;
+            leadscrew.popStep();
+        }
+    };
+    for (int n = 0; n < 7'000; ++n) {
+        tick += 100;
+        leadscrew.pulse(true, tick);
+        drain(true);
+    }
+    REQUIRE(steps == 3'000);
+    for (int n = 0; n < 700; ++n) {
+        tick += 100;
+        leadscrew.pulse(false, tick);
+        drain(false);
+    }
+    REQUIRE(steps == 2'700);
+    REQUIRE(leadscrew.getOverruns() == 0);
+}
+
+TEST_CASE("Motor:   Geared move follows the spindle")
+{
+    mgo::MockConfigReader config;
+    mgo::MockGpio gpio(false, config);
+    mgo::MotionController motion(gpio);
+    mgo::Motor& motor = motion.addMotor(0, 0, 1'000, 0.01, 1'000.0, mgo::MotionLimits {});
+    mgo::ElectronicLeadscrew leadscrew(500);
+    leadscrew.setRatio({ 1, 2 });
+    motor.setLeadscrew(&leadscrew);
+    REQUIRE(motor.isGeared());
+    motor.goToStep(-100);
+    while (!leadscrew.isEngaged()) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    auto turnSpindle = [&](int pulses) {
+        for (int n = 0; n < pulses; ++n) {
+            leadscrew.pulse(true, gpio.getTick());
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    };
+    turnSpindle(100);
+    // The motor stays exactly in step with the spindle, even when it stops
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    REQUIRE(motor.getCurrentStep() == -50);
+    REQUIRE(motor.isRunning());
+    turnSpindle(100);
+    motor.wait();
+    REQUIRE(motor.getCurrentStep() == -100);
+    REQUIRE(!leadscrew.isEngaged());
+    motor.setLeadscrew(nullptr);
+}
+
+TEST_CASE("Timing:  Buckets cover every value")
+{
+    for (uint32_t value = 0; value < 10'000'000; value += 1 + value / 50) {
+        const auto bucket = mgo::StepTimingStats::bucketFor(value);
+        const auto lower = mgo::StepTimingStats::bucketLowerBound(bucket);
+        REQUIRE(lower <= value);
+        REQUIRE(value < mgo::StepTimingStats::bucketLowerBound(bucket + 1));
+        // Accurate to within one sixteenth
+        REQUIRE(value - lower <= value / 16);
+    }
+}
+
+TEST_CASE("Timing:  Percentiles and late steps")
+{
+    mgo::StepTimingStats stats;
+    stats.setLateThresholdMicroseconds(100);
+    for (int n = 0; n < 990; ++n) {
+        stats.record(10);
+    }
+    for (int n = 0; n < 10; ++n) {
+        stats.record(1'000);
+    }
+    const auto first = stats.snapshot();
+    REQUIRE(first.count == 1'000);
+    REQUIRE(first.percentile(0.5) == 10);
+    REQUIRE(first.percentile(0.99) == 10);
+    REQUIRE(first.percentile(1.0) == 1'000);
+    REQUIRE(first.maxMicroseconds == 1'000);
+    REQUIRE(first.lateCount == 10);
+    for (int n = 0; n < 5; ++n) {
+        stats.record(500);
+    }
+    const auto recent = stats.snapshot().since(first);
+    REQUIRE(recent.count == 5);
+    REQUIRE(recent.lateCount == 5);
+    REQUIRE(recent.percentile(0.5) >= 500);
+    REQUIRE(recent.percentile(0.5) <= 500 + 500 / 16);
+}
+
+TEST_CASE("Motor:   Step timing is recorded")
+{
+    mgo::MockConfigReader config;
+    mgo::MockGpio gpio(false, config);
+    mgo::MotionController motion(gpio);
+    mgo::Motor& motor = motion.addMotor(0, 0, 1'000, 1.0, 1'000.0, mgo::MotionLimits {});
+    motor.setRpm(600.0);
+    motor.goToStep(200);
+    motor.wait();
+    REQUIRE(motion.stepTiming().snapshot().count == 200);
+}
+
+TEST_CASE("Thread:  Placement is read back from the thread")
+{
+    mgo::MockConfigReader config;
+    auto placement = mgo::readThreadPlacement(config, "MotionThread");
+    REQUIRE(placement.cpu == -1);
+    REQUIRE(placement.priority == 0);
+    placement.cpu = 0;
+    std::atomic<bool> done { false };
+    std::thread thread([&]() {
+        while (!done) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+    const auto result = mgo::placeThread(thread.native_handle(), placement);
+    done = true;
+    thread.join();
+    REQUIRE(result.pinned);
+    REQUIRE(result.describe("Test").find("pinned to CPU 0") != std::string::npos);
+    // Real-time scheduling may not be allowed, but we must report it honestly
+    REQUIRE(result.ok() == result.realTime);
+}
+
+TEST_CASE("Thread:  Deferred placement applies to the calling thread")
+{
+    mgo::DeferredPlacement deferred;
+    deferred.apply(); // nothing requested yet
+    REQUIRE(!deferred.result().has_value());
+    deferred.request({ 0, 0 });
+    REQUIRE(!deferred.result().has_value());
+    std::thread thread([&]() {
+        deferred.apply();
+    });
+    thread.join();
+    REQUIRE(deferred.result().has_value());
+    REQUIRE(deferred.result()->pinned);
+}
+
 TEST_CASE("Model:   check tapering")
 {
     mgo::MockConfigReader config;
@@ -303,6 +1171,315 @@ TEST_CASE("Model:   check radius")
     REQUIRE(pos < 0.05);
 }
 
+TEST_CASE("Model:   Nudges which can't be queued are reported")
+{
+    mgo::MockConfigReader config;
+    mgo::MockGpio gpio(false, config);
+    mgo::Model model(gpio, config);
+    model.initialise();
+    for (std::size_t n = 0; n < mgo::MAX_QUEUED_SEGMENTS + 2; ++n) {
+        model.axis1Nudge(mgo::ZDirection::Left, 1.0);
+    }
+    REQUIRE(model.getWarning() == "Too many nudges queued, nudge ignored");
+    model.stopAllMotors();
+    model.axis1Nudge(mgo::ZDirection::Right, 0.1);
+    REQUIRE(model.getWarning().empty());
+    model.stopAllMotors();
+}
+
+TEST_CASE("Display: Snapshots only differ when the display would")
+{
+    mgo::MockConfigReader config;
+    mgo::MockGpio gpio(false, config);
+    mgo::Model model(gpio, config);
+    model.initialise();
+    const mgo::DisplaySnapshot first = mgo::takeDisplaySnapshot(model);
+    REQUIRE(mgo::takeDisplaySnapshot(model) == first);
+    REQUIRE(mgo::formatHundredths(first.axis1Position, 8) == "    0.00");
+    REQUIRE(first.axis1Memory.size() == model.getMemorySize());
+    REQUIRE_FALSE(first.axis1Memory.at(0).has_value());
+
+    model.axis1SetSpeed(200.0);
+    model.axis1GoToPosition(-0.5);
+    model.axis1Wait();
+    const mgo::DisplaySnapshot moved = mgo::takeDisplaySnapshot(model);
+    REQUIRE(moved != first);
+    REQUIRE(mgo::formatHundredths(moved.axis1Position, 8) == "   -0.50");
+    REQUIRE(mgo::takeDisplaySnapshot(model) == moved);
+
+    model.changeMode(mgo::Mode::Taper);
+    model.setTaperAngle(2.5);
+    const mgo::DisplaySnapshot taper = mgo::takeDisplaySnapshot(model);
+    REQUIRE(taper.enabledFunction == mgo::Mode::Taper);
+    REQUIRE(taper.taperAngle == 2.5);
+    REQUIRE(taper.axis1Position == moved.axis1Position);
+}
+
+TEST_CASE("History: Samples are read in order, and only while they're kept")
+{
+    mgo::History history;
+    std::vector<mgo::HistorySample> samples;
+    const auto sample = [](float value) {
+        mgo::HistorySample s;
+        s.fill(value);
+        return s;
+    };
+    for (int n = 0; n < 10; ++n) {
+        history.record(sample(n));
+    }
+    REQUIRE(history.read(0, samples) == 10);
+    REQUIRE(samples.size() == 10);
+    REQUIRE(samples.back()[static_cast<std::size_t>(mgo::HistoryChannel::Axis2Position)] == 9.f);
+    REQUIRE(history.read(10, samples) == 10);
+    REQUIRE(samples.size() == 10);
+
+    // More than the ring holds, so the first of these are lost
+    for (std::size_t n = 0; n < mgo::HISTORY_SAMPLES + 5; ++n) {
+        history.record(sample(10 + n));
+    }
+    samples.clear();
+    REQUIRE(history.read(10, samples) == mgo::HISTORY_SAMPLES + 15);
+    REQUIRE(samples.size() == mgo::HISTORY_SAMPLES - 1);
+    REQUIRE(samples.front()[0] == 16.f);
+    REQUIRE(samples.back()[0] == mgo::HISTORY_SAMPLES + 14.f);
+}
+
+TEST_CASE("History: Samples are taken by a thread of their own")
+{
+    mgo::MockConfigReader config;
+    mgo::MockGpio gpio(false, config);
+    mgo::Model model(gpio, config);
+    model.initialise();
+    REQUIRE(model.getHistory().getPeriod() == std::chrono::milliseconds(20));
+
+    mgo::History history;
+    history.start(std::chrono::milliseconds(1), []() { return mgo::HistorySample { 1.f }; });
+    const auto start = std::chrono::steady_clock::now();
+    while (history.getCount() < 5
+           && std::chrono::steady_clock::now() - start < std::chrono::seconds(5)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::vector<mgo::HistorySample> samples;
+    REQUIRE(history.read(0, samples) >= 5);
+    REQUIRE(samples.front()[static_cast<std::size_t>(mgo::HistoryChannel::Rpm)] == 1.f);
+
+    // Once stopped, nothing more is sampled (the motors may be gone)
+    history.stop();
+    const std::size_t count = history.getCount();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    REQUIRE(history.getCount() == count);
+
+    // The model stops its own sampling before the motors are torn down
+    model.resetMotorThreads();
+    const std::size_t modelCount = model.getHistory().getCount();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    REQUIRE(model.getHistory().getCount() == modelCount);
+}
+
+TEST_CASE("Path:    Toolpaths are planned as the model will cut them")
+{
+    mgo::DisplaySnapshot snapshot;
+    snapshot.axis1Memory = { 0, -1'000, std::nullopt };
+    snapshot.axis2Memory = { 500, 400, std::nullopt };
+    REQUIRE(mgo::planToolpath(snapshot).empty());
+
+    snapshot.enabledFunction = mgo::Mode::MultiPass;
+    snapshot.stepOver = 0.3;
+    auto path = mgo::planToolpath(snapshot);
+    // Cuts at 5.0, 4.7, 4.4, 4.1 and 4.0, with a return and a step-over
+    // between each
+    REQUIRE(path.size() == 13);
+    REQUIRE(path.front().cutting);
+    REQUIRE(path.front().from == mgo::ToolpathPoint { 0.0, 5.0 });
+    REQUIRE(path.front().to == mgo::ToolpathPoint { -10.0, 5.0 });
+    REQUIRE_FALSE(path.at(1).cutting);
+    REQUIRE(path.back().cutting);
+    REQUIRE(path.back().from.axis2 == Approx(4.0));
+    snapshot.stepOver = 0.0;
+    REQUIRE(mgo::planToolpath(snapshot).size() == 1);
+    snapshot.axis2Memory.at(1) = std::nullopt;
+    REQUIRE(mgo::planToolpath(snapshot).empty());
+
+    // Unset memories count as zero
+    snapshot.enabledFunction = mgo::Mode::Taper;
+    snapshot.taperAngle = 45.0;
+    snapshot.axis1Memory.at(0) = std::nullopt;
+    snapshot.axis2Memory.at(0) = std::nullopt;
+    path = mgo::planToolpath(snapshot);
+    REQUIRE(path.size() == 1);
+    REQUIRE(path.front().from == mgo::ToolpathPoint {});
+    REQUIRE(path.front().to.axis1 == -10.0);
+    REQUIRE(path.front().to.axis2 == Approx(-10.0));
+
+    snapshot.enabledFunction = mgo::Mode::Radius;
+    snapshot.radius = 2.0;
+    path = mgo::planToolpath(snapshot);
+    REQUIRE(path.front().from == mgo::ToolpathPoint {});
+    REQUIRE(path.back().to.axis1 == Approx(2.0));
+    REQUIRE(path.back().to.axis2 == Approx(2.0));
+    for (std::size_t n = 1; n < path.size(); ++n) {
+        REQUIRE(path.at(n).from == path.at(n - 1).to);
+    }
+}
+
+TEST_CASE("Control: Scripted keys drive the model without a display")
+{
+    mgo::MockConfigReader config;
+    mgo::MockGpio gpio(false, config);
+    mgo::Model model(gpio, config);
+    std::vector<int> script(100, mgo::key::None);
+    script.front() = mgo::key::RIGHT;
+    script.back() = mgo::key::SPACE;
+    auto view = std::make_unique<mgo::HeadlessView>(script, true);
+    const mgo::HeadlessView& headless = *view;
+    mgo::Controller controller(&model, std::move(view));
+    controller.run();
+    REQUIRE(model.isQuitting());
+    // The script, then the CtrlQ which ended it
+    REQUIRE(headless.getEventTimes().size() == script.size() + 1);
+    REQUIRE(model.getAxis1MotorPosition() != 0.0);
+    REQUIRE(headless.getFrameCount() > 1);
+    REQUIRE(headless.getFrames().size() == headless.getFrameCount());
+    REQUIRE(headless.getFrames().back().axis1Position != 0);
+    REQUIRE(
+        model.profiler().summary(mgo::ProfileStage::GetEvents).count == script.size() + 1);
+    REQUIRE(model.profiler().summary(mgo::ProfileStage::CheckStatus).count > 1);
+}
+
+TEST_CASE("Control: The model's status is still checked while a dialog is open")
+{
+    mgo::MockConfigReader config;
+    mgo::MockGpio gpio(false, config);
+    mgo::Model model(gpio, config);
+    // Enter an axis1 memory value, taking a while to type it
+    std::vector<int> script { mgo::key::i };
+    script.insert(script.end(), 50, mgo::key::None);
+    script.insert(script.end(), { '1', '.', '5', mgo::key::ENTER, mgo::key::None });
+    auto view = std::make_unique<mgo::HeadlessView>(script, true);
+    mgo::HeadlessView& headless = *view;
+    uint64_t checksWhenOpened = 0;
+    uint64_t checksWhenAnswered = 0;
+    headless.setKeyCallback([&](int key) {
+        const uint64_t checks = model.profiler().summary(mgo::ProfileStage::CheckStatus).count;
+        if (key == mgo::key::i) {
+            checksWhenOpened = checks;
+        } else if (key == mgo::key::ENTER) {
+            checksWhenAnswered = checks;
+        }
+    });
+    mgo::Controller controller(&model, std::move(view));
+    controller.run();
+    REQUIRE(checksWhenAnswered > checksWhenOpened + 5);
+    REQUIRE(model.getAxis1MemoryAsPosition(0).value() == Approx(1.5).margin(0.01));
+    REQUIRE(!model.getDialog().has_value());
+    bool typed = false;
+    for (const mgo::DisplaySnapshot& frame : headless.getFrames()) {
+        typed = typed || (frame.dialog && frame.dialog->getEntry() == "1.5");
+    }
+    REQUIRE(typed);
+    REQUIRE(!headless.getFrames().back().dialog.has_value());
+}
+
+TEST_CASE("Control: ESC still works while waiting for the axes to stop")
+{
+    mgo::MockConfigReader config;
+    mgo::MockGpio gpio(false, config);
+    mgo::Model model(gpio, config);
+    // The cut ends and axis2 retracts (taking over a second), but ESC is
+    // pressed well before it's done
+    std::vector<int> script(50, mgo::key::None);
+    script.insert(script.end(), { mgo::key::ESC, mgo::key::None });
+    auto view = std::make_unique<mgo::HeadlessView>(script);
+    mgo::HeadlessView& headless = *view;
+    uint64_t checksWhenEscaped = 0;
+    bool retractingWhenEscaped = false;
+    headless.setKeyCallback([&](int key) {
+        if (key == mgo::key::ESC) {
+            checksWhenEscaped = model.profiler().summary(mgo::ProfileStage::CheckStatus).count;
+            retractingWhenEscaped = model.isAxis2MotorRunning();
+        }
+    });
+    mgo::Controller controller(&model, std::move(view));
+    model.changeMode(mgo::Mode::MultiPass);
+    model.setMultiPassRetractBetweenCuts(true);
+    model.setMultiPassStage(mgo::MultiPassStage::Cutting);
+    controller.run();
+    REQUIRE(retractingWhenEscaped);
+    REQUIRE(checksWhenEscaped > 10);
+    REQUIRE(!model.isAxis2MotorRunning());
+    REQUIRE(model.getEnabledFunction() == mgo::Mode::None);
+    REQUIRE(!model.getDialog().has_value());
+}
+
+TEST_CASE("Dialog:  Keys answer a dialog a step at a time")
+{
+    mgo::Dialog numeric(
+        mgo::Input::Type::Numeric, "Prompt", { "[&P] pause", "&Retract", "No hot key" }, "1.5");
+    REQUIRE(numeric.getText().at(0) == "[P] pause");
+    REQUIRE(numeric.getHotkeys() == std::vector<char> { 'p', 'r', 0 });
+    REQUIRE(numeric.getEntry() == "1.5");
+    // The default entry is replaced, and only numbers can be typed
+    const std::vector<int> keys { '2', '-', '.', '5', '7', 'p', mgo::key::r | mgo::key::ALT, 'x' };
+    for (int key : keys) {
+        REQUIRE(!numeric.handleKey(key));
+    }
+    REQUIRE(!numeric.handleKey(mgo::key::BACKSPACE));
+    REQUIRE(numeric.getEntry() == "2.5");
+    REQUIRE(numeric.handleKey(mgo::key::ENTER));
+    REQUIRE(!numeric.getResult().cancelled);
+    REQUIRE(numeric.getResult().number == 2.5);
+    REQUIRE(numeric.getResult().optionsSelected == std::set<char> { 'p', 'r' });
+
+    std::vector<std::string> items;
+    for (int n = 0; n < 10; ++n) {
+        items.push_back(std::to_string(n));
+    }
+    mgo::Dialog list(mgo::Input::Type::ListPicker, "Pick one", {}, "", items);
+    for (int n = 0; n < 12; ++n) {
+        REQUIRE(!list.handleKey(mgo::key::DOWN));
+    }
+    REQUIRE(list.getListSelection() == 9);
+    REQUIRE(list.getListScrollPosition() == 10 - mgo::MAX_LIST_ITEMS_IN_VIEW);
+    REQUIRE(!list.handleKey(mgo::key::UP));
+    REQUIRE(list.getListScrollPosition() == 10 - mgo::MAX_LIST_ITEMS_IN_VIEW);
+    REQUIRE(list.handleKey(mgo::key::ENTER));
+    REQUIRE(list.getResult().pickedItem == 8);
+
+    mgo::Dialog cancelled(mgo::Input::Type::ListPicker, "Pick one", {}, "", items);
+    REQUIRE(cancelled.handleKey(mgo::key::ESC));
+    REQUIRE(cancelled.getResult().cancelled);
+    REQUIRE(!cancelled.getResult().pickedItem.has_value());
+
+    mgo::Dialog pressAnyKey(mgo::Input::Type::PressAnyKey, "Help", {});
+    REQUIRE(!pressAnyKey.handleKey(mgo::key::None));
+    REQUIRE(pressAnyKey.handleKey(mgo::key::q));
+    REQUIRE(!pressAnyKey.getResult().cancelled);
+}
+
+TEST_CASE("Profile: Rolling averages forget, the worst case doesn't")
+{
+    mgo::Profiler profiler;
+    REQUIRE(profiler.summary(mgo::ProfileStage::Draw).count == 0);
+    REQUIRE(profiler.summary(mgo::ProfileStage::Draw).meanMicroseconds == 0.0);
+    profiler.record(
+        mgo::ProfileStage::Draw, mgo::Profiler::Clock::now() - std::chrono::milliseconds(10));
+    auto summary = profiler.summary(mgo::ProfileStage::Draw);
+    REQUIRE(summary.count == 1);
+    REQUIRE(summary.meanMicroseconds >= 10'000.0);
+    REQUIRE(summary.maxMicroseconds == summary.meanMicroseconds);
+    REQUIRE(summary.worstMicroseconds == summary.maxMicroseconds);
+    REQUIRE(profiler.summary(mgo::ProfileStage::Display).count == 0);
+
+    for (std::size_t n = 0; n < mgo::PROFILE_HISTORY; ++n) {
+        profiler.record(mgo::ProfileStage::Draw, mgo::Profiler::Clock::now());
+    }
+    summary = profiler.summary(mgo::ProfileStage::Draw);
+    REQUIRE(summary.count == mgo::PROFILE_HISTORY + 1);
+    REQUIRE(summary.maxMicroseconds < 10'000.0);
+    REQUIRE(summary.worstMicroseconds >= 10'000.0);
+    REQUIRE(mgo::profileStageName(mgo::ProfileStage::CheckStatus) == "checkStatus");
+}
+
 TEST_CASE("Scale:   Forward and reverse")
 {
     mgo::MockConfigReader config;
@@ -356,7 +1533,9 @@ TEST_CASE("Scale:   Sync with motor")
     mgo::MockConfigReader config;
     mgo::MockGpio gpio(false, config);
     // Note motor's conversion factor is 0.01, so 100 steps is 1.0mm
-    mgo::StepperMotor motor(gpio, 0, 0, 0, 1'000, 0.01, 10'000.0, true, 200);
+    mgo::MotionController motion(gpio);
+    mgo::Motor& motor
+        = motion.addMotor(0, 0, 1'000, 0.01, 10'000.0, mgo::MotionLimits {}, true, 200);
     mgo::LinearScale scale(gpio, 1, 2, 200);
     motor.setRpm(500.0);
     REQUIRE(scale.getPositionInMm() == 0.0);
@@ -375,3 +1554,314 @@ TEST_CASE("Scale:   Sync with motor")
     mm = scale.getPositionInMm();
     REQUIRE(std::abs(mm - 0.5) < 0.1);
 }
+
+TEST_CASE("Scale:   Closed loop allows for an existing error")
+{
+    // 100 steps per mm; the scale reads 0.2 mm more than the motor
+    mgo::ScaleFeedback feedback(0.01, mgo::ScaleFeedbackLimits {});
+    REQUIRE(feedback.start(1.0, 0, 0.2) == 80);
+    REQUIRE(feedback.isActive());
+    REQUIRE(feedback.afterMove(80, 1.0) == mgo::ScaleFeedbackResult::InPosition);
+    REQUIRE(!feedback.isActive());
+}
+
+TEST_CASE("Scale:   Closed loop corrections are rate limited")
+{
+    mgo::ScaleFeedbackLimits limits;
+    limits.toleranceMm = 0.005;
+    limits.correctionMmPerSecond = 0.5;
+    limits.maxCorrectionMm = 1.0;
+    mgo::ScaleFeedback feedback(0.01, limits);
+    feedback.start(2.0, 0, 0.0);
+    // Half way, the scale shows we're 0.1 mm (10 steps) short
+    REQUIRE(feedback.duringMove(100, 0.9, 0.0) == 200);
+    long target = 200;
+    for (int n = 0; n < 10; ++n) {
+        // i.e. 0.01 mm (one step) per 20 ms
+        const long next = feedback.duringMove(100, 0.9, 0.02);
+        REQUIRE(next - target <= 1);
+        target = next;
+    }
+    REQUIRE(target == 210);
+    // Nothing more once the error's within tolerance
+    REQUIRE(feedback.duringMove(105, 0.953, 1.0) == 210);
+}
+
+TEST_CASE("Scale:   Closed loop gives up")
+{
+    mgo::ScaleFeedbackLimits limits;
+    limits.maxCorrectionMm = 0.5;
+    limits.maxCorrectiveMoves = 2;
+    mgo::ScaleFeedback feedback(-0.01, limits);
+    REQUIRE(feedback.start(-1.0, 0, 0.0) == 100);
+    // The motor got there but the scale says it's 0.05 mm short
+    REQUIRE(feedback.afterMove(100, -0.95) == mgo::ScaleFeedbackResult::Correcting);
+    REQUIRE(feedback.getTargetStep() == 105);
+    REQUIRE(feedback.afterMove(105, -0.96) == mgo::ScaleFeedbackResult::Correcting);
+    REQUIRE(feedback.getTargetStep() == 109);
+    REQUIRE(feedback.afterMove(109, -0.97) == mgo::ScaleFeedbackResult::GaveUp);
+    REQUIRE(!feedback.isActive());
+    // Nor will it chase a scale which disagrees by more than the limit
+    feedback.start(-1.0, 0, 0.0);
+    REQUIRE(feedback.afterMove(100, 0.0) == mgo::ScaleFeedbackResult::GaveUp);
+}
+
+TEST_CASE("Scale:   Batched edges decode the same as single edges")
+{
+    // Stands in for a GPIO library which delivers edges in batches
+    struct BatchGpio : mgo::MockGpio, mgo::IGpioEdgeBatches {
+        using MockGpio::MockGpio;
+        void setEdgeBatchCallback(int, int, mgo::GpioEdgeBatchCallback cb, void* user) override
+        {
+            callback = cb;
+            userData = user;
+        }
+        void removeEdgeBatchCallback(void*) override
+        {
+            callback = nullptr;
+        }
+        mgo::GpioEdgeBatchCallback callback { nullptr };
+        void* userData { nullptr };
+    };
+    mgo::MockConfigReader config;
+    BatchGpio batchGpio(false, config);
+    mgo::MockGpio gpio(false, config);
+    mgo::LinearScale batched(batchGpio, 1, 2, 200);
+    mgo::LinearScale single(gpio, 1, 2, 200);
+    REQUIRE(batchGpio.callback != nullptr);
+    // 60 quadrature steps one way then 20 back
+    std::vector<mgo::GpioEdge> edges;
+    int levels[2] = { 0, 0 };
+    uint32_t tick = 0;
+    auto addEdges = [&](int steps, bool forwards) {
+        for (int n = 0; n < steps; ++n) {
+            // A leads B one way, B leads A the other
+            const int pin = (n % 2 == 0) == forwards ? 1 : 2;
+            levels[pin - 1] ^= 1;
+            edges.push_back({ pin, levels[pin - 1], tick += 10 });
+        }
+    };
+    addEdges(60, true);
+    addEdges(20, false);
+    for (const auto& edge : edges) {
+        single.callback(edge.pin, edge.level, edge.tick);
+    }
+    batchGpio.callback(edges.data(), edges.size(), batchGpio.userData);
+    REQUIRE(single.getPositionInMm() != 0.f);
+    REQUIRE(batched.getPositionInMm() == single.getPositionInMm());
+}
+
+TEST_CASE("Scale:   Each axis's scale has its own pins and zero")
+{
+    // Stands in for a GPIO library which dispatches edges by pin
+    struct PinGpio : mgo::MockGpio, mgo::IGpioEdgeBatches {
+        using MockGpio::MockGpio;
+        struct Consumer {
+            int pinA;
+            int pinB;
+            mgo::GpioEdgeBatchCallback callback;
+            void* userData;
+        };
+        void setEdgeBatchCallback(int pinA, int pinB, mgo::GpioEdgeBatchCallback cb, void* user)
+            override
+        {
+            consumers.push_back({ pinA, pinB, cb, user });
+        }
+        void removeEdgeBatchCallback(void* user) override
+        {
+            std::erase_if(consumers, [user](const Consumer& c) { return c.userData == user; });
+        }
+        void edges(const std::vector<mgo::GpioEdge>& edges)
+        {
+            for (const auto& consumer : consumers) {
+                std::vector<mgo::GpioEdge> theirs;
+                for (const auto& edge : edges) {
+                    if (edge.pin == consumer.pinA || edge.pin == consumer.pinB) {
+                        theirs.push_back(edge);
+                    }
+                }
+                consumer.callback(theirs.data(), theirs.size(), consumer.userData);
+            }
+        }
+        std::vector<Consumer> consumers;
+    };
+    mgo::MockConfigReader config;
+    mgo::MockGpio plainGpio(false, config);
+    REQUIRE(mgo::LinearScale::canAttach(plainGpio, 1));
+    REQUIRE(!mgo::LinearScale::canAttach(plainGpio, 2));
+    PinGpio gpio(false, config);
+    REQUIRE(mgo::LinearScale::canAttach(gpio, 2));
+    mgo::LinearScale axis1(gpio, 1, 2, 100, 1);
+    mgo::LinearScale axis2(gpio, 3, 4, 100, 2);
+    REQUIRE(gpio.consumers.size() == 2);
+    // Interleave 40 edges forwards on axis1 with 20 backwards on axis2
+    std::vector<mgo::GpioEdge> edges;
+    int levels[5] = {};
+    uint32_t tick = 0;
+    for (int n = 0; n < 40; ++n) {
+        const int pin1 = n % 2 == 0 ? 1 : 2;
+        levels[pin1] ^= 1;
+        edges.push_back({ pin1, levels[pin1], tick += 10 });
+        if (n < 20) {
+            const int pin2 = n % 2 == 0 ? 4 : 3;
+            levels[pin2] ^= 1;
+            edges.push_back({ pin2, levels[pin2], tick += 10 });
+        }
+    }
+    gpio.edges(edges);
+    // The first edge on each pin just tells us its level
+    REQUIRE(axis1.getPositionInMm() == Approx(0.38));
+    REQUIRE(axis2.getPositionInMm() == Approx(-0.18));
+    REQUIRE(axis1.getIllegalTransitions() == 0);
+    REQUIRE(axis2.getIllegalTransitions() == 0);
+    axis2.setZeroMm();
+    REQUIRE(axis2.getPositionInMm() == Approx(0.0));
+    REQUIRE(axis1.getPositionInMm() == Approx(0.38));
+}
+
+TEST_CASE("Scale:   Every edge counts, and missed edges are detected")
+{
+    mgo::MockConfigReader config;
+    mgo::MockGpio gpio(false, config);
+    mgo::LinearScale scale(gpio, 1, 2, 100);
+    // The first edge on each pin just tells us its level
+    scale.callback(1, 1, 0);
+    scale.callback(2, 1, 10);
+    REQUIRE(scale.getPositionInMm() == 0.f);
+    // A full cycle is four steps
+    scale.callback(1, 0, 20);
+    scale.callback(2, 0, 30);
+    scale.callback(1, 1, 40);
+    scale.callback(2, 1, 50);
+    REQUIRE(scale.getPositionInMm() == Approx(0.04));
+    // A change of direction on the same pin counts too
+    scale.callback(2, 0, 60);
+    scale.callback(2, 1, 70);
+    REQUIRE(scale.getPositionInMm() == Approx(0.04));
+    REQUIRE(scale.getIllegalTransitions() == 0);
+    // B can't go high again without having gone low
+    scale.callback(2, 1, 80);
+    REQUIRE(scale.getIllegalTransitions() == 1);
+    REQUIRE(scale.getPositionInMm() == Approx(0.04));
+}
+
+TEST_CASE("Monitor: Lost steps are caught, once")
+{
+    mgo::LostStepLimits limits;
+    limits.thresholdMm = 0.12;
+    limits.samples = 3;
+    mgo::LostStepMonitor monitor(0.001, limits);
+    // The scale and motor disagree from the start, and the scale lags
+    // behind by a sample as the motor moves; neither is a loss
+    long step = 0;
+    double scaleMm = 5.0;
+    for (int n = 0; n < 100; ++n) {
+        scaleMm = 5.0 + step * 0.001;
+        step += 50;
+        REQUIRE(!monitor.sample(step, scaleMm));
+    }
+    REQUIRE(monitor.getMaxDivergenceMm() == Approx(0.0).margin(1e-9));
+    // The leadscrew stalls, but the motor carries on
+    int lostAt = 0;
+    for (int n = 1; lostAt == 0 && n <= 20; ++n) {
+        step += 50;
+        if (monitor.sample(step, scaleMm)) {
+            lostAt = n;
+        }
+    }
+    // Over the threshold from the third sample, and then for three in a row
+    REQUIRE(lostAt == 5);
+    REQUIRE(monitor.getLosses() == 1);
+    // Once the motor stops, that loss isn't reported again
+    for (int n = 0; n < 20; ++n) {
+        REQUIRE(!monitor.sample(step, scaleMm));
+    }
+    REQUIRE(monitor.getLosses() == 1);
+    const std::vector<float> history = monitor.getHistory();
+    REQUIRE(history.size() == 125);
+    REQUIRE(history[104] == Approx(-0.25));
+    REQUIRE(monitor.getMaxDivergenceMm() == Approx(0.25));
+    // Setting a position isn't a loss
+    monitor.rebaseline();
+    REQUIRE(!monitor.sample(0, 0.0));
+    REQUIRE(monitor.getDivergenceMm() == 0.0);
+}
+
+TEST_CASE("Monitor: Samples are taken by a thread of its own")
+{
+    mgo::LostStepLimits limits;
+    mgo::LostStepMonitor monitor(0.001, limits);
+    std::atomic<long> step { 0 };
+    std::atomic<bool> lost { false };
+    monitor.start(
+        std::chrono::milliseconds(1),
+        [&]() { return step.load(); },
+        []() { return 0.0; },
+        [&]() { lost = true; });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    REQUIRE(!lost);
+    step = 1'000;
+    for (int n = 0; n < 1'000 && !lost; ++n) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    REQUIRE(lost);
+    REQUIRE(monitor.getLosses() == 1);
+}
+
+TEST_CASE("Capture: Edges are replayed as they were captured")
+{
+    const auto filename = (std::filesystem::temp_directory_path() / "lc_test_edges.bin").string();
+    // 400 quadrature steps forwards on a scale, with a spindle pulse on
+    // another pin now and then, which the scale must ignore
+    std::vector<mgo::GpioEdge> edges;
+    int levels[2] = { 0, 0 };
+    uint32_t tick = 0xffff'f000; // so the ticks wrap
+    for (int n = 0; n < 400; ++n) {
+        const int pin = n % 2 == 0 ? 1 : 2;
+        levels[pin - 1] ^= 1;
+        edges.push_back({ pin, levels[pin - 1], tick += 25 });
+        if (n % 10 == 0) {
+            edges.push_back({ 23, n % 20 == 0, tick += 5 });
+        }
+    }
+    {
+        mgo::EdgeRecorder recorder(filename);
+        recorder.record(edges.data(), 100);
+        recorder.record(edges.data() + 100, edges.size() - 100);
+        REQUIRE(recorder.getRecordedEdges() == edges.size());
+        REQUIRE(recorder.getDroppedEdges() == 0);
+    }
+    const std::vector<mgo::GpioEdge> captured = mgo::readEdgeCapture(filename);
+    REQUIRE(captured.size() == edges.size());
+    for (std::size_t n = 0; n < edges.size(); ++n) {
+        REQUIRE(captured[n].pin == edges[n].pin);
+        REQUIRE(captured[n].level == edges[n].level);
+        REQUIRE(captured[n].tick == edges[n].tick);
+    }
+
+    mgo::MockConfigReader config;
+    mgo::ReplayGpio gpio(config, filename, 0.0);
+    REQUIRE(gpio.getEdgeCount() == edges.size());
+    mgo::LinearScale scale(gpio, 1, 2, 100);
+    gpio.start();
+    gpio.waitUntilFinished();
+    REQUIRE(gpio.isFinished());
+    REQUIRE(gpio.getTick() == edges.back().tick);
+    // The first edge on each pin just tells us its level
+    REQUIRE(scale.getPositionInMm() == Approx(3.98));
+    REQUIRE(scale.getIllegalTransitions() == 0);
+    std::filesystem::remove(filename);
+}
+
+TEST_CASE("Capture: Only capture files are replayed")
+{
+    const auto filename
+        = (std::filesystem::temp_directory_path() / "lc_test_not_edges.bin").string();
+    {
+        std::ofstream file(filename);
+        file << "Not a capture";
+    }
+    REQUIRE_THROWS_AS(mgo::readEdgeCapture(filename), std::runtime_error);
+    std::filesystem::remove(filename);
+    REQUIRE_THROWS_AS(mgo::readEdgeCapture(filename), std::runtime_error);
+}
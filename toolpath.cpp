@@ -0,0 +1,103 @@
+#include "toolpath.h"
+
+#include <cmath>
+#include <optional>
+
+namespace mgo {
+
+namespace {
+
+// Straight lines the radius's arc is drawn with
+constexpr int RADIUS_SEGMENTS = 48;
+
+std::optional<double> memory(const std::vector<std::optional<long>>& memories, std::size_t slot)
+{
+    if (slot >= memories.size() || !memories[slot]) {
+        return std::nullopt;
+    }
+    return *memories[slot] / 100.0;
+}
+
+void planTaper(const DisplaySnapshot& snapshot, std::vector<ToolpathLine>& path)
+{
+    // As Model::startSynchronisedXMotorForTaper(), axis2 moves by
+    // tan(angle) for every mm axis1 moves
+    const ToolpathPoint from { memory(snapshot.axis1Memory, 0).value_or(0.0),
+                               memory(snapshot.axis2Memory, 0).value_or(0.0) };
+    const double axis1To = memory(snapshot.axis1Memory, 1).value_or(0.0);
+    if (axis1To == from.axis1) {
+        return;
+    }
+    const double axis2To
+        = from.axis2 + (axis1To - from.axis1) * std::tan(snapshot.taperAngle * DEG_TO_RAD);
+    path.push_back({ from, { axis1To, axis2To } });
+}
+
+void planRadius(const DisplaySnapshot& snapshot, std::vector<ToolpathLine>& path)
+{
+    // As Model::startSynchronisedXMotorForRadius(), where axis2 is always
+    // worked out from axis1's distance from zero
+    const double radius = snapshot.radius;
+    if (radius <= 0.0) {
+        return;
+    }
+    ToolpathPoint previous;
+    for (int n = 1; n <= RADIUS_SEGMENTS; ++n) {
+        const double axis1 = radius * n / RADIUS_SEGMENTS;
+        const ToolpathPoint point { axis1, radius - std::sqrt(radius * radius - axis1 * axis1) };
+        path.push_back({ previous, point });
+        previous = point;
+    }
+}
+
+void planMultiPass(const DisplaySnapshot& snapshot, std::vector<ToolpathLine>& path)
+{
+    // As Model::multiPassStepOverTarget(): each cut runs from M1 to M2 on
+    // axis1, and axis2 steps over from M1 towards M2, finishing on M2
+    const auto axis1From = memory(snapshot.axis1Memory, 0);
+    const auto axis1To = memory(snapshot.axis1Memory, 1);
+    const auto axis2From = memory(snapshot.axis2Memory, 0);
+    const auto axis2To = memory(snapshot.axis2Memory, 1);
+    if (!axis1From || !axis1To || !axis2From || !axis2To) {
+        return;
+    }
+    const double stepOver = std::abs(snapshot.stepOver) * (*axis2To < *axis2From ? -1.0 : 1.0);
+    double axis2 = *axis2From;
+    for (std::size_t pass = 0; pass < MAX_TOOLPATH_PASSES; ++pass) {
+        path.push_back({ { *axis1From, axis2 }, { *axis1To, axis2 } });
+        if (stepOver == 0.0 || std::abs(axis2 - *axis2To) < 0.0001) {
+            // A step-over of zero repeats the same cut until it's cancelled
+            return;
+        }
+        double next = axis2 + stepOver;
+        if ((stepOver > 0.0 && next > *axis2To) || (stepOver < 0.0 && next < *axis2To)) {
+            next = *axis2To;
+        }
+        path.push_back({ { *axis1To, axis2 }, { *axis1From, axis2 }, false });
+        path.push_back({ { *axis1From, axis2 }, { *axis1From, next }, false });
+        axis2 = next;
+    }
+}
+
+} // end anonymous namespace
+
+std::vector<ToolpathLine> planToolpath(const DisplaySnapshot& snapshot)
+{
+    std::vector<ToolpathLine> path;
+    switch (snapshot.enabledFunction) {
+        case Mode::Taper:
+            planTaper(snapshot, path);
+            break;
+        case Mode::Radius:
+            planRadius(snapshot, path);
+            break;
+        case Mode::MultiPass:
+            planMultiPass(snapshot, path);
+            break;
+        default:
+            break;
+    }
+    return path;
+}
+
+} // end namespace
@@ -0,0 +1,42 @@
+#pragma once
+// The path the tool is planned to take for a taper, radius or multi-pass
+// operation, worked out from the same settings (memory slots, taper angle,
+// radius and step-over) the model will use when cutting, so it can be
+// previewed before any cutting starts.
+
+#include "displaysnapshot.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace mgo {
+
+// In mm
+struct ToolpathPoint {
+    double axis1 { 0.0 };
+    double axis2 { 0.0 };
+
+    bool operator==(const ToolpathPoint&) const = default;
+};
+
+struct ToolpathLine {
+    ToolpathPoint from;
+    ToolpathPoint to;
+    // Otherwise it's a move between cuts
+    bool cutting { true };
+
+    bool operator==(const ToolpathLine&) const = default;
+};
+
+constexpr std::size_t MAX_TOOLPATH_PASSES = 200;
+
+// Empty unless a taper, radius or multi-pass is enabled, and has what it
+// needs to be planned:
+// - A taper runs from M1 (or zero, on either axis not memorised) to the
+//   axis1 position of M2 (or zero)
+// - A radius runs from zero, where the model's radius always starts
+// - A multi-pass needs M1 and M2 on both axes, and is limited to
+//   MAX_TOOLPATH_PASSES passes
+std::vector<ToolpathLine> planToolpath(const DisplaySnapshot& snapshot);
+
+} // end namespace
@@ -0,0 +1,63 @@
+#pragma once
+// Triple buffer for handing whole values from exactly one writer thread to
+// exactly one reader thread, each at its own pace. There are three slots:
+// the writer fills its own, then swaps it with the "middle" slot; the reader
+// swaps the middle slot with its own whenever something newer has been put
+// there. Neither side ever blocks or waits for the other, values are never
+// copied between slots, and the reader always has a whole value from one
+// publish(), but may skip some if the writer is the faster of the two.
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace mgo {
+
+template <typename T>
+class TripleBuffer {
+public:
+    // Writer only. The slot still holds whatever was written to it last time
+    // round, so reusing its memory (e.g. of strings) is cheap.
+    T& writeBuffer()
+    {
+        return m_slots[m_writeSlot];
+    }
+
+    // Writer only. Makes the value in writeBuffer() available to the reader,
+    // replacing anything it hasn't taken yet.
+    void publish()
+    {
+        const uint8_t previous = m_middle.exchange(m_writeSlot | FRESH, std::memory_order_acq_rel);
+        m_writeSlot = previous & SLOT;
+    }
+
+    // Reader only. Returns true if a newer value was published, in which case
+    // readBuffer() is now that value.
+    bool update()
+    {
+        if (!(m_middle.load(std::memory_order_relaxed) & FRESH)) {
+            return false;
+        }
+        const uint8_t previous = m_middle.exchange(m_readSlot, std::memory_order_acq_rel);
+        m_readSlot = previous & SLOT;
+        return true;
+    }
+
+    // Reader only
+    const T& readBuffer() const
+    {
+        return m_slots[m_readSlot];
+    }
+
+private:
+    static constexpr uint8_t SLOT = 0x03;
+    static constexpr uint8_t FRESH = 0x04;
+
+    std::array<T, 3> m_slots {};
+    uint8_t m_writeSlot { 0 };
+    // The slot between the two, and whether it holds an unread value
+    std::atomic<uint8_t> m_middle { 1 };
+    uint8_t m_readSlot { 2 };
+};
+
+} // end namespace
@@ -3,9 +3,11 @@
 #include "keycodes.h"
 #include "model.h"
 #include "sfml_dialog.h"
-#include "threadpitches.h"
+#include "toolpath.h"
 
-#include <cassert>
+#include <algorithm>
+#include <array>
+#include <chrono>
 
 #include <fmt/format.h>
 
@@ -13,13 +15,9 @@ namespace mgo {
 
 namespace {
 
-std::string formatMotorPosition(double mm)
-{
-    if (std::abs(mm) < 0.001) {
-        mm = 0.0;
-    }
-    return fmt::format("{: >8.2f}", mm);
-}
+// The most characters the readouts can show, e.g. "-12345.67"
+constexpr std::size_t POSITION_WIDTH = 10;
+constexpr std::size_t RPM_WIDTH = 7;
 
 int convertKeyCode(sf::Event event)
 {
@@ -121,6 +119,35 @@ int convertKeyCode(sf::Event event)
     return -1;
 }
 
+// Whether the settings the toolpath is planned from have changed
+bool toolpathChanged(const DisplaySnapshot& snapshot, const DisplaySnapshot* previous)
+{
+    return !previous || previous->enabledFunction != snapshot.enabledFunction
+        || previous->taperAngle != snapshot.taperAngle || previous->radius != snapshot.radius
+        || previous->stepOver != snapshot.stepOver || previous->axis1Memory != snapshot.axis1Memory
+        || previous->axis2Memory != snapshot.axis2Memory;
+}
+
+// A line for each stage, taken from whichever profiler times it
+std::string formatTimings(const Profiler& loopProfiler, const Profiler& renderProfiler)
+{
+    std::string text
+        = fmt::format("{:<16}{:>9}{:>9}{:>9}\n", "Timings (us)", "mean", "max", "worst");
+    for (std::size_t n = 0; n < PROFILE_STAGES; ++n) {
+        const auto stage = static_cast<ProfileStage>(n);
+        const bool rendering = stage == ProfileStage::UpdateText || stage == ProfileStage::Draw
+            || stage == ProfileStage::Display;
+        const ProfileSummary summary = (rendering ? renderProfiler : loopProfiler).summary(stage);
+        text += fmt::format(
+            "{:<16}{:>9.1f}{:>9.1f}{:>9.1f}\n",
+            profileStageName(stage),
+            summary.meanMicroseconds,
+            summary.maxMicroseconds,
+            summary.worstMicroseconds);
+    }
+    return text;
+}
+
 int checkMouseClick(const sf::Event::MouseButtonPressed& e) {
     (void) e;
     return -1;
@@ -154,18 +181,28 @@ void ViewSfml::initialise(const Model& model)
         throw std::runtime_error("Could not load TTF font lc_font.ttf");
     }
 
+    // The configuration doesn't change while we're running
+    m_axis1Label = model.config().read("Axis1Label", "Z");
+    m_axis1Units = model.config().read("Axis1DisplayUnits", "mm");
+    m_axis2Label = model.config().read("Axis2Label", "X");
+    m_axis2Units = model.config().read("Axis2DisplayUnits", "mm");
+    m_showAxis1 = !model.config().readBool("DisableAxis1", false);
+    m_showAxis2 = !model.config().readBool("DisableAxis2", false);
+    m_showAxis2LinearScale = model.config().readBool("Axis2UseLinearScale", false);
+    m_showRpm = !model.config().readBool("DisableRpm", false);
+
     m_txtAxis1Label = std::make_unique<sf::Text>(*m_font, "", 60);
     m_txtAxis1Label->setPosition({ 20, 10 });
-    m_txtAxis1Label->setString(model.config().read("Axis1Label", "Z") + ":");
+    m_txtAxis1Label->setString(m_axis1Label + ":");
 
-    m_txtAxis1Pos = std::make_unique<sf::Text>(*m_font, "", 60);
-    m_txtAxis1Pos->setPosition({ 110, 10 });
-    m_txtAxis1Pos->setFillColor(sf::Color::Green);
+    m_droAxis1Pos = std::make_unique<DroText>(*m_font, 60, POSITION_WIDTH);
+    m_droAxis1Pos->setPosition({ 110, 10 });
+    m_droAxis1Pos->setFillColor(sf::Color::Green);
 
     m_txtAxis1Units = std::make_unique<sf::Text>(*m_font, "", 30);
     m_txtAxis1Units->setPosition({ 430, 40 });
     m_txtAxis1Units->setFillColor({ 0, 127, 0 });
-    m_txtAxis1Units->setString(model.config().read("Axis1DisplayUnits", "mm"));
+    m_txtAxis1Units->setString(m_axis1Units);
 
     m_txtAxis1Speed = std::make_unique<sf::Text>(*m_font, "", 30);
     m_txtAxis1Speed->setPosition({ 550, 40 });
@@ -173,16 +210,16 @@ void ViewSfml::initialise(const Model& model)
 
     m_txtAxis2Label = std::make_unique<sf::Text>(*m_font, "", 60);
     m_txtAxis2Label->setPosition({ 20, 70 });
-    m_txtAxis2Label->setString(model.config().read("Axis2Label", "X") + ":");
+    m_txtAxis2Label->setString(m_axis2Label + ":");
 
-    m_txtAxis2Pos = std::make_unique<sf::Text>(*m_font, "", 60);
-    m_txtAxis2Pos->setPosition({ 110, 70 });
-    m_txtAxis2Pos->setFillColor(sf::Color::Green);
+    m_droAxis2Pos = std::make_unique<DroText>(*m_font, 60, POSITION_WIDTH);
+    m_droAxis2Pos->setPosition({ 110, 70 });
+    m_droAxis2Pos->setFillColor(sf::Color::Green);
 
     m_txtAxis2Units = std::make_unique<sf::Text>(*m_font, "", 30);
     m_txtAxis2Units->setPosition({ 430, 100 });
     m_txtAxis2Units->setFillColor({ 0, 127, 0 });
-    m_txtAxis2Units->setString(model.config().read("Axis2DisplayUnits", "mm"));
+    m_txtAxis2Units->setString(m_axis2Units);
 
     m_txtAxis2Speed = std::make_unique<sf::Text>(*m_font, "", 30);
     m_txtAxis2Speed->setPosition({ 550, 100 });
@@ -192,9 +229,9 @@ void ViewSfml::initialise(const Model& model)
     m_txtRpmLabel->setPosition({ 20, 130 });
     m_txtRpmLabel->setString("n:");
 
-    m_txtRpm = std::make_unique<sf::Text>(*m_font, "", 60);
-    m_txtRpm->setPosition({ 150, 130 });
-    m_txtRpm->setFillColor(sf::Color::Green);
+    m_droRpm = std::make_unique<DroText>(*m_font, 60, RPM_WIDTH);
+    m_droRpm->setPosition({ 150, 130 });
+    m_droRpm->setFillColor(sf::Color::Green);
 
     m_txtRpmUnits = std::make_unique<sf::Text>(*m_font, "", 30);
     m_txtRpmUnits->setPosition({ 430, 160 });
@@ -209,21 +246,19 @@ void ViewSfml::initialise(const Model& model)
         lbl->setFillColor({ 128, 128, 128 });
         lbl->setString(fmt::format("    Mem {}", n + 1));
         m_txtMemoryLabel.push_back(std::move(lbl));
-        auto valZ = std::make_unique<sf::Text>(*m_font, "", 30);
+        auto valZ = std::make_unique<DroText>(*m_font, 30, POSITION_WIDTH);
         valZ->setPosition({ 60.f + n * 180.f, MEMORY_Y + 25 });
         valZ->setFillColor({ 128, 128, 128 });
-        m_txtAxis1MemoryValue.push_back(std::move(valZ));
-        auto valX = std::make_unique<sf::Text>(*m_font, "", 30);
+        m_droAxis1MemoryValue.push_back(std::move(valZ));
+        auto valX = std::make_unique<DroText>(*m_font, 30, POSITION_WIDTH);
         valX->setPosition({ 60.f + n * 180.f, MEMORY_Y + 55 });
         valX->setFillColor({ 128, 128, 128 });
-        m_txtAxis2MemoryValue.push_back(std::move(valX));
+        m_droAxis2MemoryValue.push_back(std::move(valX));
     }
-    std::string axis1Label = model.config().read("Axis1Label", "Z") + ":";
-    m_txtAxis1MemoryLabel = std::make_unique<sf::Text>(*m_font, axis1Label, 30);
+    m_txtAxis1MemoryLabel = std::make_unique<sf::Text>(*m_font, m_axis1Label + ":", 30);
     m_txtAxis1MemoryLabel->setPosition({ 24.f, MEMORY_Y + 25 });
     m_txtAxis1MemoryLabel->setFillColor({ 128, 128, 128 });
-    std::string axis2Label = model.config().read("Axis2Label", "X") + ":";
-    m_txtAxis2MemoryLabel = std::make_unique<sf::Text>(*m_font, axis2Label, 30);
+    m_txtAxis2MemoryLabel = std::make_unique<sf::Text>(*m_font, m_axis2Label + ":", 30);
     m_txtAxis2MemoryLabel->setPosition({ 24.f, MEMORY_Y + 55 });
     m_txtAxis2MemoryLabel->setFillColor({ 128, 128, 128 });
 
@@ -281,6 +316,35 @@ void ViewSfml::initialise(const Model& model)
     m_txtWarning->setPosition({ 20, MISC_Y + 200 });
     m_txtWarning->setFillColor(sf::Color::Red);
 
+    // The mode's text is shown by its dialog, so the toolpath has this space
+    m_toolpathPreview = std::make_unique<ToolpathPreview>(
+        sf::FloatRect({ 860.f, static_cast<float>(MISC_Y) }, { 400.f, 240.f }));
+
+    // The plots take the place of the memories and the diagnostics' figures
+    const unsigned long historyMilliseconds
+        = std::max(model.config().readLong("HistorySampleMilliseconds", 20), 1ul);
+    m_historyPlots = std::make_unique<HistoryPlots>(
+        model.getHistory(),
+        *m_font,
+        sf::FloatRect({ 20.f, static_cast<float>(MEMORY_Y) }, { 1240.f, 320.f }),
+        model.config().readLong("HistorySeconds", 20) * 1'000 / historyMilliseconds,
+        m_axis1Label,
+        m_axis2Label);
+
+    // Drawn over everything else while a dialog is open
+    m_dialogBox = std::make_unique<DialogBox>(*m_font, m_window->getSize());
+
+    // Below the notifications, on the right
+    m_loopProfiler = &model.profiler();
+    m_profilerBackground = std::make_unique<sf::RectangleShape>(sf::Vector2f { 410.f, 170.f });
+    m_profilerBackground->setPosition({ 855, 200 });
+    m_profilerBackground->setFillColor({ 0, 0, 0, 192 });
+    m_profilerBackground->setOutlineColor({ 128, 128, 128 });
+    m_profilerBackground->setOutlineThickness(1.f);
+    m_txtProfiler = std::make_unique<sf::Text>(*m_font, "", 15);
+    m_txtProfiler->setPosition({ 860, 203 });
+    m_txtProfiler->setFillColor(sf::Color::Green);
+
     m_txtTaperOrRadius = std::make_unique<sf::Text>(*m_font, "", 20);
     m_txtTaperOrRadius->setPosition({ 860, 75 });
     m_txtTaperOrRadius->setFillColor(sf::Color::Red);
@@ -302,10 +366,24 @@ void ViewSfml::initialise(const Model& model)
     m_txtAxis1LinearScalePos = std::make_unique<sf::Text>(*m_font, "", 20);
     m_txtAxis1LinearScalePos->setPosition({ 550, 170 });
     m_txtAxis1LinearScalePos->setFillColor({ 209, 209, 50 });
+
+    m_txtAxis2LinearScalePos = std::make_unique<sf::Text>(*m_font, "", 20);
+    m_txtAxis2LinearScalePos->setPosition({ 550, 195 });
+    m_txtAxis2LinearScalePos->setFillColor({ 209, 209, 50 });
+
+    // From here on, the window is only drawn on by the render thread, while
+    // events are still polled from this thread
+    m_framesPerSecond
+        = std::clamp(model.config().readLong("DisplayFramesPerSecond", 30), 1ul, 60ul);
+    if (!m_window->setActive(false)) {
+        throw std::runtime_error("Could not release the window's OpenGL context");
+    }
+    m_renderThread = std::thread([this]() { renderLoop(); });
 }
 
 void ViewSfml::close()
 {
+    stopRendering();
     m_window->close();
 }
 
@@ -322,11 +400,16 @@ int ViewSfml::getEvents()
             // No events in the queue
             return key::None;
         }
+        if (event->is<sf::Event::Resized>() || event->is<sf::Event::FocusGained>()) {
+            // The window's contents may have been lost
+            m_redraw = true;
+        }
         if(event->is<sf::Event::MouseButtonPressed>()) {
             auto e = event->getIf<sf::Event::MouseButtonPressed>();
             return checkMouseClick(*e);
         }
-        if (event->is<sf::Event::KeyReleased>()) {
+        // Releasing Alt (say) mustn't put a space in a dialog
+        if (event->is<sf::Event::KeyReleased>() && !m_dialogOpen) {
             // quick check for rapid cancellation
             auto e = event->getIf<sf::Event::KeyReleased>();
             if (e) {
@@ -360,8 +443,9 @@ int ViewSfml::getEvents()
         }
     }
 
-    // We only get here if a key was pressed
-    if (lastKey == event->getIf<sf::Event::KeyPressed>()->code
+    // We only get here if a key was pressed. A dialog has to see every key,
+    // as it's typed, so it's not debounced.
+    if (!m_dialogOpen && lastKey == event->getIf<sf::Event::KeyPressed>()->code
         && clock.getElapsedTime().asMilliseconds() - lastTime.asMilliseconds() < 100) {
         // Debounce
         return -1;
@@ -371,58 +455,116 @@ int ViewSfml::getEvents()
     return convertKeyCode(*event);
 }
 
-Input::Return ViewSfml::getInput(
-    Input::Type type,
-    std::string_view prompt,
-    std::vector<std::string> additionalText,
-    std::string_view defaultEntry,
-    std::optional<std::vector<std::string>> listItems)
+ViewSfml::~ViewSfml()
 {
-    return dialog::getInput(
-        *m_window, *m_font, type, prompt, additionalText, defaultEntry, listItems);
+    stopRendering();
 }
 
 void ViewSfml::updateDisplay(const Model& model)
 {
+    // Just hands the model's state over to the render thread
+    m_dialogOpen = model.getDialog().has_value();
+    m_snapshots.writeBuffer() = takeDisplaySnapshot(model);
+    m_snapshots.publish();
+}
+
+void ViewSfml::renderLoop()
+{
+    const auto period = std::chrono::microseconds(1'000'000 / m_framesPerSecond);
+    bool haveSnapshot = false;
+    auto next = std::chrono::steady_clock::now();
+    while (!m_stopRendering) {
+        haveSnapshot = m_snapshots.update() || haveSnapshot;
+        if (haveSnapshot) {
+            render(m_snapshots.readBuffer());
+        }
+        next += period;
+        const auto now = std::chrono::steady_clock::now();
+        if (next < now) {
+            // Don't try to catch up after a slow frame
+            next = now;
+        }
+        std::this_thread::sleep_until(next);
+    }
+}
+
+void ViewSfml::stopRendering()
+{
+    m_stopRendering = true;
+    if (m_renderThread.joinable()) {
+        m_renderThread.join();
+    }
+}
+
+void ViewSfml::render(const DisplaySnapshot& snapshot)
+{
+    // Warnings blink between red and yellow
+    const bool warningRed
+        = !snapshot.warningBlinks || m_blinkClock.getElapsedTime().asMilliseconds() / 150 % 2 == 0;
+    const bool redraw = m_redraw.exchange(false);
+    const bool timingsDue
+        = snapshot.showProfiler && m_profilerClock.getElapsedTime().asMilliseconds() >= 250;
+    // The plots scroll whether or not anything else has changed
+    if (!redraw && !snapshot.showHistory && !timingsDue && m_lastSnapshot == snapshot
+        && warningRed == m_warningRed) {
+        // The frame would be identical to the one already on screen
+        return;
+    }
+    const DisplaySnapshot* previous = m_lastSnapshot ? &*m_lastSnapshot : nullptr;
+    if (previous && previous->shuttingDown) {
+        previous = nullptr;
+    }
+    auto stageStart = Profiler::Clock::now();
+    updateTextFromSnapshot(snapshot, previous);
+    m_txtWarning->setFillColor(warningRed ? sf::Color::Red : sf::Color::Yellow);
+    m_warningRed = warningRed;
+    if (timingsDue) {
+        m_txtProfiler->setString(formatTimings(*m_loopProfiler, m_profiler));
+        m_profilerClock.restart();
+    }
+    m_profiler.record(ProfileStage::UpdateText, stageStart);
+
+    // The window's OpenGL context can only be active in one thread at a time,
+    // so it's only active in this one while drawing
+    if (!m_window->setActive(true)) {
+        return;
+    }
+    // Rebuilding the path's vertex buffer needs the context too
+    if (toolpathChanged(snapshot, previous)) {
+        m_toolpathPreview->setPath(planToolpath(snapshot));
+    }
+    m_toolpathPreview->setToolPosition(
+        snapshot.axis1Position / 100.0, snapshot.axis2Position / 100.0);
+    if (snapshot.showHistory) {
+        m_historyPlots->update();
+    }
+    if (snapshot.dialog && (!previous || previous->dialog != snapshot.dialog)) {
+        m_dialogBox->setDialog(*snapshot.dialog);
+    }
+    stageStart = Profiler::Clock::now();
     m_window->clear();
-    updateTextFromModel(model);
-
-    if (!model.isShuttingDown()) {
-        if (!model.config().readBool("DisableAxis1", false)) {
-            if (model.isAxisLocked(1)) {
-                m_txtAxis1Label->setFillColor({ 90, 90, 90 });
-            } else {
-                m_txtAxis1Label->setFillColor({ 0, 192, 0 });
-            }
+    if (!snapshot.shuttingDown) {
+        if (m_showAxis1) {
             m_window->draw(*m_txtAxis1Label);
-            m_window->draw(*m_txtAxis1Pos);
+            m_window->draw(*m_droAxis1Pos);
             m_window->draw(*m_txtAxis1Units);
             m_window->draw(*m_txtAxis1Speed);
             m_window->draw(*m_txtAxis1Status);
-            m_window->draw(*m_txtAxis1MemoryLabel);
             m_window->draw(*m_txtAxis1LinearScalePos);
         }
-        if (!model.config().readBool("DisableAxis2", false)) {
-            if (model.isAxisLocked(2)) {
-                m_txtAxis2Label->setFillColor({ 90, 90, 90 });
-            } else {
-                m_txtAxis2Label->setFillColor({ 0, 192, 0 });
-            }
+        if (m_showAxis2) {
             m_window->draw(*m_txtAxis2Label);
-            m_window->draw(*m_txtAxis2Pos);
+            m_window->draw(*m_droAxis2Pos);
             m_window->draw(*m_txtAxis2Units);
             m_window->draw(*m_txtAxis2Speed);
             m_window->draw(*m_txtAxis2Status);
-            m_window->draw(*m_txtAxis2MemoryLabel);
+            if (m_showAxis2LinearScale) {
+                m_window->draw(*m_txtAxis2LinearScalePos);
+            }
         }
-        if (!model.config().readBool("DisableRpm", false)) {
+        if (m_showRpm) {
             m_window->draw(*m_txtRpmLabel);
-            if (model.getChuckRotationDirection() == RotationDirection::reversed) {
-                m_txtRpmLabel->setFillColor({ 255, 0, 0 });
-            } else {
-                m_txtRpmLabel->setFillColor({ 0, 192, 0 });
-            }
-            m_window->draw(*m_txtRpm);
+            m_window->draw(*m_droRpm);
             m_window->draw(*m_txtRpmUnits);
         }
         m_window->draw(*m_txtLeaderNotifier);
@@ -430,38 +572,39 @@ void ViewSfml::updateDisplay(const Model& model)
         m_window->draw(*m_txtGeneralStatus);
         m_window->draw(*m_txtWarning);
         m_window->draw(*m_txtNotification);
-        if (model.getEnabledFunction() == Mode::Taper
-            || model.getEnabledFunction() == Mode::Radius) {
+        if (snapshot.enabledFunction == Mode::Taper || snapshot.enabledFunction == Mode::Radius) {
             m_window->draw(*m_txtTaperOrRadius);
         }
-        if (model.getRetractionDirection() == XDirection::Inwards) {
+        if (snapshot.retractionDirection == XDirection::Inwards) {
             m_window->draw(*m_txtXRetractDirection);
         }
-        if (model.getIsAxis2Retracted()) {
+        if (snapshot.axis2Retracted) {
             m_window->draw(*m_txtXRetracted);
         }
-        for (std::size_t n = 0; n < m_txtMemoryLabel.size(); ++n) {
-            m_window->draw(*m_txtMemoryLabel.at(n));
-            if (!model.config().readBool("DisableAxis1", false)) {
-                m_window->draw(*m_txtAxis1MemoryValue.at(n));
+        if (snapshot.showHistory) {
+            m_window->draw(*m_historyPlots);
+        } else {
+            if (m_showAxis1) {
+                m_window->draw(*m_txtAxis1MemoryLabel);
             }
-            if (!model.config().readBool("DisableAxis2", false)) {
-                m_window->draw(*m_txtAxis2MemoryValue.at(n));
+            if (m_showAxis2) {
+                m_window->draw(*m_txtAxis2MemoryLabel);
+            }
+            for (std::size_t n = 0; n < m_txtMemoryLabel.size(); ++n) {
+                m_window->draw(*m_txtMemoryLabel.at(n));
+                if (m_showAxis1) {
+                    m_window->draw(*m_droAxis1MemoryValue.at(n));
+                }
+                if (m_showAxis2) {
+                    m_window->draw(*m_droAxis2MemoryValue.at(n));
+                }
+            }
+            if (snapshot.displayMode != Mode::None) {
+                m_window->draw(*m_txtMode);
             }
         }
-        // Z/X labels - make red if keyMode corresponds
-        if (model.getKeyMode() == KeyMode::Axis1 || model.getKeyMode() == KeyMode::AxisAll) {
-            m_txtAxis1MemoryLabel->setFillColor(sf::Color::Red);
-        } else {
-            m_txtAxis1MemoryLabel->setFillColor({ 128, 128, 128 });
-        }
-        if (model.getKeyMode() == KeyMode::Axis2 || model.getKeyMode() == KeyMode::AxisAll) {
-            m_txtAxis2MemoryLabel->setFillColor(sf::Color::Red);
-        } else {
-            m_txtAxis2MemoryLabel->setFillColor({ 128, 128, 128 });
-        }
-        if (model.getCurrentDisplayMode() != Mode::None) {
-            m_window->draw(*m_txtMode);
+        if (snapshot.displayMode != Mode::Diagnostics && !m_toolpathPreview->isEmpty()) {
+            m_window->draw(*m_toolpathPreview);
         }
         m_window->draw(*m_txtMisc1);
         m_window->draw(*m_txtMisc2);
@@ -469,186 +612,194 @@ void ViewSfml::updateDisplay(const Model& model)
         m_window->draw(*m_txtMisc4);
         m_window->draw(*m_txtMisc5);
     }
+    if (snapshot.showProfiler) {
+        m_window->draw(*m_profilerBackground);
+        m_window->draw(*m_txtProfiler);
+    }
+    if (snapshot.dialog) {
+        m_window->draw(*m_dialogBox);
+    }
+    m_profiler.record(ProfileStage::Draw, stageStart);
+    stageStart = Profiler::Clock::now();
     m_window->display();
+    m_profiler.record(ProfileStage::Display, stageStart);
+    [[maybe_unused]] bool rc = m_window->setActive(false);
+    m_lastSnapshot = snapshot;
 }
 
-void ViewSfml::updateTextFromModel(const Model& model)
+void ViewSfml::updateTextFromSnapshot(
+    const DisplaySnapshot& snapshot,
+    const DisplaySnapshot* previous)
 {
-    // Updates all the text objects with data in the model
-    if (model.isShuttingDown()) {
-        m_txtAxis1Pos->setString("SHUTTING DOWN");
+    // Only the text whose data has changed since the previous snapshot (if
+    // there is one) is updated, as setString() is far from free
+    if (snapshot.shuttingDown) {
         return;
     }
+    const auto changed = [&](auto field) {
+        return !previous || previous->*field != snapshot.*field;
+    };
 
-    m_txtAxis1Pos->setString(formatMotorPosition(model.getAxis1MotorPosition()));
-
-    m_txtAxis1Speed->setString(
-        fmt::format(
-            "{:<.2f} {}/min",
-            model.getAxis1MotorSpeed(),
-            model.config().read("Axis1DisplayUnits", "mm")));
-
-    if (!model.getIsAxis2Retracted()) {
-        m_txtAxis2Pos->setString(formatMotorPosition(model.getAxis2MotorPosition()));
-    } else {
-        m_txtAxis2Pos->setString("     ---");
+    if (changed(&DisplaySnapshot::axis1Position)) {
+        m_droAxis1Pos->setString(formatHundredths(snapshot.axis1Position, 8));
     }
-    m_txtAxis2Speed->setString(
-        fmt::format(
-            "{:<.2f} {}/min",
-            model.getAxis2MotorSpeed(),
-            model.config().read("Axis2DisplayUnits", "mm")));
-    float rpm = model.getRotaryEncoderRpm();
-    if (rpm > 0.f) {
-        // Round to nearest 10 to keep display more constant
-        rpm = static_cast<int>(rpm / 10.f) * 10.f;
-    }
-    m_txtRpm->setString(fmt::format("{: >7}", static_cast<int>(rpm)));
-
-    m_txtGeneralStatus->setString(model.getGeneralStatus());
-    std::string status
-        = fmt::format("{}: {}", model.config().read("Axis1Label", "Z"), model.getAxis1Status());
-    m_txtAxis1Status->setString(status);
-    status = fmt::format("{}: {}", model.config().read("Axis2Label", "X"), model.getAxis2Status());
-    m_txtAxis2Status->setString(status);
-    if (model.getEnabledFunction() == Mode::Taper) {
-        m_txtTaperOrRadius->setString(fmt::format("Angle: {}", model.getTaperAngle()));
-    } else if (model.getEnabledFunction() == Mode::Radius) {
-        m_txtTaperOrRadius->setString(fmt::format("Radius: {}", model.getRadius()));
-    }
-    if (model.getKeyMode() == KeyMode::Function) {
-        m_txtLeaderNotifier->setString(": (select function)");
-    } else {
-        m_txtLeaderNotifier->setString("");
-    }
-    m_txtChuckRpm->setString(fmt::format("C: {: >5.1f} deg", model.getChuckAngle()));
-
-    m_txtAxis1LinearScalePos->setString(
-        fmt::format(
-            "{} Scale: {:<.3f} mm",
-            model.config().read("Axis1Label", "Z"),
-            model.getAxis1LinearScalePosMm()));
-
-    for (std::size_t n = 0; n < m_txtMemoryLabel.size(); ++n) {
-        if (model.getCurrentMemorySlot() == n) {
-            m_txtMemoryLabel.at(n)->setFillColor({ 255, 255, 255 });
-            m_txtAxis1MemoryValue.at(n)->setFillColor({ 255, 255, 255 });
-            m_txtAxis2MemoryValue.at(n)->setFillColor({ 255, 255, 255 });
+    if (changed(&DisplaySnapshot::axis1Speed)) {
+        m_txtAxis1Speed->setString(
+            fmt::format("{:<.2f} {}/min", snapshot.axis1Speed / 100.0, m_axis1Units));
+    }
+    if (changed(&DisplaySnapshot::axis1Locked)) {
+        if (snapshot.axis1Locked) {
+            m_txtAxis1Label->setFillColor({ 90, 90, 90 });
         } else {
-            m_txtMemoryLabel.at(n)->setFillColor({ 100, 100, 100 });
-            m_txtAxis1MemoryValue.at(n)->setFillColor({ 100, 100, 100 });
-            m_txtAxis2MemoryValue.at(n)->setFillColor({ 100, 100, 100 });
+            m_txtAxis1Label->setFillColor({ 0, 192, 0 });
         }
-        if (model.getAxis1Memory(n) == AXIS1_UNSET) {
-            m_txtAxis1MemoryValue.at(n)->setString("        -");
+    }
+    if (changed(&DisplaySnapshot::axis2Position) || changed(&DisplaySnapshot::axis2Retracted)) {
+        if (!snapshot.axis2Retracted) {
+            m_droAxis2Pos->setString(formatHundredths(snapshot.axis2Position, 8));
         } else {
-            m_txtAxis1MemoryValue.at(n)->setString(
-                fmt::format("{: >9}", model.formatAxis1Position(model.getAxis1Memory(n))));
+            m_droAxis2Pos->setString("     ---");
         }
-        if (model.getAxis2Memory(n) == AXIS2_UNSET) {
-            m_txtAxis2MemoryValue.at(n)->setString("        -");
+    }
+    if (changed(&DisplaySnapshot::axis2Speed)) {
+        m_txtAxis2Speed->setString(
+            fmt::format("{:<.2f} {}/min", snapshot.axis2Speed / 100.0, m_axis2Units));
+    }
+    if (changed(&DisplaySnapshot::axis2Locked)) {
+        if (snapshot.axis2Locked) {
+            m_txtAxis2Label->setFillColor({ 90, 90, 90 });
         } else {
-            m_txtAxis2MemoryValue.at(n)->setString(
-                fmt::format("{: >9}", model.formatAxis2Position(model.getAxis2Memory(n))));
+            m_txtAxis2Label->setFillColor({ 0, 192, 0 });
         }
     }
-
-    switch (model.getEnabledFunction()) {
-        case Mode::Threading:
-            m_txtNotification->setString("THREADING");
-            break;
-        case Mode::Taper:
-            m_txtNotification->setString("TAPERING");
-            break;
-        case Mode::Radius:
-            m_txtNotification->setString("RADIUS");
-            break;
-        case Mode::MultiPass:
-            m_txtNotification->setString("MULTI-PASS");
-            break;
-        default:
-            m_txtNotification->setString("");
+    if (changed(&DisplaySnapshot::rpm)) {
+        m_droRpm->setString(fmt::format("{: >7}", snapshot.rpm));
+    }
+    if (changed(&DisplaySnapshot::rpmReversed)) {
+        if (snapshot.rpmReversed) {
+            m_txtRpmLabel->setFillColor({ 255, 0, 0 });
+        } else {
+            m_txtRpmLabel->setFillColor({ 0, 192, 0 });
+        }
+    }
+    if (changed(&DisplaySnapshot::chuckAngle)) {
+        m_txtChuckRpm->setString(fmt::format("C: {: >5.1f} deg", snapshot.chuckAngle / 10.0));
     }
 
-    switch (model.getCurrentDisplayMode()) {
-        // The following are all handled now by the new dialog:
-        case Mode::Taper:
-        case Mode::Radius:
-        case Mode::MultiPass:
-            break;
-        case Mode::Setup:
-            {
-                // TODO probably remove this
-                m_txtMode->setString("Setup");
-                m_txtMisc1->setString("This mode allows you to determine backlash compensation");
-                m_txtMisc2->setString(
-                    "Use a dial indicator to find number of steps "
-                    "backlash per axis");
-                m_txtMisc3->setString(
-                    "REMEMBER to unset any previous-set backlash figures in "
-                    "config!");
-                m_txtMisc4->setString("");
-                m_txtMisc5->setString(
-                    fmt::format(
-                        "Z step: {}   X step: {}",
-                        model.getAxis1MotorCurrentStep(),
-                        model.getAxis2MotorCurrentStep()));
-                m_txtWarning->setString("Press Esc to exit setup");
+    if (changed(&DisplaySnapshot::generalStatus)) {
+        m_txtGeneralStatus->setString(snapshot.generalStatus);
+    }
+    if (changed(&DisplaySnapshot::axis1Status)) {
+        m_txtAxis1Status->setString(fmt::format("{}: {}", m_axis1Label, snapshot.axis1Status));
+    }
+    if (changed(&DisplaySnapshot::axis2Status)) {
+        m_txtAxis2Status->setString(fmt::format("{}: {}", m_axis2Label, snapshot.axis2Status));
+    }
+    if (changed(&DisplaySnapshot::enabledFunction) || changed(&DisplaySnapshot::taperAngle)
+        || changed(&DisplaySnapshot::radius)) {
+        if (snapshot.enabledFunction == Mode::Taper) {
+            m_txtTaperOrRadius->setString(fmt::format("Angle: {}", snapshot.taperAngle));
+        } else if (snapshot.enabledFunction == Mode::Radius) {
+            m_txtTaperOrRadius->setString(fmt::format("Radius: {}", snapshot.radius));
+        }
+    }
+    if (changed(&DisplaySnapshot::enabledFunction)) {
+        switch (snapshot.enabledFunction) {
+            case Mode::Threading:
+                m_txtNotification->setString("THREADING");
                 break;
-            }
-        case Mode::Threading:
-            {
-                updateThreadData(model);
-                m_txtMisc4->setString("");
-                m_txtMisc5->setString("");
-                m_txtWarning->setString("");
+            case Mode::Taper:
+                m_txtNotification->setString("TAPERING");
                 break;
-            }
-        case Mode::None:
-            {
-                m_txtMode->setString("");
-                m_txtMisc1->setString("");
-                m_txtMisc2->setString("");
-                m_txtMisc3->setString("");
-                m_txtMisc4->setString("");
-                m_txtMisc5->setString("");
-                m_txtWarning->setString(model.getWarning());
-                if (!model.getWarning().empty()) {
-                    if (++m_iteration % 6 < 3) {
-                        m_txtWarning->setFillColor(sf::Color::Red);
-                    } else {
-                        m_txtWarning->setFillColor(sf::Color::Yellow);
-                    }
-                }
+            case Mode::Radius:
+                m_txtNotification->setString("RADIUS");
                 break;
+            case Mode::MultiPass:
+                m_txtNotification->setString("MULTI-PASS");
+                break;
+            default:
+                m_txtNotification->setString("");
+        }
+    }
+    if (changed(&DisplaySnapshot::keyMode)) {
+        if (snapshot.keyMode == KeyMode::Function) {
+            m_txtLeaderNotifier->setString(": (select function)");
+        } else {
+            m_txtLeaderNotifier->setString("");
+        }
+        // Z/X labels - make red if keyMode corresponds
+        if (snapshot.keyMode == KeyMode::Axis1 || snapshot.keyMode == KeyMode::AxisAll) {
+            m_txtAxis1MemoryLabel->setFillColor(sf::Color::Red);
+        } else {
+            m_txtAxis1MemoryLabel->setFillColor({ 128, 128, 128 });
+        }
+        if (snapshot.keyMode == KeyMode::Axis2 || snapshot.keyMode == KeyMode::AxisAll) {
+            m_txtAxis2MemoryLabel->setFillColor(sf::Color::Red);
+        } else {
+            m_txtAxis2MemoryLabel->setFillColor({ 128, 128, 128 });
+        }
+    }
+
+    if (changed(&DisplaySnapshot::linearScalePosition)
+        || changed(&DisplaySnapshot::linearScaleErrors)) {
+        const std::array<std::pair<sf::Text*, std::string>, 2> scaleTexts { {
+            { m_txtAxis1LinearScalePos.get(), m_axis1Label },
+            { m_txtAxis2LinearScalePos.get(), m_axis2Label },
+        } };
+        for (std::size_t n = 0; n < scaleTexts.size(); ++n) {
+            const uint32_t scaleErrors = snapshot.linearScaleErrors[n];
+            scaleTexts[n].first->setString(
+                fmt::format(
+                    "{} Scale: {:<.3f} mm{}",
+                    scaleTexts[n].second,
+                    snapshot.linearScalePosition[n] / 1000.0,
+                    scaleErrors == 0 ? "" : fmt::format(" ({} errors)", scaleErrors)));
+        }
+    }
+
+    const bool slotChanged = changed(&DisplaySnapshot::currentMemorySlot);
+    const bool axis1MemoryChanged = changed(&DisplaySnapshot::axis1Memory);
+    const bool axis2MemoryChanged = changed(&DisplaySnapshot::axis2Memory);
+    for (std::size_t n = 0; n < m_txtMemoryLabel.size(); ++n) {
+        if (slotChanged) {
+            sf::Color colour { 100, 100, 100 };
+            if (snapshot.currentMemorySlot == n) {
+                colour = { 255, 255, 255 };
             }
-        default:
-            {
-                assert(false);
+            m_txtMemoryLabel.at(n)->setFillColor(colour);
+            m_droAxis1MemoryValue.at(n)->setFillColor(colour);
+            m_droAxis2MemoryValue.at(n)->setFillColor(colour);
+        }
+        if (axis1MemoryChanged) {
+            const auto& memory = snapshot.axis1Memory.at(n);
+            m_droAxis1MemoryValue.at(n)->setString(
+                memory ? formatHundredths(*memory, 9) : "        -");
+        }
+        if (axis2MemoryChanged) {
+            const auto& memory = snapshot.axis2Memory.at(n);
+            m_droAxis2MemoryValue.at(n)->setString(
+                memory ? formatHundredths(*memory, 9) : "        -");
+        }
+    }
+
+    if (changed(&DisplaySnapshot::modeText)) {
+        m_txtMode->setString(snapshot.modeText);
+    }
+    if (changed(&DisplaySnapshot::miscText)) {
+        const std::array<sf::Text*, 5> miscTexts {
+            m_txtMisc1.get(), m_txtMisc2.get(), m_txtMisc3.get(), m_txtMisc4.get(), m_txtMisc5.get()
+        };
+        for (std::size_t n = 0; n < miscTexts.size(); ++n) {
+            if (!previous || previous->miscText[n] != snapshot.miscText[n]) {
+                miscTexts[n]->setString(snapshot.miscText[n]);
             }
+        }
     }
-    // Finally keep threading data on screen if in threading mode
-    if (model.getEnabledFunction() == Mode::Threading) {
-        updateThreadData(model);
+    if (changed(&DisplaySnapshot::warning)) {
+        m_txtWarning->setString(snapshot.warning);
     }
 }
 
-void ViewSfml::updateThreadData(const mgo::Model& model)
-{
-    m_txtMode->setString("");
-    ThreadPitch tp = threadPitches.at(model.getCurrentThreadPitchIndex());
-    m_txtMisc1->setString(fmt::format("Thread required: {}", tp.name));
-    m_txtMisc2->setString(
-        fmt::format(
-            "Male   OD: {} mm, cut: {} mm, pitch: {} mm", tp.maleOd, tp.cutDepthMale, tp.pitchMm));
-    m_txtMisc3->setString(
-        fmt::format(
-            "Female ID: {} mm, cut: {} mm, pitch {} mm",
-            tp.femaleId,
-            tp.cutDepthFemale,
-            tp.pitchMm));
-}
-
 int ViewSfml::processJoystickButton(const sf::Event& e)
 {
     auto event = e.getIf<sf::Event::JoystickButtonPressed>();
@@ -1,48 +1,60 @@
 #pragma once
 
-#include "iview.h" // For Input::*
+#include "displaysnapshot.h"
+#include "iview.h"
+#include "profiler.h"
+#include "sfml_dialog.h"
+#include "sfml_dro.h"
+#include "sfml_history.h"
+#include "sfml_toolpath.h"
+#include "triplebuffer.h"
 
 #include <SFML/Audio.hpp>
 #include <SFML/Graphics.hpp>
 
+#include <atomic>
 #include <memory>
+#include <optional>
+#include <string>
+#include <thread>
 
 namespace mgo {
 
+// The display is drawn by a thread of its own, at its own frame rate, from
+// snapshots of the model which updateDisplay() hands over to it. So however
+// long a frame takes to draw, the control loop never waits for it.
 class ViewSfml final : public IView {
 public:
+    ~ViewSfml() override;
     virtual void initialise(const Model&) override;
     virtual void close() override;
     virtual int getEvents() override;
-    virtual Input::Return getInput(
-        Input::Type type,
-        std::string_view prompt,
-        std::vector<std::string> additionalText,
-        std::string_view defaultEntry = "",
-        std::optional<std::vector<std::string>> listItems = std::nullopt
-    ) override;
     virtual void updateDisplay(const Model&) override;
     // Non-overrides:
-    void updateTextFromModel(const Model&);
-    void updateThreadData(const mgo::Model& model);
+    void updateTextFromSnapshot(const DisplaySnapshot& snapshot, const DisplaySnapshot* previous);
     int processJoystickButton(const sf::Event& event);
     int getJoystickState();
 
 private:
+    void renderLoop();
+    void stopRendering();
+    // Only draws if the frame would differ from the one on screen
+    void render(const DisplaySnapshot& snapshot);
+
     std::unique_ptr<sf::RenderWindow> m_window;
     std::unique_ptr<sf::Font> m_font;
 
     // Main text items which are always displayed:
     std::unique_ptr<sf::Text> m_txtAxis1Label;
-    std::unique_ptr<sf::Text> m_txtAxis1Pos;
+    std::unique_ptr<DroText> m_droAxis1Pos;
     std::unique_ptr<sf::Text> m_txtAxis1Units;
     std::unique_ptr<sf::Text> m_txtAxis1Speed;
     std::unique_ptr<sf::Text> m_txtAxis2Label;
-    std::unique_ptr<sf::Text> m_txtAxis2Pos;
+    std::unique_ptr<DroText> m_droAxis2Pos;
     std::unique_ptr<sf::Text> m_txtAxis2Units;
     std::unique_ptr<sf::Text> m_txtAxis2Speed;
     std::unique_ptr<sf::Text> m_txtRpmLabel;
-    std::unique_ptr<sf::Text> m_txtRpm;
+    std::unique_ptr<DroText> m_droRpm;
     std::unique_ptr<sf::Text> m_txtRpmUnits;
     std::unique_ptr<sf::Text> m_txtGeneralStatus;
     std::unique_ptr<sf::Text> m_txtAxis1Status;
@@ -52,6 +64,7 @@ private:
     std::unique_ptr<sf::Text> m_txtWarning;
     std::unique_ptr<sf::Text> m_txtTaperOrRadius;
     std::unique_ptr<sf::Text> m_txtAxis1LinearScalePos;
+    std::unique_ptr<sf::Text> m_txtAxis2LinearScalePos;
 
     // Text items which are displayed sometimes:
     std::unique_ptr<sf::Text> m_txtMode;
@@ -68,10 +81,50 @@ private:
     std::vector<std::unique_ptr<sf::Text>> m_txtMemoryLabel;
     std::unique_ptr<sf::Text> m_txtAxis1MemoryLabel;
     std::unique_ptr<sf::Text> m_txtAxis2MemoryLabel;
-    std::vector<std::unique_ptr<sf::Text>> m_txtAxis1MemoryValue;
-    std::vector<std::unique_ptr<sf::Text>> m_txtAxis2MemoryValue;
+    std::vector<std::unique_ptr<DroText>> m_droAxis1MemoryValue;
+    std::vector<std::unique_ptr<DroText>> m_droAxis2MemoryValue;
+
+    // Shown while a taper, radius or multi-pass is enabled
+    std::unique_ptr<ToolpathPreview> m_toolpathPreview;
+    // Shown by the diagnostics screen in place of its figures
+    std::unique_ptr<HistoryPlots> m_historyPlots;
+    // The control loop's and render thread's timings, shown over the rest
+    std::unique_ptr<sf::Text> m_txtProfiler;
+    std::unique_ptr<sf::RectangleShape> m_profilerBackground;
+    std::unique_ptr<DialogBox> m_dialogBox;
+
+    // Read from the config at startup
+    std::string m_axis1Label;
+    std::string m_axis1Units;
+    std::string m_axis2Label;
+    std::string m_axis2Units;
+    bool m_showAxis1 { true };
+    bool m_showAxis2 { true };
+    bool m_showAxis2LinearScale { false };
+    bool m_showRpm { true };
+
+    // Only used by the control loop's thread: whether the model has a
+    // dialog open, which must get keys just as they're typed
+    bool m_dialogOpen { false };
+    // Published by updateDisplay(), for the render thread
+    TripleBuffer<DisplaySnapshot> m_snapshots;
+    unsigned long m_framesPerSecond { 30 };
+    std::atomic<bool> m_stopRendering { false };
+    std::thread m_renderThread;
 
-    std::size_t m_iteration { 0 };
+    // Only used by the render thread:
+    // What's on screen now, so we only redraw when it would change
+    std::optional<DisplaySnapshot> m_lastSnapshot;
+    bool m_warningRed { true };
+    sf::Clock m_blinkClock;
+    // The render thread's own timings, and the control loop's (the model's)
+    Profiler m_profiler;
+    const Profiler* m_loopProfiler { nullptr };
+    // The timings are only reformatted a few times a second, to be readable
+    sf::Clock m_profilerClock;
+    // Set (by any thread) when the screen must be redrawn even if nothing
+    // has changed
+    std::atomic<bool> m_redraw { true };
 };
 
 } // namespace mgo
@@ -0,0 +1,45 @@
+#include "wakeup.h"
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <stdexcept>
+
+namespace mgo {
+
+Wakeup::Wakeup()
+    : m_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+{
+    if (m_fd < 0) {
+        throw std::runtime_error("Could not create eventfd for waking the control loop");
+    }
+}
+
+Wakeup::~Wakeup()
+{
+    ::close(m_fd);
+}
+
+void Wakeup::notify()
+{
+    const uint64_t one = 1;
+    // This can only fail if the counter would overflow, in which case
+    // there's a wakeup pending anyway
+    [[maybe_unused]] auto rc = ::write(m_fd, &one, sizeof(one));
+}
+
+bool Wakeup::wait(std::chrono::milliseconds timeout)
+{
+    pollfd fd { m_fd, POLLIN, 0 };
+    if (::poll(&fd, 1, static_cast<int>(timeout.count())) <= 0) {
+        return false;
+    }
+    // Reading resets the counter, so any number of notify() calls since the
+    // last wait only wake us once
+    uint64_t count;
+    return ::read(m_fd, &count, sizeof(count)) == sizeof(count);
+}
+
+} // end namespace
@@ -0,0 +1,31 @@
+#pragma once
+// Lets other threads wake the control loop as soon as something it must
+// react to has happened (such as a motor starting or stopping), so that in
+// between it can sleep rather than poll. Built on an eventfd, so notify() is
+// a single write() which never blocks or takes a lock, and is safe to call
+// from the real-time threads.
+
+#include <chrono>
+
+namespace mgo {
+
+class Wakeup {
+public:
+    Wakeup();
+    ~Wakeup();
+
+    Wakeup(const Wakeup&) = delete;
+    Wakeup& operator=(const Wakeup&) = delete;
+
+    // Any thread
+    void notify();
+
+    // Waits for notify() to be called, if it hasn't been since the last
+    // wait, for up to "timeout". Returns true if it was.
+    bool wait(std::chrono::milliseconds timeout);
+
+private:
+    int m_fd;
+};
+
+} // end namespace